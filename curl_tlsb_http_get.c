@@ -24,40 +24,195 @@ SOFTWARE.
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
 #include <curl/curl.h>
 
 #include "tlsb.h"
 
+static pthread_once_t curl_init_once = PTHREAD_ONCE_INIT;
 
-static size_t discard_write_cb(const void *ptr, size_t size, size_t nmemb, FILE *userdata)
+/* dns cache, tls sessions and connections are shared between requests */
+static CURLSH *share;
+static pthread_mutex_t share_mutex[CURL_LOCK_DATA_LAST];
+
+static void
+share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+    pthread_mutex_lock(&share_mutex[data]);
+}
+
+static void
+share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+    pthread_mutex_unlock(&share_mutex[data]);
+}
+
+/* curl_global_init is not thread safe so do it exactly once */
+static void
+curl_init(void)
+{
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+        pthread_mutex_init(&share_mutex[i], NULL);
+
+    share = curl_share_init();
+    if (NULL == share)
+        return;
+
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+}
+
+static size_t
+header_cb(char *buffer, size_t size, size_t nitems, void *userdata)
+{
+    tlsb_http_req_t *req = userdata;
+    size_t len = size * nitems;
+    char line[200];
+
+    if (len >= sizeof(line))
+        return len;
+
+    memcpy(line, buffer, len);
+    line[len] = '\0';
+
+    /* a new status line for each response, e.g. on redirects */
+    if (0 == strncmp(line, "HTTP/", 5)) {
+        char *s = strchr(line, ' ');
+        req->http_status = s ? atoi(s + 1) : 0;
+        req->accept_ranges = 0;
+        req->total_length = -1;
+        req->content_encoding[0] = '\0';
+    } else if (0 == strncasecmp(line, "Accept-Ranges:", 14)) {
+        req->accept_ranges = (NULL != strstr(line + 14, "bytes"));
+    } else if (0 == strncasecmp(line, "Content-Range:", 14)) {
+        char *s = strchr(line + 14, '/');
+        if (s && '*' != s[1])
+            req->total_length = atol(s + 1);
+    } else if (0 == strncasecmp(line, "Content-Length:", 15)) {
+        if (206 != req->http_status)
+            req->total_length = atol(line + 15);
+    } else if (0 == strncasecmp(line, "Content-Encoding:", 17)) {
+        /* decoded in tlsb_transport.c, curl passes the body as is */
+        sscanf(line + 17, " %15[^ \t\r\n]", req->content_encoding);
+    }
+
+    return len;
+}
+
+static size_t
+write_cb(const void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    tlsb_http_req_t *req = userdata;
+    size_t len = size * nmemb;
+
+    if (req->write_cb)
+        len = req->write_cb(ptr, len, req);
+    else if (req->f)
+        len = fwrite(ptr, 1, len, req->f);
+
+    req->ret_len += len;
+    return len;
+}
+
+static int
+progress_cb(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
 {
-    return size * nmemb;
+    tlsb_http_req_t *req = clientp;
+    return tlsb_cancelled(req->cancel);     /* != 0 aborts the transfer */
 }
 
-int tlsb_http_get(const char *url, FILE *f, int *ret_len, int timeout)
+static int
+curl_perform(tlsb_http_req_t *req)
 {
-  CURL *curl;
-  CURLcode res;
-  curl_global_init(CURL_GLOBAL_ALL);
-  curl = curl_easy_init();
-  if(!curl) return 0;
-  curl_easy_setopt(curl, CURLOPT_URL, url);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, (NULL != f) ? fwrite : discard_write_cb);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, f);
+    CURL *curl;
+    CURLcode res;
+    char range[50];
+    struct curl_slist *headers = NULL;
+
+    pthread_once(&curl_init_once, curl_init);
+
+    req->http_status = 0;
+    req->accept_ranges = 0;
+    req->total_length = -1;
+    req->ret_len = 0;
+    req->connect_ms = req->ttfb_ms = req->total_ms = -1;
+    req->content_encoding[0] = '\0';
+
+    curl = curl_easy_init();
+    if (!curl) return 0;
+    curl_easy_setopt(curl, CURLOPT_URL, req->url);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, req->timeout);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long)req->connect_timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, (long)req->low_speed_limit);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)req->low_speed_time);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);   /* we may run in threads */
+    if (share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 600L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    }
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_cb);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, req);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, req);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_cb);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, req);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+    if (req->range_start > 0 || req->range_end > 0) {
+        if (req->range_end > 0)
+            snprintf(range, sizeof(range), "%ld-%ld", req->range_start, req->range_end);
+        else
+            snprintf(range, sizeof(range), "%ld-", req->range_start);
+        curl_easy_setopt(curl, CURLOPT_RANGE, range);
+    }
+
+    if (req->compress) {
+        headers = curl_slist_append(headers, "Accept-Encoding: gzip, deflate");
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    res = curl_easy_perform(curl);
+
+    curl_off_t t;
+    if (CURLE_OK == curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &t) && t > 0)
+        req->connect_ms = t / 1000;
+    if (CURLE_OK == curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &t) && t > 0)
+        req->ttfb_ms = t / 1000;
+    if (CURLE_OK == curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &t))
+        req->total_ms = t / 1000;
+
+    curl_easy_cleanup(curl);
+    curl_slist_free_all(headers);
 
-  curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  res = curl_easy_perform(curl);
     /* Check for errors */
-  if(res != CURLE_OK) {
-      log_msg("curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-      return 0;
-  }
-  double dl;
-  res = curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD, &dl);
-  if(res == CURLE_OK && ret_len) *ret_len = (int)dl;
-  curl_easy_cleanup(curl);
-  curl_global_cleanup();
-  return 1;
+    if(res != CURLE_OK) {
+        if (!tlsb_cancelled(req->cancel))
+            log_msg("curl_easy_perform() failed: %s", curl_easy_strerror(res));
+        return 0;
+    }
+
+    return 1;
 }
+
+/* call only when no request is active anymore */
+static void
+curl_cleanup(void)
+{
+    if (share) {
+        curl_share_cleanup(share);
+        share = NULL;
+    }
+    curl_global_cleanup();
+}
+
+const tlsb_transport_t tlsb_transport_native = { "curl", curl_perform, curl_cleanup };
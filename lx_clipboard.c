@@ -22,15 +22,160 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+/*
+ * Read the CLIPBOARD selection in process, no xclip child is spawned.
+ *
+ * libX11 is opened with dlopen() so neither the plugin nor sbfetch_test carry
+ * a link time dependency. X-Plane is an X11 client, on Wayland sessions it runs
+ * on XWayland which mirrors the Wayland clipboard into CLIPBOARD.
+ * All waiting is done with select() against a deadline so an unresponsive
+ * selection owner cannot hang the caller.
+ */
+
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <sys/select.h>
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
 
-int
-get_clipboard(char *buffer, int buflen)
+#include "tlsb.h"
+
+static struct {
+    int loaded;
+    Display *(*OpenDisplay)(const char *);
+    int (*CloseDisplay)(Display *);
+    Atom (*InternAtom)(Display *, const char *, Bool);
+    Window (*GetSelectionOwner)(Display *, Atom);
+    Window (*CreateSimpleWindow)(Display *, Window, int, int, unsigned int, unsigned int,
+                                 unsigned int, unsigned long, unsigned long);
+    int (*ConvertSelection)(Display *, Atom, Atom, Atom, Window, Time);
+    int (*Flush)(Display *);
+    int (*Pending)(Display *);
+    int (*NextEvent)(Display *, XEvent *);
+    int (*GetWindowProperty)(Display *, Window, Atom, long, long, Bool, Atom,
+                             Atom *, int *, unsigned long *, unsigned long *, unsigned char **);
+    int (*Free)(void *);
+} x;
+
+static int
+load_x11(void)
 {
-    FILE *fp = popen("xclip -o", "r");
-    if (fp == NULL)  return 0;
-    fgets(buffer, buflen, fp);
-    pclose(fp);
+    if (x.loaded)
+        return x.loaded > 0;
+
+    x.loaded = -1;
+    void *h = dlopen("libX11.so.6", RTLD_NOW | RTLD_LOCAL);
+    if (NULL == h) {
+        log_msg("can't load libX11: %s", dlerror());
+        return 0;
+    }
+
+#define SYM(n) if (NULL == (*(void **)&x.n = dlsym(h, "X" #n))) { log_msg("libX11: no X" #n); return 0; }
+    SYM(OpenDisplay) SYM(CloseDisplay) SYM(InternAtom) SYM(GetSelectionOwner)
+    SYM(CreateSimpleWindow) SYM(ConvertSelection) SYM(Flush) SYM(Pending)
+    SYM(NextEvent) SYM(GetWindowProperty) SYM(Free)
+#undef SYM
+
+    x.loaded = 1;
     return 1;
 }
+
+/* wait for the SelectionNotify to our window, 1 = got it, 0 = timeout */
+static int
+wait_notify(Display *dpy, Window win, uint64_t deadline, XSelectionEvent *sev)
+{
+    int fd = ConnectionNumber(dpy);
+
+    for (;;) {
+        while (x.Pending(dpy)) {
+            XEvent ev;
+            x.NextEvent(dpy, &ev);
+            if (ev.type == SelectionNotify && ev.xselection.requestor == win) {
+                *sev = ev.xselection;
+                return 1;
+            }
+        }
+
+        int64_t left = (int64_t)(deadline - tlsb_now_ms());
+        if (left <= 0)
+            return 0;
+
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(fd, &rfds);
+        struct timeval tv = { left / 1000, (left % 1000) * 1000 };
+        if (select(fd + 1, &rfds, NULL, NULL, &tv) < 0)
+            return 0;
+    }
+}
+
+int
+get_clipboard(char *buffer, int buflen, int timeout_ms)
+{
+    uint64_t deadline = tlsb_now_ms() + timeout_ms;
+    int ret = 0;
+
+    if (!load_x11())
+        return 0;
+
+    Display *dpy = x.OpenDisplay(NULL);
+    if (NULL == dpy) {
+        log_msg("can't open X display");
+        return 0;
+    }
+
+    Atom clipboard = x.InternAtom(dpy, "CLIPBOARD", False);
+    Atom prop = x.InternAtom(dpy, "TLSB_CLIPBOARD", False);
+    Atom incr = x.InternAtom(dpy, "INCR", False);
+    Atom targets[2] = { x.InternAtom(dpy, "UTF8_STRING", False), XA_STRING };
+
+    if (None == x.GetSelectionOwner(dpy, clipboard))
+        goto out;
+
+    Window win = x.CreateSimpleWindow(dpy, DefaultRootWindow(dpy), 0, 0, 1, 1, 0, 0, 0);
+
+    for (int i = 0; i < 2; i++) {
+        XSelectionEvent sev;
+        x.ConvertSelection(dpy, clipboard, targets[i], prop, win, CurrentTime);
+        x.Flush(dpy);
+
+        if (!wait_notify(dpy, win, deadline, &sev)) {
+            log_msg("clipboard owner does not answer");
+            goto out;
+        }
+
+        if (sev.property == None)
+            continue;   /* target not supported, try the next one */
+
+        Atom type;
+        int format;
+        unsigned long n, after;
+        unsigned char *data = NULL;
+        if (Success == x.GetWindowProperty(dpy, win, prop, 0, buflen / 4 + 1, True, AnyPropertyType,
+                                           &type, &format, &n, &after, &data)
+            && data != NULL && type != incr && format == 8) {
+            /* INCR transfers are for large selections, we only need a line */
+            int len = n < (unsigned long)buflen ? (int)n : buflen - 1;
+            memcpy(buffer, data, len);
+            buffer[len] = '\0';
+            ret = 1;
+        }
+
+        if (data)
+            x.Free(data);
+        break;
+    }
+
+  out:
+    x.CloseDisplay(dpy);    /* also destroys the window */
+
+    /* behave like fgets: first line only */
+    if (ret) {
+        char *nl = strpbrk(buffer, "\r\n");
+        if (nl)
+            *nl = '\0';
+    }
+    return ret;
+}
@@ -27,7 +27,7 @@ SOFTWARE.
 #include <stdio.h>
 
 int
-get_clipboard(char *buffer, int buflen)
+get_clipboard(char *buffer, int buflen, int timeout_ms)
 {
     FILE *fp = popen("pbpaste -pboard general -Prefer txt", "r");
     if (fp == NULL)  return 0;
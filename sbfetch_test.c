@@ -28,29 +28,540 @@ SOFTWARE.
 #include <stdarg.h>
 #include <unistd.h>
 #include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#ifdef WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
 #include "tlsb.h"
 
-char tlsb_tmp_fn[] = "xml.tmp";
 char pilot_id[20];
 
+/* compare two .fms files line by line, numbers with a tolerance, return # of differences */
+static int
+fms_compare(const char *fn1, const char *fn2)
+{
+    char l1[200], l2[200];
+    int n_diff = 0, line = 0;
+
+    FILE *f1 = fopen(fn1, "r");
+    FILE *f2 = fopen(fn2, "r");
+    if (NULL == f1 || NULL == f2) {
+        log_msg("can't open '%s' or '%s'", fn1, fn2);
+        exit(1);
+    }
+
+    for (;;) {
+        char *r1 = fgets(l1, sizeof(l1), f1);
+        char *r2 = fgets(l2, sizeof(l2), f2);
+        if (NULL == r1 && NULL == r2)
+            break;
+        line++;
+        if (NULL == r1 || NULL == r2) {
+            log_msg("line %d: file length differs", line);
+            n_diff++;
+            break;
+        }
+
+        char *s1, *s2;
+        char *t1 = strtok_r(l1, " \t\r\n", &s1);
+        char *t2 = strtok_r(l2, " \t\r\n", &s2);
+        while (t1 || t2) {
+            char *e1, *e2;
+            int same = t1 && t2 && 0 == strcmp(t1, t2);
+            if (!same && t1 && t2) {
+                double v1 = strtod(t1, &e1), v2 = strtod(t2, &e2);
+                same = (*e1 == '\0' && *e2 == '\0' && fabs(v1 - v2) < 1.0E-4);
+            }
+            if (!same) {
+                log_msg("line %d: '%s' <> '%s'", line, t1 ? t1 : "", t2 ? t2 : "");
+                n_diff++;
+                break;
+            }
+            t1 = strtok_r(NULL, " \t\r\n", &s1);
+            t2 = strtok_r(NULL, " \t\r\n", &s2);
+        }
+    }
+
+    fclose(f1);
+    fclose(f2);
+    return n_diff;
+}
+
+/*
+ * Bulk parsing of archived OFPs.
+ * The files are split into one range per worker. A worker takes from the
+ * front of its own range, when that is empty it steals the back half of the
+ * largest other range.
+ */
+typedef struct _bulk_range
+{
+    pthread_mutex_t mutex;
+    int lo, hi;
+} bulk_range_t;
+
+static char **bulk_fn;          /* files */
+static char **bulk_csv;         /* result line per file */
+static long *bulk_size;
+static char *bulk_ok;           /* status is "Success" */
+static int bulk_n, bulk_max;
+static int bulk_n_worker;
+static bulk_range_t *bulk_range;
+
+static void
+bulk_add(const char *fn)
+{
+    if (bulk_n == bulk_max) {
+        bulk_max = bulk_max ? 2 * bulk_max : 1024;
+        bulk_fn = realloc(bulk_fn, bulk_max * sizeof(char *));
+        if (NULL == bulk_fn)
+            exit(1);
+    }
+    bulk_fn[bulk_n++] = strdup(fn);
+}
+
+/* collect *.xml files below dir */
+static void
+bulk_walk(const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (NULL == d) {
+        log_msg("can't open '%s'", dir);
+        return;
+    }
+
+    struct dirent *de;
+    while (NULL != (de = readdir(d))) {
+        if ('.' == de->d_name[0])
+            continue;
+
+        char fn[1000];
+        struct stat sb;
+        snprintf(fn, sizeof(fn), "%s/%s", dir, de->d_name);
+        if (0 != stat(fn, &sb))
+            continue;
+
+        int len = strlen(de->d_name);
+        if (S_ISDIR(sb.st_mode))
+            bulk_walk(fn);
+        else if (len > 4 && (0 == strcmp(de->d_name + len - 4, ".xml")
+                             || 0 == strcmp(de->d_name + len - 4, ".XML")))
+            bulk_add(fn);
+    }
+    closedir(d);
+}
+
+/* next file for worker w or -1 */
+static int
+bulk_next(int w)
+{
+    bulk_range_t *r = &bulk_range[w];
+
+    pthread_mutex_lock(&r->mutex);
+    int i = (r->lo < r->hi) ? r->lo++ : -1;
+    pthread_mutex_unlock(&r->mutex);
+    if (i >= 0)
+        return i;
+
+    /* steal from the fullest victim, the count is a hint only */
+    int victim = -1, most = 0;
+    for (int v = 0; v < bulk_n_worker; v++) {
+        int n = bulk_range[v].hi - bulk_range[v].lo;
+        if (v != w && n > most) {
+            most = n;
+            victim = v;
+        }
+    }
+
+    if (victim < 0)
+        return -1;
+
+    bulk_range_t *vr = &bulk_range[victim];
+    pthread_mutex_lock(&vr->mutex);
+    int n = (vr->hi - vr->lo) / 2;
+    int lo = vr->hi - n, hi = vr->hi;
+    vr->hi = lo;
+    if (n == 0 && vr->lo < vr->hi)      /* a single one left */
+        i = vr->lo++;
+    pthread_mutex_unlock(&vr->mutex);
+
+    if (n == 0)
+        return i >= 0 ? i : bulk_next(w);
+
+    pthread_mutex_lock(&r->mutex);
+    r->lo = lo + 1;
+    r->hi = hi;
+    pthread_mutex_unlock(&r->mutex);
+    return lo;
+}
+
+/* append a field, quoted as in RFC 4180 if it needs to be, return the new length */
+static int
+csv_add(char *line, int len, int size, const char *field, int first)
+{
+    int quote = (NULL != strpbrk(field, ",\"\r\n"));
+    if (!first && len < size - 1)
+        line[len++] = ',';
+    if (quote && len < size - 1)
+        line[len++] = '"';
+    for (const char *c = field; *c && len < size - 2; c++) {
+        if ('"' == *c)
+            line[len++] = '"';
+        line[len++] = *c;
+    }
+    if (quote && len < size - 1)
+        line[len++] = '"';
+    line[len] = '\0';
+    return len;
+}
+
+static void *
+bulk_proc(void *arg)
+{
+    int w = (int)(intptr_t)arg;
+    ofp_info_t *oi = malloc(sizeof(ofp_info_t));
+    if (NULL == oi)
+        return NULL;
+
+    int i;
+    while ((i = bulk_next(w)) >= 0) {
+        char line[3000];
+        bulk_size[i] = tlsb_ofp_parse_file(bulk_fn[i], oi, 0);
+        if (bulk_size[i] < 0)
+            strcpy(oi->status, "Read error");
+        else if ('\0' == oi->status[0])
+            strcpy(oi->status, "Not an OFP");
+
+        const char *field[] = {
+            bulk_fn[i], oi->status, oi->time_generated, oi->icao_airline, oi->flight_number,
+            oi->aircraft_icao, oi->origin, oi->destination, oi->fuel_plan_ramp, oi->units,
+            oi->payload, oi->est_time_enroute, oi->route
+        };
+        int len = 0;
+        for (int k = 0; k < (int)(sizeof(field) / sizeof(field[0])); k++)
+            len = csv_add(line, len, sizeof(line) - 1, field[k], 0 == k);
+        strcpy(line + len, "\n");
+        bulk_ok[i] = (0 == strcmp(oi->status, "Success"));
+        free(bulk_csv[i]);
+        bulk_csv[i] = strdup(line);
+    }
+
+    free(oi);
+    return NULL;
+}
+
+/* parse all files with n_worker threads, return wall time in ms */
+static long
+bulk_run(int n_worker)
+{
+    pthread_t tid[n_worker];
+    bulk_range_t range[n_worker];
+
+    bulk_n_worker = n_worker;
+    bulk_range = range;
+    for (int w = 0; w < n_worker; w++) {
+        pthread_mutex_init(&range[w].mutex, NULL);
+        range[w].lo = (long)bulk_n * w / n_worker;
+        range[w].hi = (long)bulk_n * (w + 1) / n_worker;
+    }
+
+    long t0 = tlsb_now_ms();
+    for (int w = 0; w < n_worker; w++)
+        pthread_create(&tid[w], NULL, bulk_proc, (void *)(intptr_t)w);
+    for (int w = 0; w < n_worker; w++)
+        pthread_join(tid[w], NULL);
+    long dt = tlsb_now_ms() - t0;
+
+    for (int w = 0; w < n_worker; w++)
+        pthread_mutex_destroy(&range[w].mutex);
+    return dt > 0 ? dt : 1;
+}
+
+static int
+n_cores(void)
+{
+#ifdef WINDOWS
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+#endif
+}
+
+/* parse a directory tree of OFPs with 1, 2, 4 ... cores, the summary goes to csv_fn */
+static int
+bulk_parse(const char *dir, const char *csv_fn)
+{
+    bulk_walk(dir);
+    if (0 == bulk_n) {
+        log_msg("no .xml files in '%s'", dir);
+        return 0;
+    }
+
+    bulk_csv = calloc(bulk_n, sizeof(char *));
+    bulk_size = calloc(bulk_n, sizeof(long));
+    bulk_ok = calloc(bulk_n, 1);
+    if (NULL == bulk_csv || NULL == bulk_size || NULL == bulk_ok)
+        return 0;
+
+    int max_worker = n_cores();
+    long t1 = 0;
+    for (int n = 1; ; n = (2 * n < max_worker ? 2 * n : max_worker)) {
+        long dt = bulk_run(n);
+        if (1 == n)
+            t1 = dt;
+
+        double mb = 0;
+        for (int i = 0; i < bulk_n; i++)
+            if (bulk_size[i] > 0)
+                mb += bulk_size[i];
+        mb /= 1024.0 * 1024.0;
+
+        log_msg("%2d cores: %d files in %ld ms, %.0f files/s, %.1f MB/s, speedup %.2f",
+                n, bulk_n, dt, bulk_n * 1000.0 / dt, mb * 1000.0 / dt, (double)t1 / dt);
+        if (n == max_worker)
+            break;
+    }
+
+    FILE *f = fopen(csv_fn, "w");
+    if (NULL == f) {
+        log_msg("can't create '%s'", csv_fn);
+        return 0;
+    }
+
+    int n_ok = 0;
+    fputs("file,status,time_generated,airline,flight,aircraft,origin,destination,"
+          "fuel_plan_ramp,units,payload,est_time_enroute,route\n", f);
+    for (int i = 0; i < bulk_n; i++) {
+        fputs(bulk_csv[i], f);
+        n_ok += bulk_ok[i];
+    }
+    fclose(f);
+
+    log_msg("%d of %d OFPs parsed, summary in '%s'", n_ok, bulk_n, csv_fn);
+    return 1;
+}
+
+/* what the plugin's fetch_xfer fast path would load */
+static void
+early_cb(const ofp_info_t *oi, void *ctx)
+{
+    log_msg("fuel and weights after %ld ms: ramp fuel %s %s, pax %s, freight %s",
+            tlsb_now_ms() - *(long *)ctx, oi->fuel_plan_ramp, oi->units, oi->pax_count, oi->freight);
+}
+
+/* one of several concurrent fetches */
+static void *
+join_proc(void *arg)
+{
+    (void)arg;
+    ofp_info_t *oi = malloc(sizeof(ofp_info_t));
+    tlsb_ofp_get_parse(pilot_id, oi, NULL);
+    log_msg("join: %s", oi->status);
+    free(oi);
+    return NULL;
+}
+
+/* -m: the highest peak of all fetches goes against the budget */
+static long mem_worst;
+
+static void
+mem_note(void)
+{
+    tlsb_mem_stat_t st;
+    tlsb_ofp_mem_stat(&st);
+    if (st.peak > mem_worst)
+        mem_worst = st.peak;
+}
+
+/*
+ * -k: standing on any fix of the route the grid finds a leg next to it.
+ * On the other side of the earth nothing is near and the grid must not
+ * answer with some far leg, the result equals that of a linear search.
+ */
+static int
+track_check(const ofp_info_t *oi)
+{
+    static tlsb_track_t tr, lin;
+    int n_bad = 0;
+
+    int n_leg = tlsb_track_init(&tr, oi);
+    if (n_leg <= 0 || tr.n_cell <= 0) {
+        log_msg("track: %d legs, no grid", n_leg);
+        return 0;
+    }
+
+    memcpy(&lin, &tr, sizeof(lin));
+    lin.n_cell = -1;
+
+    for (int i = 0; i < oi->n_fix; i++) {
+        const ofp_fix_t *fix = &oi->navlog[i];
+        tr.leg = -1;
+        tlsb_track_update(&tr, fix->lat, fix->lon, 0.0f);
+        if (tr.off_nm > 1.0f) {
+            log_msg("track: %s is %0.1f nm off leg %d", fix->ident, tr.off_nm, tr.leg);
+            n_bad++;
+        }
+    }
+
+    int n_near_linear = tr.n_linear;
+
+    for (int i = 0; i < oi->n_fix; i++) {
+        const ofp_fix_t *fix = &oi->navlog[i];
+        double lon = fix->lon > 0.0f ? fix->lon - 180.0 : fix->lon + 180.0;
+        tr.leg = lin.leg = -1;
+        tlsb_track_update(&tr, fix->lat, lon, 0.0f);
+        tlsb_track_update(&lin, fix->lat, lon, 0.0f);
+        if (tr.leg != lin.leg || fabsf(tr.off_nm - lin.off_nm) > 0.1f) {
+            log_msg("track: opposite of %s leg %d %0.1f nm, linear %d %0.1f nm",
+                    fix->ident, tr.leg, tr.off_nm, lin.leg, lin.off_nm);
+            n_bad++;
+        }
+    }
+
+    log_msg("track: %d legs, %d cells, %d fixes, %d bad, %d of %d near searches went linear",
+            n_leg, tr.n_cell, oi->n_fix, n_bad, n_near_linear, oi->n_fix);
+    return 0 == n_bad && 0 == n_near_linear;
+}
+
 /*
  * call with
  * sbfetch_test pilot_id
  * or
  * sbfetch_test -c
  * to get from clipboard
+ * or
+ * sbfetch_test -f pilot_id
+ * to compare the locally written .fms with simbrief's file
+ * or
+ * sbfetch_test -n xp_dir "route"
+ * to check a route against the navdata index (built in the current directory)
+ * or
+ * sbfetch_test -a xp_dir icao
+ * to look up an airport in the apt.dat index (built in the current directory)
+ * or
+ * sbfetch_test -o dir [summary.csv]
+ * to parse all archived OFPs below dir on all cores
+ *
+ * options before that:
+ * -t transport     native, record:<dir>, replay:<dir> or replay-fast:<dir>
+ * -b n             fetch and parse the OFP n more times and report timing
+ * -s "query"       search the briefing of the OFP
+ * -j n             fire n more fetches at once, they should share one request
+ * -m kB            fail if the peak memory of a fetch exceeds that budget
+ * -k               check the route progress grid against the navlog
  */
 int
 main(int argc, char** argv)
 {
+    int compare_fms = 0, n_bench = 0, n_join = 0;
+    long mem_budget = 0;
+    int check_track = 0;
+    const char *query = NULL;
+
+    while (argc > 2) {
+        if (0 == strcmp(argv[1], "-t")) {
+            if (!tlsb_transport_select(argv[2]))
+                exit(1);
+        } else if (0 == strcmp(argv[1], "-b")) {
+            n_bench = atoi(argv[2]);
+        } else if (0 == strcmp(argv[1], "-s")) {
+            query = argv[2];
+        } else if (0 == strcmp(argv[1], "-j")) {
+            n_join = atoi(argv[2]);
+        } else if (0 == strcmp(argv[1], "-m")) {
+            mem_budget = atol(argv[2]) * 1024;
+        } else if (0 == strcmp(argv[1], "-k")) {
+            check_track = 1;
+            argc--;
+            argv++;
+            continue;
+        } else
+            break;
+        argc -= 2;
+        argv += 2;
+    }
+
     if (argc < 2) {
         log_msg("missing argument");
         exit(1);
     }
 
+    if (0 == strcmp(argv[1], "-f")) {
+        if (argc < 3)
+            exit(1);
+        compare_fms = 1;
+        argv++;
+    }
+
+    if (0 == strcmp(argv[1], "-n")) {
+        if (argc < 4 || !nav_init(argv[2], ".", NULL))
+            exit(1);
+
+        static nav_route_t rte;
+        int n = nav_route_check(argv[3], &rte);
+        for (int i = 0; i < n; i++)
+            log_msg("%3d %-7s %-11s %9.4f %10.4f", i, rte.wpt[i].via, rte.wpt[i].ident,
+                    rte.wpt[i].lat, rte.wpt[i].lon);
+        log_msg("%d waypoints, %d unknown: '%s'", n, rte.n_unknown, rte.unknown);
+
+        long t0 = tlsb_now_ms();
+        for (int i = 0; i < 1000; i++)
+            nav_route_check(argv[3], &rte);
+        log_msg("%ld us per route check", tlsb_now_ms() - t0);
+        nav_cleanup();
+        exit(0);
+    }
+
+    if (0 == strcmp(argv[1], "-a")) {
+        if (argc < 4 || !apt_init(argv[2], ".", NULL))
+            exit(1);
+
+        apt_info_t apt;
+        if (!apt_lookup(argv[3], &apt)) {
+            log_msg("'%s' not found", argv[3]);
+            exit(1);
+        }
+
+        log_msg("%s %9.4f %10.4f elevation %d ft", apt.icao, apt.lat, apt.lon, apt.elevation);
+        for (int i = 0; i < apt.n_rwy; i++) {
+            apt_rwy_t *r = &apt.rwy[i];
+            log_msg("  %-3s %9.4f %10.4f %5.1f %5.0f m x %3.0f m, displaced %4.0f m",
+                    r->id, r->lat, r->lon, r->heading, r->length, r->width, r->displaced);
+        }
+
+        long t0 = tlsb_now_ms();
+        for (int i = 0; i < 1000; i++)
+            apt_lookup(argv[3], &apt);
+        log_msg("%ld us per lookup", tlsb_now_ms() - t0);
+        apt_cleanup();
+        exit(0);
+    }
+
+    if (0 == strcmp(argv[1], "-o")) {
+        if (argc < 3)
+            exit(1);
+        exit(bulk_parse(argv[2], argc > 3 ? argv[3] : "ofp_summary.csv") ? 0 : 1);
+    }
+
     if (0 == strcmp(argv[1], "-c")) {
-        if (get_clipboard(pilot_id, sizeof(pilot_id) -1)) {
-            log_msg("From clipboard: '%s'", pilot_id);
+        /* same path as the plugin: start, then poll */
+        uint64_t t0 = tlsb_now_ms();
+        int res;
+        clipboard_start(2000);
+        while (0 == (res = clipboard_poll(pilot_id, sizeof(pilot_id))))
+            usleep(10 * 1000);
+        clipboard_stop();
+
+        if (res > 0) {
+            log_msg("From clipboard: '%s' in %d ms", pilot_id, (int)(tlsb_now_ms() - t0));
         } else {
             log_msg("clipboard is empty");
             exit(1);
@@ -60,8 +571,17 @@ main(int argc, char** argv)
     }
 
     ofp_info_t ofp_info;
-    tlsb_ofp_get_parse(pilot_id, &ofp_info);
+    long t0 = tlsb_now_ms();
+    tlsb_ofp_get_parse_early(pilot_id, &ofp_info, NULL, early_cb, &t0);
+    log_msg("complete OFP after %ld ms", tlsb_now_ms() - t0);
+    mem_note();
     tlsb_dump_ofp_info(&ofp_info);
+
+    char winds[80];
+    tlsb_wind_page(&ofp_info, "CLB", atoi(ofp_info.altitude) / 100, winds, sizeof(winds));
+    log_msg("CLB winds: %s", winds);
+    tlsb_wind_page(&ofp_info, "DSC", atoi(ofp_info.altitude) / 100, winds, sizeof(winds));
+    log_msg("DES winds: %s", winds);
     time_t tg = atol(ofp_info.time_generated);
     log_msg("tg %u", tg);
     struct tm tm;
@@ -75,6 +595,88 @@ main(int argc, char** argv)
                    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
                    tm.tm_hour, tm.tm_min, tm.tm_sec);
     log_msg("'%s'", line);
+    tlsb_http_log_stats();
+
+    if (query) {
+        tlsb_search_t *idx = tlsb_search_get(ofp_info.time_generated);
+        if (NULL == idx) {
+            log_msg("OFP has no briefing");
+            exit(1);
+        }
+
+        const char *alias[] = {
+            "ORIGIN", ofp_info.origin, "DESTINATION", ofp_info.destination,
+            "ALTERNATE", ofp_info.alternate, NULL
+        };
+        tlsb_hit_t hits[10];
+        int n = tlsb_search_query(idx, query, alias, hits, 10);
+        for (int i = 0; i < n && i < 10; i++)
+            log_msg("%6d: %.*s", hits[i].ofs, hits[i].len, tlsb_search_text(idx) + hits[i].ofs);
+        log_msg("'%s': %d hits", query, n);
+
+        long t0 = tlsb_now_ms();
+        for (int i = 0; i < 1000; i++)
+            tlsb_search_query(idx, query, alias, hits, 10);
+        log_msg("%ld us per query", tlsb_now_ms() - t0);
+        tlsb_search_release(idx);
+    }
+
+    if (n_bench > 0) {
+        long t_min = 1000000, t_max = 0, t_sum = 0;
+        for (int i = 0; i < n_bench; i++) {
+            long t0 = tlsb_now_ms();
+            tlsb_ofp_forget();
+            tlsb_ofp_get_parse(pilot_id, &ofp_info, NULL);
+            long t = tlsb_now_ms() - t0;
+            mem_note();
+            t_sum += t;
+            if (t < t_min) t_min = t;
+            if (t > t_max) t_max = t;
+        }
+        log_msg("bench: %d fetches, min/avg/max %ld/%ld/%ld ms", n_bench, t_min, t_sum / n_bench, t_max);
+        tlsb_http_log_stats();
+    }
+
+    if (n_join > 0) {
+        pthread_t tid[n_join];
+        tlsb_ofp_forget();
+        long t0 = tlsb_now_ms();
+        for (int i = 0; i < n_join; i++)
+            pthread_create(&tid[i], NULL, join_proc, NULL);
+        for (int i = 0; i < n_join; i++)
+            pthread_join(tid[i], NULL);
+        log_msg("join: %d fetches in %ld ms", n_join, tlsb_now_ms() - t0);
+        tlsb_http_log_stats();
+        mem_note();
+    }
+
+    if (check_track && !track_check(&ofp_info))
+        exit(1);
+
+    tlsb_mem_log_stats();
+    if (mem_budget > 0) {
+        log_msg("memory: worst fetch peak %ld kB, budget %ld kB", mem_worst / 1024, mem_budget / 1024);
+        if (mem_worst > mem_budget) {
+            log_msg("memory budget exceeded");
+            exit(1);
+        }
+    }
+
+    if (compare_fms) {
+        char url[300];
+        int changed;
+        if (!tlsb_write_fms(&ofp_info, "local.fms", &changed))
+            exit(1);
+        snprintf(url, sizeof(url), "%s%s", ofp_info.sb_path, ofp_info.sb_fms_link);
+        FILE *f = fopen("simbrief.fms", "wb");
+        if (NULL == f || !tlsb_http_get(url, f, NULL, 10))
+            exit(1);
+        fclose(f);
+
+        int n_diff = fms_compare("local.fms", "simbrief.fms");
+        log_msg("local.fms vs simbrief.fms: %d differences", n_diff);
+        exit(n_diff ? 1 : 0);
+    }
 
 exit(0);
 }
@@ -30,6 +30,8 @@ SOFTWARE.
 #include <stdarg.h>
 #include <unistd.h>
 #include <errno.h>
+#include <math.h>
+#include <pthread.h>
 
 #include "XPLMPlugin.h"
 #include "XPLMPlanes.h"
@@ -43,20 +45,20 @@ SOFTWARE.
 #include "XPStandardWidgets.h"
 
 #include "tlsb.h"
+#include "tlsb_shm.h"
+#include "tlsb_scroll.h"
 
 #define UNUSED(x) (void)(x)
 
 #define VERSION "1.20-dev"
 
-#define LB_2_KG 0.45359237    /* imperial to metric */
-
 static float flight_loop_cb(float unused1, float unused2, int unused3, void *unused4);
+static void create_widget();
 
 static char xpdir[512];
 static const char *psep;
 static char fms_path[512];
-
-char tlsb_tmp_fn[512];
+static char cache_dir[512];
 
 static XPLMMenuID tlsb_menu;
 
@@ -65,7 +67,8 @@ static XPWidgetID getofp_widget, display_widget, getofp_btn,
                   status_line,
                   xfer_fuel_btn, xfer_payload_btn, xfer_all_btn;
 static XPWidgetID conf_widget, pilot_id_input, conf_ok_btn,
-                  conf_downl_pdf_btn, conf_downl_pdf_path, conf_downl_pdf_paste_btn, conf_downl_fpl_btn;
+                  conf_downl_pdf_btn, conf_downl_pdf_path, conf_downl_pdf_paste_btn, conf_downl_fpl_btn,
+                  conf_prefetch_btn, conf_watch_btn, conf_watch_path;
 
 #ifdef UPLOAD_ASXP
 static XPWidgetID conf_upl_aspx_btn;
@@ -85,8 +88,10 @@ static ofp_info_t ofp_info;
 static XPLMDataRef no_pax_dr, pax_distrib_dr, aft_cargo_dr, fwd_cargo_dr,
                    write_fob_dr, vr_enabled_dr,
                    popup_height_dr,
-                   acf_icao_dr;
+                   acf_icao_dr, fuel_total_dr, on_ground_dr, flight_time_dr,
+                   lat_dr, lon_dr, gs_dr, zulu_time_dr;
 static XPLMCommandRef set_weight_cmdr, iscs_cmdr;  /* ToLiss commands */
+static XPLMCommandRef toggle_cmdr, fetch_cmdr, fetch_xfer_cmdr;
 typedef enum xfer_mode_e { XFER_FUEL, XFER_PAYLOAD, XFER_ALL } xfer_mode_t;
 
 static XPLMCreateFlightLoop_t create_flight_loop =
@@ -96,18 +101,122 @@ static XPLMCreateFlightLoop_t create_flight_loop =
     .callbackFunc = flight_loop_cb
 };
 static XPLMFlightLoopID flight_loop_id;
+#define TASK_BUDGET_US 500  /* main thread work per frame */
+#define CLIPBOARD_TIMEOUT 2000
 
 static int dr_mapped;
 static int error_disabled;
 
 static char pref_path[512];
 static char pilot_id[20];
-static int flag_download_fms, flag_download_pdf, flag_upload_aspx;
+static int flag_download_fms, flag_download_pdf, flag_upload_aspx, flag_prefetch, flag_watch;
 static char pdf_download_dir[200];
+static char watch_dir[200];
+#define WATCH_TAKE_MS 500
 static char acf_file[256];
 static char acf_icao[41];
 static char msg_line_1[100], msg_line_2[100], msg_line_3[100];
 
+/* navdata index is loaded or built in the background, only stop cancels it */
+static tlsb_cancel_t nav_cancel;
+static pthread_t nav_thread;
+static int nav_thread_valid;
+static nav_route_t route_check;
+
+/* winds for the MCDU pages and at the FL selected in the widget */
+static XPWidgetID wind_fl_input;
+static char wind_clb[80], wind_des[80], wind_sel[80];
+static int wind_sel_fl = -1;
+static int route_check_n = -1;      /* # of waypoints, -1 = not checked */
+static int ofp_post_step;
+static char rwy_line[2][80];        /* departure, destination from apt.dat */
+static int rwy_ok[2];
+
+/* fuel on board against the plan, updated every frame while airborne */
+typedef enum { FM_OFF, FM_WAIT_GROUND, FM_GROUND, FM_AIRBORNE } fm_state_t;
+static tlsb_fuel_mon_t fuel_mon;
+static fm_state_t fm_state;
+static float fm_takeoff, fm_shown;      /* flight time */
+static char fm_line[60];
+
+/* progress along the navlog, updated every frame */
+static tlsb_track_t track;
+static float track_shown;               /* zulu time */
+static char track_line[80];
+static int flag_mem_view;               /* allocation counters in the widget */
+
+/* search in the OFP briefing, evaluated per keystroke */
+#define SEARCH_MAX_HITS 5
+static XPWidgetID search_input;
+static tlsb_search_t *search_idx;
+static char search_query[40];       /* of the hits shown */
+static int search_valid, search_n_hit;
+static tlsb_hit_t search_hit[SEARCH_MAX_HITS];
+
+/* routes and navlog in a scroll view, the row table is built once per OFP */
+#define VIEW_ROWS 8             /* visible */
+#define VIEW_MAX_ROWS (OFP_MAX_FIX + 60)
+#define VIEW_BRK 60             /* break routes to this # of chars */
+#define ROUTE_MAX_LINES 2       /* in the main view if the scroll view has it */
+enum { ROW_HDR, ROW_ROUTE, ROW_ALT_ROUTE, ROW_FIX };
+typedef struct {
+    short kind, len;
+    int ofs;                    /* into the text, fix # or heading # */
+} view_row_t;
+
+static tlsb_scroll_t *view;
+static view_row_t view_row[VIEW_MAX_ROWS];
+static int view_n_row;
+static const char *view_hdr[] = { "Route", "Alternate route", "Navlog: fix, via, stage, altitude, position" };
+
+/*
+ * Cancels all network activity on disable or stop. An enable after a disable
+ * gets a fresh token, a request still running from before keeps seeing its
+ * own cancelled. The retired ones are freed on stop.
+ */
+typedef struct plugin_cancel_s {
+    tlsb_cancel_t token;
+    struct plugin_cancel_s *retired;
+} plugin_cancel_t;
+static plugin_cancel_t plugin_cancel_first, *plugin_cancel = &plugin_cancel_first;
+
+/*
+ * OFP prefetched in the background when the aircraft is loaded. It is never
+ * handed out as is, the crew may generate a new one any time. It warms up
+ * dns, tcp and tls, and a fetch while it's in flight or within OFP_FRESH
+ * joins it in the single flight of tlsb_ofp_get_parse.
+ */
+static tlsb_cancel_t prefetch_cancel = { 0, &plugin_cancel_first.token };
+static pthread_t prefetch_thread;
+static int prefetch_running;    /* main thread only */
+static int prefetch_done;       /* set by the thread, atomic */
+static char prefetch_pilot_id[20];
+static ofp_info_t prefetch_info;
+
+/* fast path for fetch_xfer */
+enum { XFER_FETCHING, XFER_EARLY, XFER_PARSED, XFER_DONE };
+static tlsb_cancel_t xfer_cancel = { 0, &plugin_cancel_first.token };
+static pthread_t xfer_thread;
+static pthread_mutex_t xfer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int xfer_state;          /* protected by xfer_mutex */
+static int xfer_running, xfer_applied, xfer_accepted;  /* main thread only */
+static char xfer_pilot_id[20];
+static ofp_info_t xfer_info, xfer_early;
+static char xfer_msg_1[100], xfer_msg_2[100], xfer_msg_3[100];
+static int xfer_task(void *ctx);
+
+/* PDF and FMS downloads of fetch_ofp and the watch, in a thread */
+#define DL_POLL_MS 50
+static tlsb_cancel_t dl_cancel = { 0, &plugin_cancel_first.token };
+static pthread_t dl_thread;
+static int dl_running, dl_pending;  /* main thread only */
+static int dl_done;                 /* set by the thread, atomic */
+static int dl_pdf, dl_fms, dl_next_pdf, dl_next_fms;
+static ofp_info_t dl_info, dl_next;
+static char dl_msg_1[100], dl_msg_2[100], dl_msg_3[100];
+static int watch_on;        /* for the loaded aircraft, survives a disable */
+static void watch_update(void);
+
 
 static void
 map_datarefs()
@@ -136,19 +245,36 @@ err:
     log_msg("Can't map all datarefs, disabled");
 }
 
+/* queue main thread work, the flight loop runs it */
+static void
+task_add(const char *name, int prio, tlsb_task_fn_t fn, void *ctx, int delay_ms)
+{
+    if (tlsb_task_add(name, prio, fn, ctx, delay_ms) && flight_loop_id)
+        XPLMScheduleFlightLoop(flight_loop_id, -1, 1);
+}
+
+static int
+iscs_toggle_task(void *ctx)
+{
+    UNUSED(ctx);
+    log_msg("toggle iscs");
+    XPLMCommandOnce(iscs_cmdr);
+    return TLSB_TASK_DONE;
+}
+
 static void
-xfer_load_data(xfer_mode_t xfer_mode)
+xfer_load_data(const ofp_info_t *oi, xfer_mode_t xfer_mode)
 {
-    if (!ofp_info.valid)
+    if (!oi->valid)
         return;
 
     map_datarefs();
     if (error_disabled)
         return;
 
-    float fuel = atof(ofp_info.fuel_plan_ramp);
-    float freight = 0.5 * atof(ofp_info.freight);
-    if (0 == strcmp("lbs", ofp_info.units)) {
+    float fuel = atof(oi->fuel_plan_ramp);
+    float freight = 0.5 * atof(oi->freight);
+    if (0 == strcmp("lbs", oi->units)) {
         freight *= LB_2_KG;
         fuel *= LB_2_KG;
     }
@@ -161,7 +287,7 @@ xfer_load_data(xfer_mode_t xfer_mode)
     if (xfer_mode == XFER_ALL || xfer_mode == XFER_PAYLOAD) {
         log_msg("Xfer payload data to ISCS");
 
-        XPLMSetDatai(no_pax_dr, atoi(ofp_info.pax_count));
+        XPLMSetDatai(no_pax_dr, atoi(oi->pax_count));
         XPLMSetDataf(pax_distrib_dr, 0.5);
         XPLMSetDataf(fwd_cargo_dr, freight);
         XPLMSetDataf(aft_cargo_dr, freight);
@@ -175,7 +301,7 @@ xfer_load_data(xfer_mode_t xfer_mode)
         if (iscs_h > 0) {
             log_msg("ISCS is open");
             XPLMCommandOnce(iscs_cmdr);
-            XPLMScheduleFlightLoop(flight_loop_id, 0.2, 1);     /* delayed toggle */
+            task_add("iscs toggle", TLSB_PRIO_HIGH, iscs_toggle_task, NULL, 200);
         }
     }
 }
@@ -191,6 +317,8 @@ save_pref()
     putc((flag_download_pdf ? '1' : '0'), f); fputs(pdf_download_dir, f); putc('\n', f);
     putc((flag_download_fms ? '1' : '0'), f); putc('\n', f);
     putc((flag_upload_aspx ? '1' : '0'), f); putc('\n', f);
+    putc((flag_prefetch ? '1' : '0'), f); putc('\n', f);
+    putc((flag_watch ? '1' : '0'), f); fputs(watch_dir, f); putc('\n', f);
     fclose(f);
 }
 
@@ -224,76 +352,83 @@ load_pref()
 #else
     flag_upload_aspx = 0;
 #endif
+    fgetc(f); /* skip over \n */
+
+    if (EOF == (c = fgetc(f))) goto out;
+    flag_prefetch = (c == '1' ? 1 : 0);
+    fgetc(f); /* skip over \n */
+
+    if (EOF == (c = fgetc(f))) goto out;
+    flag_watch = (c == '1' ? 1 : 0);
+
+    if (NULL == fgets(watch_dir, sizeof(watch_dir), f)) goto out;
+    len = strlen(watch_dir);
+    if (len > 0 && '\n' == watch_dir[len - 1]) watch_dir[len - 1] = '\0';
+
   out:
     flag_upload_aspx &= flag_download_fms;
     fclose(f);
 }
 
 static void
-download_pdf()
+download_pdf(const ofp_info_t *oi, const tlsb_cancel_t *cancel, char *msg, int msg_len)
 {
-    char URL[300], fn[500];
-    FILE *f = NULL;
+    char URL[300], fn[500], key[200];
+    int changed;
 
-    snprintf(URL, sizeof(URL), "%s%s", ofp_info.sb_path, ofp_info.sb_pdf_link);
+    snprintf(URL, sizeof(URL), "%s%s", oi->sb_path, oi->sb_pdf_link);
     log_msg("URL '%s'", URL);
     snprintf(fn, sizeof(fn), "%s%ssb_ofp.pdf", pdf_download_dir, psep);
+    snprintf(key, sizeof(key), "%s|%s", oi->time_generated, oi->sb_pdf_link);
 
-    if (NULL == (f = fopen(fn, "wb"))) {
-        log_msg("Can't create file '%s'", fn);
-        goto err_out;
-    }
-
-    if (0 == tlsb_http_get(URL, f, NULL, 10)) {
+    /* goes to a temp file first so AVITAB never sees a truncated file */
+    if (0 == tlsb_cache_get(key, URL, fn, 10, &changed, cancel)) {
         log_msg("Can't download '%s'", URL);
-        goto err_out;
+        return;
     }
 
-    snprintf(msg_line_1, sizeof(msg_line_1), "OFP pdf in '%s'", fn);
-
-  err_out:
-    if (f) fclose(f);
+    snprintf(msg, msg_len, "OFP pdf in '%s'%s", fn, changed ? "" : " (unchanged)");
 }
 
 static void
-download_fms()
+download_fms(const ofp_info_t *oi, const tlsb_cancel_t *cancel, char *msg, char *asxp_msg,
+             int msg_len)
 {
-    char URL[300], fn[500];
-    FILE *f = NULL;
+    char URL[300], fn[500], key[200];
+    int changed;
 
-    snprintf(URL, sizeof(URL), "%s%s", ofp_info.sb_path, ofp_info.sb_fms_link);
-    log_msg("URL '%s'", URL);
-    snprintf(fn, sizeof(fn), "%s%s%s%s19.fms", fms_path, psep, ofp_info.origin, ofp_info.destination);
+    snprintf(fn, sizeof(fn), "%s%s%s%s19.fms", fms_path, psep, oi->origin, oi->destination);
 
-    if (NULL == (f = fopen(fn, "wb"))) {
-        log_msg("Can't create file '%s'", fn);
-        goto err_out;
-    }
+    /* written from the navlog, download only if that fails.
+       An unchanged file is not rewritten so the FMS does not reload it */
+    if (0 == tlsb_write_fms(oi, fn, &changed)) {
+        snprintf(URL, sizeof(URL), "%s%s", oi->sb_path, oi->sb_fms_link);
+        log_msg("URL '%s'", URL);
+        snprintf(key, sizeof(key), "%s|%s", oi->time_generated, oi->sb_fms_link);
 
-    if (0 == tlsb_http_get(URL, f, NULL, 10)) {
-        log_msg("Can't download '%s'", URL);
-        goto err_out;
+        if (0 == tlsb_cache_get(key, URL, fn, 10, &changed, cancel)) {
+            log_msg("Can't download '%s'", URL);
+            return;
+        }
     }
 
-    snprintf(msg_line_2, sizeof(msg_line_2), "FMS plan: '%s%s19'", ofp_info.origin, ofp_info.destination);
+    snprintf(msg, msg_len, "FMS plan: '%s%s19'%s", oi->origin, oi->destination,
+             changed ? "" : " (unchanged)");
 
 #ifdef UPLOAD_ASXP
     if (flag_upload_aspx) {
         snprintf(URL, sizeof(URL), "http://localhost:19285/ActiveSky/API/LoadFlightPlan?FileName=%s%s19.fms",
-                                   ofp_info.origin, ofp_info.destination);
+                                   oi->origin, oi->destination);
         log_msg("URL '%s'", URL);
 
         if (0 == tlsb_http_get(URL, NULL, NULL, 2)) {
             log_msg("Can't upload to ASXP '%s'", URL);
-            strcpy(msg_line_3, "Could not upload flightplan to ASXP");
+            snprintf(asxp_msg, msg_len, "Could not upload flightplan to ASXP");
         } else {
-            strcpy(msg_line_3, "Flightplan uploaded to ASXP");
+            snprintf(asxp_msg, msg_len, "Flightplan uploaded to ASXP");
         }
     }
 #endif
-
-  err_out:
-    if (f) fclose(f);
 }
 
 
@@ -341,6 +476,23 @@ show_widget(widget_ctx_t *ctx)
 }
 
 
+/* pick up the clipboard read started by the paste button */
+static int
+clipboard_task(void *ctx)
+{
+    UNUSED(ctx);
+    char tmp[sizeof(pdf_download_dir)];
+    int res = clipboard_poll(tmp, sizeof(tmp));
+    if (res == 0)
+        return 100;     /* poll again */
+
+    if (res > 0)
+        XPSetWidgetDescriptor(conf_downl_pdf_path, tmp);
+    else
+        log_msg("clipboard is empty or not available");
+    return TLSB_TASK_DONE;
+}
+
 static int
 conf_widget_cb(XPWidgetMessage msg, XPWidgetID widget_id, intptr_t param1, intptr_t param2)
 {
@@ -361,41 +513,384 @@ conf_widget_cb(XPWidgetMessage msg, XPWidgetID widget_id, intptr_t param1, intpt
         flag_upload_aspx = XPGetWidgetProperty(conf_upl_aspx_btn, xpProperty_ButtonState, NULL);
         flag_upload_aspx &= flag_download_fms;
 #endif
+        flag_prefetch = XPGetWidgetProperty(conf_prefetch_btn, xpProperty_ButtonState, NULL);
+        XPGetWidgetDescriptor(conf_watch_path, watch_dir, sizeof(watch_dir));
+        flag_watch = XPGetWidgetProperty(conf_watch_btn, xpProperty_ButtonState, NULL);
         save_pref();
+        watch_update();
         XPHideWidget(conf_widget);
         return 1;
     }
 
    if ((widget_id == conf_downl_pdf_paste_btn) && (msg == xpMsg_PushButtonPressed)) {
-       char tmp[sizeof (pdf_download_dir)];
-        if (get_clipboard(tmp, sizeof(pdf_download_dir))) {
-            XPSetWidgetDescriptor(conf_downl_pdf_path, tmp);
-        }
+        if (clipboard_start(CLIPBOARD_TIMEOUT))
+            task_add("clipboard", TLSB_PRIO_NORMAL, clipboard_task, NULL, 0);
         return 1;
     }
 
     return 0;
 }
 
-/* return success == 1 */
+/* runs in the prefetch thread */
+static void *
+prefetch_proc(void *arg)
+{
+    UNUSED(arg);
+    tlsb_ofp_get_parse(prefetch_pilot_id, &prefetch_info, &prefetch_cancel);
+    log_msg("prefetch done: %s", prefetch_info.status);
+    __atomic_store_n(&prefetch_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void
+prefetch_start(void)
+{
+    /* a finished one is just joined */
+    if (prefetch_running && __atomic_load_n(&prefetch_done, __ATOMIC_ACQUIRE)) {
+        pthread_join(prefetch_thread, NULL);
+        prefetch_running = 0;
+    }
+
+    if (prefetch_running || !flag_prefetch || '\0' == pilot_id[0])
+        return;
+
+    strcpy(prefetch_pilot_id, pilot_id);
+    memset(&prefetch_info, 0, sizeof(prefetch_info));
+    prefetch_cancel.cancelled = 0;
+    prefetch_done = 0;
+    if (0 == pthread_create(&prefetch_thread, NULL, prefetch_proc, NULL)) {
+        log_msg("prefetching OFP");
+        prefetch_running = 1;
+    }
+}
+
+/* cancel a running prefetch and wait for the thread */
+static void
+prefetch_stop(void)
+{
+    if (!prefetch_running)
+        return;
+
+    prefetch_cancel.cancelled = 1;
+    pthread_join(prefetch_thread, NULL);
+    prefetch_running = 0;
+    log_msg("prefetch stopped");
+}
+
+/* is the OFP for the loaded aircraft? */
 static int
-fetch_ofp(void)
+ofp_for_acf(const ofp_info_t *oi)
 {
-    msg_line_1[0] = msg_line_2[0] = msg_line_3[0] = '\0';
+    return (0 == strcmp(oi->aircraft_icao, acf_icao))
+        /* workaround for ToLiss A321 1.3: A21N reports as A321 */
+        || ((0 == strcmp(oi->aircraft_icao, "A21N")) && (0 == strcmp(acf_icao, "A321")));
+}
 
-    ofp_info.valid = 0;
+/* runway data from apt.dat for the widget, return 0 if the OFP does not match it */
+static int
+rwy_check(const char *icao, const char *rwy, const char *elevation, char *buf, int buflen)
+{
+    apt_info_t apt;
+
+    snprintf(buf, buflen, "%s/%s", icao, rwy);
+    if (!apt_lookup(icao, &apt))
+        return 1;       /* no data, nothing to check */
+
+    const apt_rwy_t *r = apt_runway(&apt, rwy);
+    if (NULL == r) {
+        snprintf(buf, buflen, "%s/%s not in apt.dat", icao, rwy);
+        return 0;
+    }
+
+    int len = snprintf(buf, buflen, "%s/%s %.0f m, %03.0f true, elev %d ft", icao, rwy,
+                       r->length - r->displaced, r->heading, apt.elevation);
+    if (abs(apt.elevation - atoi(elevation)) > 100) {
+        snprintf(buf + len, buflen - len, " (OFP: %s)", elevation);
+        return 0;
+    }
+    return 1;
+}
+
+static int
+view_row_fmt(int row, char *buf, int buflen, void *ctx)
+{
+    UNUSED(ctx);
+    const view_row_t *r = &view_row[row];
+
+    switch (r->kind) {
+        case ROW_HDR:
+            snprintf(buf, buflen, "%s", view_hdr[r->ofs]);
+            return 1;
+
+        case ROW_ROUTE:
+            snprintf(buf, buflen, "%.*s", r->len, ofp_info.route + r->ofs);
+            return 0;
+
+        case ROW_ALT_ROUTE:
+            snprintf(buf, buflen, "%.*s", r->len, ofp_info.alt_route + r->ofs);
+            return 0;
+    }
+
+    const ofp_fix_t *f = &ofp_info.navlog[r->ofs];
+    snprintf(buf, buflen, "%3d %-7s %-8s %-3s %6d  %c%05.2f %c%06.2f", r->ofs + 1, f->ident, f->via,
+             f->stage, f->altitude, f->lat < 0 ? 'S' : 'N', fabs(f->lat), f->lon < 0 ? 'W' : 'E', fabs(f->lon));
+    return 0;
+}
+
+static void
+view_add(int kind, int ofs, int len)
+{
+    if (view_n_row == VIEW_MAX_ROWS)
+        return;
+    view_row_t *r = &view_row[view_n_row++];
+    r->kind = kind;
+    r->ofs = ofs;
+    r->len = len;
+}
+
+/* text broken into rows at blanks */
+static void
+view_add_text(int kind, const char *text)
+{
+    int ofs = 0, len = strlen(text);
+
+    while (len - ofs > VIEW_BRK) {
+        int brk = ofs + VIEW_BRK;
+        while (brk > ofs && text[brk] != ' ')
+            brk--;
+        if (brk == ofs)
+            brk = ofs + VIEW_BRK;
+        view_add(kind, ofs, brk - ofs);
+        for (ofs = brk; text[ofs] == ' '; ofs++)
+            ;
+    }
+
+    if (len > ofs)
+        view_add(kind, ofs, len - ofs);
+}
+
+static void
+view_build(void)
+{
+    view_n_row = 0;
+    view_add(ROW_HDR, 0, 0);
+    view_add_text(ROW_ROUTE, ofp_info.route);
+
+    if (ofp_info.alt_route[0]) {
+        view_add(ROW_HDR, 1, 0);
+        view_add_text(ROW_ALT_ROUTE, ofp_info.alt_route);
+    }
+
+    if (ofp_info.n_fix > 0) {
+        view_add(ROW_HDR, 2, 0);
+        for (int i = 0; i < ofp_info.n_fix; i++)
+            view_add(ROW_FIX, i, 0);
+    }
 
-    tlsb_ofp_get_parse(pilot_id, &ofp_info);
+    if (view)
+        tlsb_scroll_set_rows(view, view_n_row, view_row_fmt, NULL);
+}
+
+/* derived data of an accepted OFP, one step per slice */
+static int
+ofp_post_task(void *ctx)
+{
+    UNUSED(ctx);
+    do {
+        long t0 = tlsb_now_ms();
+        switch (ofp_post_step++) {
+            case 0:
+                tlsb_wind_page(&ofp_info, "CLB", atoi(ofp_info.altitude), wind_clb, sizeof(wind_clb));
+                tlsb_wind_page(&ofp_info, "DSC", atoi(ofp_info.altitude), wind_des, sizeof(wind_des));
+                wind_sel_fl = -1;
+                break;
+
+            case 1:
+                route_check_n = nav_route_check(ofp_info.route, &route_check);
+                if (route_check_n >= 0)
+                    log_msg("route check: %d waypoints, unknown: '%s' in %ld ms", route_check_n,
+                            route_check.unknown, tlsb_now_ms() - t0);
+                break;
+
+            case 2:
+                rwy_ok[0] = rwy_check(ofp_info.origin, ofp_info.origin_rwy, ofp_info.origin_elevation,
+                                      rwy_line[0], sizeof(rwy_line[0]));
+                rwy_ok[1] = rwy_check(ofp_info.destination, ofp_info.destination_rwy,
+                                      ofp_info.destination_elevation, rwy_line[1], sizeof(rwy_line[1]));
+                log_msg("runway check: '%s', '%s'", rwy_line[0], rwy_line[1]);
+                break;
+
+            /* for EFB apps, scripts and other plugins */
+            case 3:
+                tlsb_shm_publish(&ofp_info);
+                break;
+
+            case 4:
+                tlsb_dref_publish(&ofp_info);
+                break;
+
+            case 5:
+                view_build();
+                return TLSB_TASK_DONE;
+        }
+    } while (tlsb_task_time_left() > 0);
+
+    return TLSB_TASK_AGAIN;
+}
+
+/* compare fuel on board with the plan from takeoff to landing */
+static int
+fuel_mon_task(void *ctx)
+{
+    UNUSED(ctx);
+    int on_ground = XPLMGetDatai(on_ground_dr);
+    float now = XPLMGetDataf(flight_time_dr);
+
+    switch (fm_state) {
+        case FM_WAIT_GROUND:    /* the OFP came in flight, no takeoff time */
+            if (on_ground)
+                fm_state = FM_GROUND;
+            return TLSB_TASK_AGAIN;
+
+        case FM_GROUND:
+            if (on_ground)
+                return TLSB_TASK_AGAIN;
+            fm_state = FM_AIRBORNE;
+            fm_takeoff = now;
+            fm_shown = -1.0f;
+            log_msg("fuel monitor: takeoff");
+            break;
+
+        case FM_AIRBORNE:
+            if (on_ground) {
+                log_msg("fuel monitor: landed, %s", fm_line);
+                fm_state = FM_OFF;
+                return TLSB_TASK_DONE;
+            }
+            break;
+
+        default:
+            return TLSB_TASK_DONE;
+    }
+
+    tlsb_fuel_update(&fuel_mon, now - fm_takeoff, XPLMGetDataf(fuel_total_dr));
+
+    /* the text once per second */
+    if (now - fm_shown >= 1.0f || now < fm_shown) {
+        fm_shown = now;
+        float to_units = (0 == strcmp("lbs", ofp_info.units)) ? 1.0f / LB_2_KG : 1.0f;
+        int len = snprintf(fm_line, sizeof(fm_line), "%+.0f", fuel_mon.delta * to_units);
+        if (fuel_mon.trend_valid)
+            snprintf(fm_line + len, sizeof(fm_line) - len, " %+.0f/h", fuel_mon.trend * to_units);
+    }
+    return TLSB_TASK_AGAIN;
+}
+
+static void
+fuel_mon_stop(void)
+{
+    tlsb_task_remove(fuel_mon_task, NULL);
+    fm_state = FM_OFF;
+    fm_line[0] = '\0';
+}
+
+static void
+fuel_mon_start(void)
+{
+    fuel_mon_stop();
+    if (NULL == fuel_total_dr || NULL == on_ground_dr || NULL == flight_time_dr
+        || tlsb_fuel_plan(&fuel_mon, &ofp_info) < 2)
+        return;
+
+    fm_state = XPLMGetDatai(on_ground_dr) ? FM_GROUND : FM_WAIT_GROUND;
+    task_add("fuel monitor", TLSB_PRIO_LOW, fuel_mon_task, NULL, 0);
+}
+
+/* ident of a track point */
+static const char *
+track_ident(int pt)
+{
+    int i = track.fix[pt];
+    if (-2 == i)
+        return ofp_info.destination;
+    return i < 0 ? ofp_info.origin : ofp_info.navlog[i].ident;
+}
+
+/* current leg, distance to go, ETA and fuel at destination */
+static int
+track_task(void *ctx)
+{
+    UNUSED(ctx);
+    int leg = tlsb_track_update(&track, XPLMGetDatad(lat_dr), XPLMGetDatad(lon_dr),
+                                XPLMGetDataf(fuel_total_dr));
+    if (leg < 0)
+        return TLSB_TASK_DONE;
+
+    /* the text once per second */
+    float now = XPLMGetDataf(zulu_time_dr);
+    if (fabsf(now - track_shown) < 1.0f)
+        return TLSB_TASK_AGAIN;
+    track_shown = now;
+
+    int len = snprintf(track_line, sizeof(track_line), "%.7s-%.7s %.0f nm  %.0f nm",
+                       track_ident(leg), track_ident(leg + 1), track.next_nm, track.togo_nm);
+
+    float gs_kt = XPLMGetDataf(gs_dr) * 1.943844f;
+    if (gs_kt > 50.0f) {
+        int eta_min = (int)((now + 3600.0f * track.togo_nm / gs_kt) / 60.0f) % (24 * 60);
+        len += snprintf(track_line + len, sizeof(track_line) - len, "  ETA %02d%02dZ",
+                        eta_min / 60, eta_min % 60);
+    }
+
+    if (track.efob >= 0.0f && len < (int)sizeof(track_line)) {
+        float to_units = (0 == strcmp("lbs", ofp_info.units)) ? 1.0f / LB_2_KG : 1.0f;
+        snprintf(track_line + len, sizeof(track_line) - len, "  EFOB %.0f", track.efob * to_units);
+    }
+    return TLSB_TASK_AGAIN;
+}
+
+static void
+track_stop(void)
+{
+    tlsb_task_remove(track_task, NULL);
+    track_line[0] = '\0';
+}
+
+static void
+track_start(void)
+{
+    track_stop();
+    if (NULL == lat_dr || NULL == lon_dr || NULL == gs_dr || NULL == zulu_time_dr
+        || NULL == fuel_total_dr || 0 == tlsb_track_init(&track, &ofp_info))
+        return;
+
+    track_shown = -10.0f;
+    task_add("route progress", TLSB_PRIO_LOW, track_task, NULL, 0);
+}
+
+/* check and display a freshly fetched ofp_info, return success == 1 */
+static int
+accept_ofp(void)
+{
     tlsb_dump_ofp_info(&ofp_info);
+    tlsb_task_remove(ofp_post_task, NULL);
+    fuel_mon_stop();
+    track_stop();
+    rwy_line[0][0] = rwy_line[1][0] = '\0';
+    wind_clb[0] = wind_des[0] = '\0';
+    tlsb_search_release(search_idx);
+    search_idx = NULL;
+    search_valid = 0;
+    view_n_row = 0;
+    if (view)
+        tlsb_scroll_set_rows(view, 0, view_row_fmt, NULL);
 
     if (strcmp(ofp_info.status, "Success")) {
         XPSetWidgetDescriptor(status_line, ofp_info.status);
         return 0; // error
     }
 
-    if ((0 == strcmp(ofp_info.aircraft_icao, acf_icao))
-        /* workaround for ToLiss A321 1.3: A21N reports as A321 */
-        || ((0 == strcmp(ofp_info.aircraft_icao, "A21N")) && (0 == strcmp(acf_icao, "A321")))) {
+    if (ofp_for_acf(&ofp_info)) {
         time_t tg = atol(ofp_info.time_generated);
         struct tm tm;
     #ifdef WINDOWS
@@ -411,15 +906,17 @@ fetch_ofp(void)
 
         XPSetWidgetDescriptor(status_line, line);
         ofp_info.valid = 1;
+        search_idx = tlsb_search_get(ofp_info.time_generated);
         snprintf(ofp_info.altitude, sizeof(ofp_info.altitude), "%d", atoi(ofp_info.altitude) / 100);
 
-        if (flag_download_pdf)
-            download_pdf();
+        fuel_mon_start();
+        track_start();
 
-        if (flag_download_fms)
-            download_fms();
+        /* the rest is done sliced over the next frames */
+        ofp_post_step = 0;
+        task_add("ofp post", TLSB_PRIO_LOW, ofp_post_task, NULL, 0);
         return 1;
-        }
+    }
 
     char line[100];
     sprintf(line, "OFP is not for %s", acf_file);
@@ -428,16 +925,310 @@ fetch_ofp(void)
     return 0;
 }
 
+static void *
+dl_proc(void *arg)
+{
+    UNUSED(arg);
+    if (dl_pdf)
+        download_pdf(&dl_info, &dl_cancel, dl_msg_1, sizeof(dl_msg_1));
+
+    if (dl_fms)
+        download_fms(&dl_info, &dl_cancel, dl_msg_2, dl_msg_3, sizeof(dl_msg_2));
+
+    __atomic_store_n(&dl_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void
+dl_launch(void)
+{
+    memcpy(&dl_info, &dl_next, sizeof(dl_info));
+    dl_pdf = dl_next_pdf;
+    dl_fms = dl_next_fms;
+    dl_msg_1[0] = dl_msg_2[0] = dl_msg_3[0] = '\0';
+    dl_cancel.cancelled = 0;
+    dl_done = 0;
+    dl_running = (0 == pthread_create(&dl_thread, NULL, dl_proc, NULL));
+    if (!dl_running)
+        log_msg("can't create download thread");
+}
+
+/* follow the download thread, its messages go to the widget when done */
 static int
-format_route(float *bg_color, char *rptr, int right_col, int y)
+dl_task(void *ctx)
+{
+    UNUSED(ctx);
+    if (!__atomic_load_n(&dl_done, __ATOMIC_ACQUIRE))
+        return DL_POLL_MS;
+
+    pthread_join(dl_thread, NULL);
+    dl_running = 0;
+
+    /* superseded by a newer OFP */
+    if (dl_pending) {
+        dl_pending = 0;
+        dl_launch();
+        return dl_running ? DL_POLL_MS : TLSB_TASK_DONE;
+    }
+
+    /* a cancelled download's messages would overwrite a newer fetch's */
+    if (!dl_cancel.cancelled) {
+        strcpy(msg_line_1, dl_msg_1);
+        strcpy(msg_line_2, dl_msg_2);
+        strcpy(msg_line_3, dl_msg_3);
+    }
+    return TLSB_TASK_DONE;
+}
+
+/* a download in flight is cancelled and replaced, the flight loop never waits for it */
+static void
+dl_start(const ofp_info_t *oi, int pdf, int fms)
+{
+    if (!pdf && !fms)
+        return;
+
+    memcpy(&dl_next, oi, sizeof(dl_next));
+    dl_next_pdf = pdf;
+    dl_next_fms = fms;
+
+    if (dl_running) {
+        dl_cancel.cancelled = 1;
+        dl_pending = 1;
+        return;
+    }
+
+    dl_launch();
+    if (dl_running)
+        task_add("downloads", TLSB_PRIO_NORMAL, dl_task, NULL, DL_POLL_MS);
+}
+
+static void
+dl_stop(void)
+{
+    tlsb_task_remove(dl_task, NULL);
+    dl_pending = 0;
+    if (!dl_running)
+        return;
+
+    dl_cancel.cancelled = 1;
+    pthread_join(dl_thread, NULL);
+    dl_running = 0;
+    log_msg("downloads stopped");
+}
+
+/* return success == 1 */
+static int
+fetch_ofp(void)
+{
+    /* attach to fetch_xfer, it takes its result to the widget */
+    if (xfer_running) {
+        log_msg("attaching to fetch_xfer in flight");
+        XPSetWidgetDescriptor(status_line, "Fetch in progress");
+        return 0;
+    }
+
+    msg_line_1[0] = msg_line_2[0] = msg_line_3[0] = '\0';
+
+    ofp_info.valid = 0;
+    route_check_n = -1;
+
+    tlsb_ofp_get_parse(pilot_id, &ofp_info, &plugin_cancel->token);
+    tlsb_http_log_stats();
+    tlsb_mem_log_stats();
+
+    if (!accept_ofp())
+        return 0;
+
+    dl_start(&ofp_info, flag_download_pdf, flag_download_fms);
+    return 1;
+}
+
+/* an OFP written to the watch directory goes to the widget */
+static int
+watch_task(void *ctx)
+{
+    UNUSED(ctx);
+    char fn[100];
+
+    /* fetch_xfer takes the widget, try again later */
+    if (xfer_running || !tlsb_watch_take(&ofp_info, fn, sizeof(fn)))
+        return WATCH_TAKE_MS;
+
+    log_msg("loading OFP from '%s'", fn);
+    create_widget();
+    msg_line_1[0] = msg_line_2[0] = msg_line_3[0] = '\0';
+    route_check_n = -1;
+    ofp_info.valid = 0;
+    if (accept_ofp())
+        dl_start(&ofp_info, 0, flag_download_fms);
+    show_widget(&getofp_widget_ctx);
+    return WATCH_TAKE_MS;
+}
+
+/* start or stop the watch according to the preferences */
+static void
+watch_update(void)
+{
+    tlsb_watch_stop();
+    tlsb_task_remove(watch_task, NULL);
+    watch_on = (flag_watch && tlsb_watch_start(watch_dir));
+    if (watch_on)
+        task_add("watch", TLSB_PRIO_LOW, watch_task, NULL, WATCH_TAKE_MS);
+}
+
+/*
+ * Fast path for fetch_xfer.
+ * The OFP is fetched in a thread and fuel and payload go to the ISCS as soon as
+ * they are parsed. The flight loop takes over the complete OFP later while the
+ * thread continues with the downloads.
+ */
+static void
+xfer_set_state(int state)
+{
+    pthread_mutex_lock(&xfer_mutex);
+    xfer_state = state;
+    pthread_mutex_unlock(&xfer_mutex);
+}
+
+/* runs in the xfer thread */
+static void
+xfer_early_cb(const ofp_info_t *oi, void *ctx)
+{
+    UNUSED(ctx);
+    memcpy(&xfer_early, oi, sizeof(xfer_early));
+    xfer_set_state(XFER_EARLY);
+}
+
+static void *
+xfer_proc(void *arg)
+{
+    UNUSED(arg);
+    tlsb_ofp_get_parse_early(xfer_pilot_id, &xfer_info, &xfer_cancel, xfer_early_cb, NULL);
+    tlsb_http_log_stats();
+    tlsb_mem_log_stats();
+
+    xfer_set_state(XFER_PARSED);
+
+    if (0 == strcmp(xfer_info.status, "Success") && ofp_for_acf(&xfer_info)) {
+        if (flag_download_pdf)
+            download_pdf(&xfer_info, &xfer_cancel, xfer_msg_1, sizeof(xfer_msg_1));
+
+        if (flag_download_fms)
+            download_fms(&xfer_info, &xfer_cancel, xfer_msg_2, xfer_msg_3, sizeof(xfer_msg_2));
+    }
+
+    xfer_set_state(XFER_DONE);
+    return NULL;
+}
+
+static void
+xfer_start(void)
+{
+    if (xfer_running) {
+        log_msg("fetch_xfer is already running");
+        return;
+    }
+
+    strcpy(xfer_pilot_id, pilot_id);
+    memset(&xfer_info, 0, sizeof(xfer_info));
+    xfer_msg_1[0] = xfer_msg_2[0] = xfer_msg_3[0] = '\0';
+    xfer_state = XFER_FETCHING;
+    xfer_applied = xfer_accepted = 0;
+    xfer_cancel.cancelled = 0;
+
+    /* the xfer writes its own files, let a running download wind down */
+    dl_pending = 0;
+    if (dl_running)
+        dl_cancel.cancelled = 1;
+
+    if (0 != pthread_create(&xfer_thread, NULL, xfer_proc, NULL)) {
+        log_msg("can't create xfer thread");
+        return;
+    }
+
+    xfer_running = 1;
+    task_add("fetch_xfer", TLSB_PRIO_HIGH, xfer_task, NULL, 0);
+}
+
+/* follow the xfer thread from the flight loop */
+static int
+xfer_task(void *ctx)
+{
+    UNUSED(ctx);
+    pthread_mutex_lock(&xfer_mutex);
+    int state = xfer_state;
+    pthread_mutex_unlock(&xfer_mutex);
+
+    if (state == XFER_FETCHING)
+        return TLSB_TASK_AGAIN;
+
+    if (!xfer_applied) {
+        xfer_applied = 1;
+        ofp_info_t *oi = (state == XFER_EARLY ? &xfer_early : &xfer_info);
+        oi->valid = (0 == strcmp(oi->status, "Success") && ofp_for_acf(oi));
+        xfer_load_data(oi, XFER_ALL);
+    }
+
+    if (state >= XFER_PARSED && !xfer_accepted) {
+        xfer_accepted = 1;
+        msg_line_1[0] = msg_line_2[0] = msg_line_3[0] = '\0';
+        route_check_n = -1;
+        memcpy(&ofp_info, &xfer_info, sizeof(ofp_info));
+        ofp_info.valid = 0;
+        if (0 == accept_ofp()) {
+            /* error, show widget */
+            create_widget();
+            show_widget(&getofp_widget_ctx);
+        }
+    }
+
+    if (state < XFER_DONE)
+        return TLSB_TASK_AGAIN;
+
+    pthread_join(xfer_thread, NULL);
+    xfer_running = 0;
+    if (ofp_info.valid) {
+        strcpy(msg_line_1, xfer_msg_1);
+        strcpy(msg_line_2, xfer_msg_2);
+        strcpy(msg_line_3, xfer_msg_3);
+    }
+    return TLSB_TASK_DONE;
+}
+
+/* cancel a running fast fetch_xfer and wait for the thread */
+static void
+xfer_stop(void)
+{
+    if (!xfer_running)
+        return;
+
+    xfer_cancel.cancelled = 1;
+    pthread_join(xfer_thread, NULL);
+    tlsb_task_remove(xfer_task, NULL);
+    xfer_running = 0;
+    log_msg("fetch_xfer stopped");
+}
+
+static int
+format_route(float *bg_color, char *rptr, int right_col, int y, int max_lines)
 {
     /* break route to this # of chars */
 #define ROUTE_BRK 50
+    int lines = 1;
     while (1) {
         int len = strlen(rptr);
         if (len <= ROUTE_BRK)
             break;
 
+        /* the rest is in the scroll view */
+        if (lines == max_lines) {
+            char buf[ROUTE_BRK + 5];
+            snprintf(buf, sizeof(buf), "%.*s ...", ROUTE_BRK - 4, rptr);
+            XPLMDrawString(bg_color, right_col, y, buf, NULL, xplmFont_Basic);
+            return y;
+        }
+        lines++;
+
         /* find last blank < line length */
         char c = rptr[ROUTE_BRK];
         rptr[ROUTE_BRK] = '\0';
@@ -487,17 +1278,17 @@ getofp_widget_cb(XPWidgetMessage msg, XPWidgetID widget_id, intptr_t param1, int
     }
 
     if ((widget_id == xfer_all_btn) && (msg == xpMsg_PushButtonPressed)) {
-        xfer_load_data(XFER_ALL);
+        xfer_load_data(&ofp_info, XFER_ALL);
         return 1;
     }
 
     if ((widget_id == xfer_fuel_btn) && (msg == xpMsg_PushButtonPressed)) {
-        xfer_load_data(XFER_FUEL);
+        xfer_load_data(&ofp_info, XFER_FUEL);
         return 1;
     }
 
     if ((widget_id == xfer_payload_btn) && (msg == xpMsg_PushButtonPressed)) {
-        xfer_load_data(XFER_PAYLOAD);
+        xfer_load_data(&ofp_info, XFER_PAYLOAD);
         return 1;
     }
 
@@ -533,18 +1324,65 @@ getofp_widget_cb(XPWidgetMessage msg, XPWidgetID widget_id, intptr_t param1, int
         DL(0, "Pax:"); DX(0, pax_count);
         DL(0, "Cargo:"); DX(0, freight);
         DL(0, "Fuel:"); DX(0, fuel_plan_ramp);
+        if (fm_line[0]) {
+            DL(1, "vs plan:"); DS(1, fm_line);
+        }
+        if (track_line[0]) {
+            DL(0, "Progress:"); DS(0, track_line);
+        }
+        if (flag_mem_view) {
+            tlsb_mem_stat_t st, fetch_mem;
+            char line[128];
+            tlsb_mem_get(TLSB_MEM_N, &st);
+            tlsb_ofp_mem_stat(&fetch_mem);
+            snprintf(line, sizeof(line), "%ld kB live, peak %ld kB, fetch %ld kB peak %ld kB",
+                     st.live / 1024, st.peak / 1024, fetch_mem.bytes / 1024, fetch_mem.peak / 1024);
+            DL(0, "Memory:"); DS(0, line);
+
+            int n = 0;
+            line[0] = '\0';
+            for (int i = 0; i < TLSB_MEM_N && n < (int)sizeof(line); i++) {
+                tlsb_mem_get(i, &st);
+                if (st.live >= 1024)
+                    n += snprintf(line + n, sizeof(line) - n, "%s %ld  ", tlsb_mem_name(i), st.live / 1024);
+            }
+            DL(0, ""); DS(0, line);
+        }
         // D(right_col, payload);
 
         y -= 30;
 
+        static float warn_color[] = { 0.7, 0.0, 0.0 };
+
         // D(aircraft_icao);
-        snprintf(str, sizeof(str), "%s/%s", ofp_info.origin, ofp_info.origin_rwy);
-        DL(0, "Departure:"); DS(0, str);
-        snprintf(str, sizeof(str), "%s/%s", ofp_info.destination, ofp_info.destination_rwy);
-        DL(0, "Destination:"); DS(0, str);
+        DL(0, "Departure:");
+        if (rwy_line[0][0]) {
+            XPLMDrawString(rwy_ok[0] ? bg_color : warn_color, right_col[0], y, rwy_line[0], NULL, xplmFont_Basic);
+        } else {
+            snprintf(str, sizeof(str), "%s/%s", ofp_info.origin, ofp_info.origin_rwy);
+            DS(0, str);
+        }
+        DL(0, "Destination:");
+        if (rwy_line[1][0]) {
+            XPLMDrawString(rwy_ok[1] ? bg_color : warn_color, right_col[0], y, rwy_line[1], NULL, xplmFont_Basic);
+        } else {
+            snprintf(str, sizeof(str), "%s/%s", ofp_info.destination, ofp_info.destination_rwy);
+            DS(0, str);
+        }
         DL(0, "Route:");
 
-        y = format_route(bg_color, ofp_info.route, right_col[0], y);
+        y = format_route(bg_color, ofp_info.route, right_col[0], y, view_n_row ? ROUTE_MAX_LINES : 0);
+
+        if (route_check_n >= 0) {
+            DL(0, "Navdata:");
+            if (route_check.n_unknown) {
+                snprintf(str, sizeof(str), "unknown: %.60s", route_check.unknown);
+                XPLMDrawString(warn_color, right_col[0], y, str, NULL, xplmFont_Basic);
+            } else {
+                snprintf(str, sizeof(str), "%d waypoints, all found", route_check_n);
+                DS(0, str);
+            }
+        }
 
         DL(0, "Trip time");
         if (ofp_info.est_time_enroute[0]) {
@@ -573,13 +1411,78 @@ getofp_widget_cb(XPWidgetMessage msg, XPWidgetID widget_id, intptr_t param1, int
             snprintf(str, sizeof(str), "P%03d", wind_component);
         DL(0, "WC:"); DS(0, str);
 
+        if (ofp_info.n_wind_lvl > 0) {
+            DL(0, "CLB winds:"); DS(0, wind_clb);
+            DL(0, "DES winds:"); DS(0, wind_des);
+
+            /* recomputed only when the FL changes */
+            char buf[10];
+            XPGetWidgetDescriptor(wind_fl_input, buf, sizeof(buf));
+            int fl = atoi(buf);
+            if (fl <= 0)
+                fl = atoi(ofp_info.altitude);
+
+            if (fl != wind_sel_fl) {
+                static const char *stage[3] = { "CLB", "CRZ", "DSC" };
+                static const char *label[3] = { "CLB", "CRZ", "DES" };
+                int len = 0;
+                wind_sel_fl = fl;
+                wind_sel[0] = '\0';
+                for (int i = 0; i < 3; i++) {
+                    int dir, spd, oat;
+                    if (tlsb_wind_at(&ofp_info, stage[i], fl, &dir, &spd, &oat))
+                        len += snprintf(wind_sel + len, sizeof(wind_sel) - len, "%s %03d/%03d %c%02d  ",
+                                        label[i], dir, spd, oat < 0 ? 'M' : 'P', abs(oat));
+                    if (len >= (int)sizeof(wind_sel))
+                        break;
+                }
+            }
+
+            snprintf(str, sizeof(str), "FL%03d:", fl);
+            DL(0, str); DS(0, wind_sel);
+        }
+
         y -= 5;
 
         DL(0, "Alternate:"); DF(0, alternate);
         DL(0, "Alt Route:");
-        y = format_route(bg_color, ofp_info.alt_route, right_col[0], y);
+        y = format_route(bg_color, ofp_info.alt_route, right_col[0], y, view_n_row ? ROUTE_MAX_LINES : 0);
         y -= 5;
 
+        if (search_idx) {
+            char query[sizeof(search_query)];
+            XPGetWidgetDescriptor(search_input, query, sizeof(query));
+            if (!search_valid || strcmp(query, search_query)) {
+                const char *alias[] = {
+                    "ORIGIN", ofp_info.origin, "DEPARTURE", ofp_info.origin,
+                    "DESTINATION", ofp_info.destination, "ALTERNATE", ofp_info.alternate, NULL
+                };
+                search_n_hit = query[0] ?
+                    tlsb_search_query(search_idx, query, alias, search_hit, SEARCH_MAX_HITS) : 0;
+                strcpy(search_query, query);
+                search_valid = 1;
+            }
+
+            if (search_query[0]) {
+                snprintf(str, sizeof(str), "%d hits", search_n_hit);
+                DL(0, "Briefing:"); DS(0, str);
+
+                const char *text = tlsb_search_text(search_idx);
+                for (int i = 0; i < search_n_hit && i < SEARCH_MAX_HITS; i++) {
+                    const char *s = text + search_hit[i].ofs;
+                    int len = search_hit[i].len;
+                    while (len > 0 && *s == ' ') {
+                        s++;
+                        len--;
+                    }
+                    snprintf(str, sizeof(str), "%.*s", len, s);
+                    y -= 15;
+                    XPLMDrawString(bg_color, left_col[0] + 10, y, str, NULL, xplmFont_Basic);
+                }
+            }
+            y -= 5;
+        }
+
         if (msg_line_1[0]) {
             y -= 15;
             XPLMDrawString(bg_color, left_col[0], y, msg_line_1, NULL, xplmFont_Proportional);
@@ -595,6 +1498,10 @@ getofp_widget_cb(XPWidgetMessage msg, XPWidgetID widget_id, intptr_t param1, int
             XPLMDrawString(bg_color, left_col[0], y, msg_line_3, NULL, xplmFont_Proportional);
         }
 
+        int view_h = view ? tlsb_scroll_place(view, left_col[0], y - 10, right - 5) : 0;
+        if (view_h)
+            y -= view_h + 10;
+
         /* adjust height of window */
         y -= 10;
 
@@ -657,6 +1564,21 @@ create_widget()
                               1, "", 0, getofp_widget, xpWidgetClass_Caption);
 
     top -= 20;
+    /* on the row of the fetch button */
+    XPCreateWidget(left + width - 135, top + 45, left + width - 70, top + 25,
+                   1, "Wind FL:", 0, getofp_widget, xpWidgetClass_Caption);
+    wind_fl_input = XPCreateWidget(left + width - 70, top + 43, left + width - 30, top + 28,
+                                   1, "", 0, getofp_widget, xpWidgetClass_TextField);
+    XPSetWidgetProperty(wind_fl_input, xpProperty_TextFieldType, xpTextEntryField);
+    XPSetWidgetProperty(wind_fl_input, xpProperty_MaxCharacters, 3);
+
+    XPCreateWidget(left1 + 75, top + 45, left1 + 105, top + 25,
+                   1, "Find:", 0, getofp_widget, xpWidgetClass_Caption);
+    search_input = XPCreateWidget(left1 + 105, top + 43, left1 + 245, top + 28,
+                                  1, "", 0, getofp_widget, xpWidgetClass_TextField);
+    XPSetWidgetProperty(search_input, xpProperty_TextFieldType, xpTextEntryField);
+    XPSetWidgetProperty(search_input, xpProperty_MaxCharacters, sizeof(search_query) - 1);
+
     display_widget = XPCreateCustomWidget(left + 10, top, left + width -20, top - height + 10,
                                            1, "", 0, getofp_widget, getofp_widget_cb);
     top -= 50;
@@ -674,6 +1596,10 @@ create_widget()
     xfer_all_btn = XPCreateWidget(left1, top, left1 + 150, top - 30,
                               1, "Xfer Load data to ISCS", 0, getofp_widget, xpWidgetClass_Button);
     XPAddWidgetCallback(xfer_all_btn, getofp_widget_cb);
+
+    view = tlsb_scroll_create(getofp_widget, VIEW_ROWS);
+    if (view)
+        tlsb_scroll_set_rows(view, view_n_row, view_row_fmt, NULL);
 }
 
 static void
@@ -686,15 +1612,21 @@ menu_cb(void *menu_ref, void *item_ref)
         return;
     }
 
+    if (item_ref == &flag_mem_view) {
+        flag_mem_view = !flag_mem_view;
+        tlsb_mem_log_stats();
+        return;
+    }
+
     if (item_ref == &conf_widget) {
         if (NULL == conf_widget) {
             int left = 250;
             int top = 780;
             int width = 500;
 #ifdef UPLOAD_ASXP
-            int height = 220;
+            int height = 300;
 #else
-             int height = 180;
+            int height = 260;
 #endif
 
             conf_widget_ctx.l = left;
@@ -757,6 +1689,29 @@ menu_cb(void *menu_ref, void *item_ref)
             XPSetWidgetProperty(conf_upl_aspx_btn, xpProperty_ButtonBehavior, xpButtonBehaviorCheckBox);
 #endif
 
+            top -= 20;
+            XPCreateWidget(left, top, left + width - 10, top - 20,
+                                      1, "Prefetch OFP when the aircraft is loaded", 0, conf_widget, xpWidgetClass_Caption);
+            top -= 20;
+            conf_prefetch_btn = XPCreateWidget(left, top, left + 20, top - 20,
+                                      1, "", 0, conf_widget, xpWidgetClass_Button);
+            XPSetWidgetProperty(conf_prefetch_btn, xpProperty_ButtonType, xpRadioButton);
+            XPSetWidgetProperty(conf_prefetch_btn, xpProperty_ButtonBehavior, xpButtonBehaviorCheckBox);
+
+            top -= 20;
+            XPCreateWidget(left, top, left + width - 10, top - 20,
+                                      1, "Load OFP xml files written to directory", 0, conf_widget, xpWidgetClass_Caption);
+            top -= 20;
+            conf_watch_btn = XPCreateWidget(left, top, left + 20, top - 20,
+                                      1, "", 0, conf_widget, xpWidgetClass_Button);
+            XPSetWidgetProperty(conf_watch_btn, xpProperty_ButtonType, xpRadioButton);
+            XPSetWidgetProperty(conf_watch_btn, xpProperty_ButtonBehavior, xpButtonBehaviorCheckBox);
+
+            conf_watch_path = XPCreateWidget(left1, top, left2, top - 15,
+                                            1, "", 0, conf_widget, xpWidgetClass_TextField);
+            XPSetWidgetProperty(conf_watch_path, xpProperty_TextFieldType, xpTextEntryField);
+            XPSetWidgetProperty(conf_watch_path, xpProperty_MaxCharacters, sizeof(watch_dir) -1);
+
             top -= 30;
             conf_ok_btn = XPCreateWidget(left + 10, top, left + 140, top - 30,
                                       1, "OK", 0, conf_widget, xpWidgetClass_Button);
@@ -767,6 +1722,9 @@ menu_cb(void *menu_ref, void *item_ref)
         XPSetWidgetDescriptor(conf_downl_pdf_path, pdf_download_dir);
         XPSetWidgetProperty(conf_downl_pdf_btn, xpProperty_ButtonState, flag_download_pdf);
         XPSetWidgetProperty(conf_downl_fpl_btn, xpProperty_ButtonState, flag_download_fms);
+        XPSetWidgetProperty(conf_prefetch_btn, xpProperty_ButtonState, flag_prefetch);
+        XPSetWidgetDescriptor(conf_watch_path, watch_dir);
+        XPSetWidgetProperty(conf_watch_btn, xpProperty_ButtonState, flag_watch);
 
 #ifdef UPLOAD_ASXP
         XPSetWidgetProperty(conf_upl_aspx_btn, xpProperty_ButtonState, flag_upload_aspx);
@@ -802,14 +1760,8 @@ fetch_xfer_cmd_cb(XPLMCommandRef cmdr, XPLMCommandPhase phase, void *ref)
 
     log_msg("fetch_xfer cmd called");
 
-    if (0 == fetch_ofp()) {
-        /* error, show widget */
-        create_widget();
-        show_widget(&getofp_widget_ctx);
-        return 0;
-    }
-
-    xfer_load_data(XFER_ALL);
+    /* the ISCS is loaded from the flight loop, errors show the widget */
+    xfer_start();
     return 0;
 }
 
@@ -833,13 +1785,24 @@ toggle_cmd_cb(XPLMCommandRef cmdr, XPLMCommandPhase phase, void *ref)
     return 0;
 }
 
-/* flight loop for delayed actions */
+static void *
+nav_proc(void *arg)
+{
+    nav_init(xpdir, cache_dir, &nav_cancel);
+    apt_init(xpdir, cache_dir, &nav_cancel);
+    return NULL;
+}
+
+/* flight loop runs the main thread task queue */
 static float
 flight_loop_cb(float unused1, float unused2, int unused3, void *unused4)
 {
-    log_msg("flight loop: toggle iscs");
-    XPLMCommandOnce(iscs_cmdr);
-    return 0; /* unschedule */
+    int next_ms = tlsb_task_run(TASK_BUDGET_US);
+    if (next_ms < 0)
+        return 0;       /* unschedule */
+    if (next_ms == 0)
+        return -1;      /* next frame */
+    return next_ms / 1000.0f;
 }
 
 //* ------------------------------------------------------ API -------------------------------------------- */
@@ -861,12 +1824,21 @@ XPluginStart(char *out_name, char *out_sig, char *out_desc)
     snprintf(fms_path, sizeof(fms_path), "%s%sOutput%sFMS plans%s",
              xpdir, psep, psep, psep);
 
-    snprintf(tlsb_tmp_fn, sizeof(tlsb_tmp_fn), "%s%sOutput%stlsb_download.tmp",
-             xpdir, psep, psep);
+    snprintf(cache_dir, sizeof(cache_dir), "%s%sOutput%stlsb_cache", xpdir, psep, psep);
+    tlsb_cache_init(cache_dir);
+    nav_thread_valid = (0 == pthread_create(&nav_thread, NULL, nav_proc, NULL));
 
     /* map standard datarefs, acf datarefs are delayed */
     vr_enabled_dr = XPLMFindDataRef("sim/graphics/VR/enabled");
+    fuel_total_dr = XPLMFindDataRef("sim/flightmodel/weight/m_fuel_total");
+    on_ground_dr = XPLMFindDataRef("sim/flightmodel/failures/onground_any");
+    flight_time_dr = XPLMFindDataRef("sim/time/total_flight_time_sec");
+    lat_dr = XPLMFindDataRef("sim/flightmodel/position/latitude");
+    lon_dr = XPLMFindDataRef("sim/flightmodel/position/longitude");
+    gs_dr = XPLMFindDataRef("sim/flightmodel/position/groundspeed");
+    zulu_time_dr = XPLMFindDataRef("sim/time/zulu_time_sec");
     acf_icao_dr = XPLMFindDataRef("sim/aircraft/view/acf_ICAO");
+    tlsb_dref_init();
 
     /* load preferences */
     XPLMGetPrefsPath(pref_path);
@@ -881,18 +1853,84 @@ XPluginStart(char *out_name, char *out_sig, char *out_desc)
 PLUGIN_API void
 XPluginStop(void)
 {
+    plugin_cancel->token.cancelled = 1;
+    prefetch_stop();
+    xfer_stop();
+    dl_stop();
+    tlsb_watch_stop();
+    clipboard_stop();
+    if (nav_thread_valid) {
+        nav_cancel.cancelled = 1;
+        pthread_join(nav_thread, NULL);
+        nav_thread_valid = 0;
+    }
+    nav_cleanup();
+    apt_cleanup();
+    tlsb_search_release(search_idx);
+    search_idx = NULL;
+    tlsb_search_cleanup();
+    tlsb_shm_destroy();
+    tlsb_dref_cleanup();
+
+    if (tlsb_menu) {
+        XPLMUnregisterCommandHandler(toggle_cmdr, toggle_cmd_cb, 0, NULL);
+        XPLMUnregisterCommandHandler(fetch_cmdr, fetch_cmd_cb, 0, NULL);
+        XPLMUnregisterCommandHandler(fetch_xfer_cmdr, fetch_xfer_cmd_cb, 0, NULL);
+        XPLMDestroyFlightLoop(flight_loop_id);
+        XPLMDestroyMenu(tlsb_menu);
+        tlsb_menu = NULL;
+    }
+
+    tlsb_scroll_destroy(view);
+    view = NULL;
+    if (getofp_widget)
+        XPDestroyWidget(getofp_widget, 1);
+    if (conf_widget)
+        XPDestroyWidget(conf_widget, 1);
+    getofp_widget = conf_widget = NULL;
+
+    /* stray hedged requests see the cancel within a second */
+    if (tlsb_http_cleanup(2000)) {
+        while (plugin_cancel != &plugin_cancel_first) {
+            plugin_cancel_t *pc = plugin_cancel;
+            plugin_cancel = pc->retired;
+            tlsb_free(pc);
+        }
+    }
+    tlsb_mem_log_stats();   /* what is live now is leaked */
+    log_msg("stopped");
 }
 
 
 PLUGIN_API void
 XPluginDisable(void)
 {
+    plugin_cancel->token.cancelled = 1;
+    prefetch_stop();
+    xfer_stop();
+    dl_stop();
+    tlsb_watch_stop();
+    tlsb_task_remove(watch_task, NULL);
 }
 
 
 PLUGIN_API int
 XPluginEnable(void)
 {
+    if (plugin_cancel->token.cancelled) {
+        plugin_cancel_t *pc = tlsb_calloc(TLSB_MEM_UI, 1, sizeof(*pc));
+        if (NULL == pc) {
+            log_msg("can't enable, out of memory");
+            return 0;
+        }
+
+        pc->retired = plugin_cancel;
+        plugin_cancel = pc;
+        prefetch_cancel.parent = xfer_cancel.parent = dl_cancel.parent = &pc->token;
+    }
+
+    if (watch_on)
+        watch_update();
     return 1;
 }
 
@@ -935,20 +1973,37 @@ XPluginReceiveMessage(XPLMPluginID in_from, long in_msg, void *in_param)
                         tlsb_menu = XPLMCreateMenu("Simbrief Connector", menu, sub_menu, menu_cb, NULL);
                         XPLMAppendMenuItem(tlsb_menu, "Configure", &conf_widget, 0);
                         XPLMAppendMenuItem(tlsb_menu, "Show widget", &getofp_widget, 0);
+                        XPLMAppendMenuItem(tlsb_menu, "Memory stats", &flag_mem_view, 0);
 
-                        XPLMCommandRef cmdr = XPLMCreateCommand("tlsb/toggle", "Toggle simbrief connector widget");
-                        XPLMRegisterCommandHandler(cmdr, toggle_cmd_cb, 0, NULL);
+                        toggle_cmdr = XPLMCreateCommand("tlsb/toggle", "Toggle simbrief connector widget");
+                        XPLMRegisterCommandHandler(toggle_cmdr, toggle_cmd_cb, 0, NULL);
 
-                        cmdr = XPLMCreateCommand("tlsb/fetch", "Fetch ofp data and show in widget");
-                        XPLMRegisterCommandHandler(cmdr, fetch_cmd_cb, 0, NULL);
+                        fetch_cmdr = XPLMCreateCommand("tlsb/fetch", "Fetch ofp data and show in widget");
+                        XPLMRegisterCommandHandler(fetch_cmdr, fetch_cmd_cb, 0, NULL);
 
-                        cmdr = XPLMCreateCommand("tlsb/fetch_xfer", "Fetch ofp data and xfer load data");
-                        XPLMRegisterCommandHandler(cmdr, fetch_xfer_cmd_cb, 0, NULL);
+                        fetch_xfer_cmdr = XPLMCreateCommand("tlsb/fetch_xfer", "Fetch ofp data and xfer load data");
+                        XPLMRegisterCommandHandler(fetch_xfer_cmdr, fetch_xfer_cmd_cb, 0, NULL);
 
                         flight_loop_id = XPLMCreateFlightLoop(&create_flight_loop);
                     }
+
+                    prefetch_start();
+                    watch_update();
                }
             }
         break;
+
+        case XPLM_MSG_PLANE_UNLOADED:
+            if (in_param == 0) {
+                prefetch_stop();
+                xfer_stop();
+                dl_stop();
+                tlsb_watch_stop();
+                tlsb_task_remove(watch_task, NULL);
+                watch_on = 0;
+                fuel_mon_stop();
+                track_stop();
+            }
+        break;
     }
 }
@@ -24,6 +24,29 @@ SOFTWARE.
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
+
+/* a fix of the navlog */
+#define OFP_MAX_FIX 250
+typedef struct _ofp_fix
+{
+    char ident[12];
+    char type[6];           /* apt, vor, ndb, wpt, ltlg, toc, ... */
+    char via[12];           /* airway, DCT or SID/STAR name */
+    char stage[4];          /* CLB, CRZ, DSC as in simbrief's navlog */
+    int is_sid_star;
+    int altitude;           /* ft */
+    double lat, lon;
+    int time_total;         /* s after takeoff */
+    float fuel_onboard;     /* planned, OFP units */
+} ofp_fix_t;
+
+/* winds aloft, fix x level */
+#define OFP_MAX_WIND_LVL 12
+typedef struct _ofp_wind
+{
+    short dir, spd, oat;    /* deg, kt, C */
+} ofp_wind_t;
 
 typedef struct _ofp_info
 {
@@ -35,6 +58,7 @@ typedef struct _ofp_info
     char aircraft_icao[10];
     char max_passengers[10];
     char fuel_plan_ramp[10];
+    char fuel_plan_takeoff[10];
     char origin[10];
     char origin_rwy[6];
     char destination[10];
@@ -56,13 +80,283 @@ typedef struct _ofp_info
     char sb_fms_link[80];
     char time_generated[11];
     char est_time_enroute[11];
+    char airac[6];
+    char origin_elevation[10], origin_lat[14], origin_lon[14];
+    char destination_elevation[10], destination_lat[14], destination_lon[14];
+    int n_fix;
+    int navlog_truncated;               /* more than OFP_MAX_FIX fixes */
+    ofp_fix_t navlog[OFP_MAX_FIX];
+    int n_wind_lvl;
+    short wind_fl[OFP_MAX_WIND_LVL];    /* ascending */
+    ofp_wind_t wind[OFP_MAX_FIX][OFP_MAX_WIND_LVL];
 } ofp_info_t;
 
-/* tmpfile is unreliable on windows so we use this as filename */
-extern char tlsb_tmp_fn[];
+/* cancellation token, a token is cancelled if it or any of its parents is */
+typedef struct _tlsb_cancel tlsb_cancel_t;
+struct _tlsb_cancel
+{
+    volatile int cancelled;
+    const tlsb_cancel_t *parent;
+};
+
+extern int tlsb_cancelled(const tlsb_cancel_t *cancel);
 
+/*
+ * A http GET request, zero initialize and fill in what's needed.
+ * range_start/range_end select a byte range (range_end inclusive), range_end = 0
+ * means "to the end". The body goes to write_cb if set, else to f (may be NULL).
+ *
+ * The connect and low speed timeouts are derived from the connect time and
+ * time to first byte observed for the host if not set. The total timeout is
+ * the caller's, a latency history says nothing about the size of the body.
+ * A failed request or a 408, 429 or 5xx response is retried if nothing was
+ * written yet. The body of such a response never goes to the sink.
+ * With hedge set the body is buffered and a second request is sent if the first
+ * one does not deliver a byte within the p95 time to first byte.
+ * A request is aborted within about a second when its cancel token is cancelled.
+ * With compress set gzip or deflate is accepted and the body is decoded on the fly.
+ */
+typedef struct _tlsb_http_req tlsb_http_req_t;
+struct _tlsb_http_req
+{
+    const char *url;
+    FILE *f;
+    size_t (*write_cb)(const void *ptr, size_t len, tlsb_http_req_t *req);
+    void *write_ctx;
+    long range_start, range_end;
+    int timeout;            /* total, seconds */
+    int connect_timeout_ms;
+    int low_speed_limit;    /* abort if less than this # of bytes/s ... */
+    int low_speed_time;     /* ... for that # of seconds */
+    int retries;
+    int hedge;
+    int compress;
+    const tlsb_cancel_t *cancel;    /* may be NULL */
+
+    /* results */
+    int http_status;        /* available when the first body byte is written */
+    int accept_ranges;
+    long total_length;      /* from Content-Range or Content-Length, -1 if unknown */
+    long ret_len;           /* # of bytes received */
+    long wire_len;          /* before decoding */
+    int decode_us;          /* time spent in decoding */
+    char content_encoding[16];
+    int connect_ms, ttfb_ms, total_ms;  /* -1 if unknown */
+    int attempts;
+};
+
+extern int tlsb_http_request(tlsb_http_req_t *req);
+extern int tlsb_http_perform(tlsb_http_req_t *req);    /* the selected transport */
+extern long tlsb_now_ms(void);
+extern void tlsb_http_log_stats(void);
+extern int tlsb_http_cleanup(int wait_ms);
+extern void tlsb_http_backend_cleanup(void);
 extern int tlsb_http_get(const char *url, FILE *f, int *retlen, int timeout);
+
+/*
+ * Transports below the request policy, selected at runtime with
+ * "native", "record:<dir>", "replay:<dir>" or "replay-fast:<dir>".
+ * file:// urls are always served from the file system.
+ */
+typedef struct _tlsb_transport
+{
+    const char *name;
+    int (*perform)(tlsb_http_req_t *req);
+    void (*cleanup)(void);  /* may be NULL */
+} tlsb_transport_t;
+
+extern const tlsb_transport_t tlsb_transport_native;   /* libcurl or WinHTTP */
+extern const tlsb_transport_t tlsb_transport_file;
+extern int tlsb_transport_select(const char *spec);
+extern int tlsb_download(const char *url, const char *fn, int timeout, uint64_t *hash,
+                         const tlsb_cancel_t *cancel);
+
+extern long tlsb_file_size(const char *fn);
+extern int tlsb_file_stat(const char *fn, long *size, long *mtime);
+extern int tlsb_rename(const char *from, const char *to);
+extern int tlsb_mkdir(const char *dir);
+extern int tlsb_copy_file(const char *from, const char *to);
+extern void *tlsb_map_file(const char *fn, long *size);
+extern void tlsb_unmap_file(void *addr, long size);
+
+/*
+ * Content hash: FNV-1a 64 over chunks of TLSB_HASH_CHUNK bytes, the chunk hashes are
+ * folded in order. So parallel downloads of chunk aligned ranges can hash while streaming.
+ */
+#define TLSB_HASH_CHUNK (256 * 1024)
+typedef struct _tlsb_hash
+{
+    uint64_t top, chunk;
+    long pos;
+} tlsb_hash_t;
+
+#define TLSB_FNV_INIT 0xcbf29ce484222325ULL
+extern uint64_t tlsb_fnv1a(uint64_t h, const void *ptr, size_t len);
+extern void tlsb_hash_init(tlsb_hash_t *h);
+extern void tlsb_hash_update(tlsb_hash_t *h, const void *ptr, size_t len);
+extern void tlsb_hash_fold(tlsb_hash_t *h, uint64_t chunk_hash);
+extern uint64_t tlsb_hash_final(tlsb_hash_t *h);
+
+/* content addressed download cache */
+extern void tlsb_cache_init(const char *dir);
+extern int tlsb_cache_get(const char *key, const char *url, const char *fn, int timeout, int *changed,
+                          const tlsb_cancel_t *cancel);
 extern void log_msg(const char *fmt, ...);
-extern int tlsb_ofp_get_parse(const char *pilot_id, ofp_info_t *ofp_info);
+extern int tlsb_ofp_get_parse(const char *pilot_id, ofp_info_t *ofp_info, const tlsb_cancel_t *cancel);
+typedef void (*tlsb_ofp_early_cb_t)(const ofp_info_t *ofp_info, void *ctx);
+extern int tlsb_ofp_get_parse_early(const char *pilot_id, ofp_info_t *ofp_info, const tlsb_cancel_t *cancel,
+                                    tlsb_ofp_early_cb_t early_cb, void *early_ctx);
+extern void tlsb_ofp_forget(void);
+extern void tlsb_ofp_parse(char *xml, int len, ofp_info_t *ofp_info);
+extern long tlsb_ofp_parse_file(const char *fn, ofp_info_t *ofp_info, int briefing);
 extern void tlsb_dump_ofp_info(ofp_info_t *ofp_info);
-extern int get_clipboard(char *buffer, int buflen);
+extern int tlsb_wind_at(const ofp_info_t *ofp_info, const char *stage, int fl,
+                        int *dir, int *spd, int *oat);
+extern void tlsb_wind_page(const ofp_info_t *ofp_info, const char *stage, int crz_fl,
+                           char *buffer, int buflen);
+
+/* fuel on board against the planned burn */
+#define LB_2_KG 0.45359237    /* imperial to metric */
+typedef struct _tlsb_fuel_mon
+{
+    int n, cur;                     /* points, segment [cur, cur + 1] */
+    float t[OFP_MAX_FIX + 1];       /* s after takeoff, ascending */
+    float fob[OFP_MAX_FIX + 1];     /* planned, kg */
+    float plan, delta, trend;       /* kg, kg, kg/h */
+    int trend_valid;
+    float t_sample, delta_sample;
+} tlsb_fuel_mon_t;
+
+extern int tlsb_fuel_plan(tlsb_fuel_mon_t *fm, const ofp_info_t *ofp_info);
+extern void tlsb_fuel_update(tlsb_fuel_mon_t *fm, float t, float fob);
+
+/* progress along the navlog from the aircraft position */
+#define TRACK_MAX_PT (OFP_MAX_FIX + 2)
+#define TRACK_MAX_CELL 4096
+typedef struct _tlsb_track
+{
+    int n_pt, n_cell;               /* n_cell < 0: no grid */
+    double p[TRACK_MAX_PT][3];      /* origin, fixes and destination as unit vectors */
+    short fix[TRACK_MAX_PT];        /* navlog index, -1 = origin, -2 = destination */
+    float leg_nm[TRACK_MAX_PT];     /* point i to i + 1 */
+    float togo_pt[TRACK_MAX_PT];    /* point i to destination */
+    float fob[TRACK_MAX_PT];        /* planned, kg, < 0 unknown */
+    uint32_t cell[TRACK_MAX_CELL];  /* cell << 9 | leg, sorted */
+    int leg;                        /* from point leg to leg + 1, -1 = not yet */
+    float next_nm, togo_nm, off_nm, efob;
+    int n_grid, n_linear;           /* searches tried on the grid, done linear */
+} tlsb_track_t;
+
+extern int tlsb_track_init(tlsb_track_t *tr, const ofp_info_t *ofp_info);
+extern int tlsb_track_update(tlsb_track_t *tr, double lat, double lon, float fob);
+
+extern int tlsb_write_fms(const ofp_info_t *ofp_info, const char *fn, int *changed);
+
+/* counted allocations by subsystem */
+enum {
+    TLSB_MEM_OFP, TLSB_MEM_HTTP, TLSB_MEM_SEARCH, TLSB_MEM_NAV, TLSB_MEM_APT,
+    TLSB_MEM_FMS, TLSB_MEM_DOWNLOAD, TLSB_MEM_UI, TLSB_MEM_N
+};
+
+typedef struct _tlsb_mem_stat {
+    long bytes;             /* allocated in total */
+    long count;             /* number of allocations */
+    long live;              /* allocated and not yet freed */
+    long peak;              /* high water mark of live, since the last mark for the total */
+} tlsb_mem_stat_t;
+
+extern void *tlsb_malloc(int sub, size_t size);
+extern void *tlsb_calloc(int sub, size_t n, size_t size);
+extern void *tlsb_realloc(int sub, void *p, size_t size);
+extern void tlsb_free(void *p);
+extern int tlsb_grow(int sub, void **p, int *cap, int n, size_t sz);
+extern const char *tlsb_mem_name(int sub);
+extern void tlsb_mem_get(int sub, tlsb_mem_stat_t *st);
+extern void tlsb_mem_mark(tlsb_mem_stat_t *mark);
+extern void tlsb_mem_since(const tlsb_mem_stat_t *mark, tlsb_mem_stat_t *d);
+extern void tlsb_mem_log_stats(void);
+extern void tlsb_ofp_mem_stat(tlsb_mem_stat_t *st);     /* of the last OFP fetch */
+
+/* full text search over the OFP briefing, indexed when the OFP is fetched */
+typedef struct _tlsb_search tlsb_search_t;
+typedef struct {
+    int ofs, len;           /* a line of the text */
+} tlsb_hit_t;
+
+extern void tlsb_search_add(const char *key, const char *html, int len);
+extern tlsb_search_t *tlsb_search_get(const char *key);
+extern void tlsb_search_release(tlsb_search_t *idx);
+extern void tlsb_search_cleanup(void);
+extern const char *tlsb_search_text(const tlsb_search_t *idx);
+extern int tlsb_search_query(const tlsb_search_t *idx, const char *query, const char *const *alias,
+                             tlsb_hit_t *hits, int max_hits);
+
+/* tlsb/ofp/... datarefs, plugin only */
+extern void tlsb_dref_init(void);
+extern void tlsb_dref_publish(const ofp_info_t *ofp_info);
+extern void tlsb_dref_cleanup(void);
+extern int get_clipboard(char *buffer, int buflen, int timeout_ms);
+
+/* navdata index and route check */
+#define NAV_MAX_WPT 300
+typedef struct {
+    char ident[12];
+    char via[8];            /* airway or "" */
+    float lat, lon;
+} nav_wpt_t;
+
+typedef struct {
+    int n_wpt, n_unknown;
+    nav_wpt_t wpt[NAV_MAX_WPT];
+    char unknown[200];      /* unresolved tokens, blank separated */
+} nav_route_t;
+
+extern int nav_init(const char *xpdir, const char *cache_dir, const tlsb_cancel_t *cancel);
+extern int nav_ready(void);
+extern void nav_cleanup(void);
+extern int nav_nearest(float lat, float lon, nav_wpt_t *wpt);
+extern int nav_route_check(const char *route, nav_route_t *rte);
+
+/* main thread task queue, run from the flight loop */
+enum { TLSB_PRIO_HIGH, TLSB_PRIO_NORMAL, TLSB_PRIO_LOW };
+#define TLSB_TASK_DONE (-1)
+#define TLSB_TASK_AGAIN 0       /* next frame, > 0: after that # of ms */
+typedef int (*tlsb_task_fn_t)(void *ctx);
+
+extern int tlsb_task_add(const char *name, int prio, tlsb_task_fn_t fn, void *ctx, int delay_ms);
+extern void tlsb_task_remove(tlsb_task_fn_t fn, void *ctx);
+extern long tlsb_task_time_left(void);
+extern int tlsb_task_run(long budget_us);
+
+/* airport and runway index over apt.dat */
+#define APT_MAX_RWY 32
+typedef struct {
+    char id[4];
+    float lat, lon;             /* threshold */
+    float heading, length;      /* true, m */
+    float width, displaced;     /* m */
+} apt_rwy_t;
+
+typedef struct {
+    char icao[12];
+    float lat, lon;
+    int elevation;              /* ft */
+    int n_rwy;                  /* runway ends */
+    apt_rwy_t rwy[APT_MAX_RWY];
+} apt_info_t;
+
+extern int apt_init(const char *xpdir, const char *cache_dir, const tlsb_cancel_t *cancel);
+extern int apt_ready(void);
+extern void apt_cleanup(void);
+extern int apt_lookup(const char *icao, apt_info_t *apt);
+extern const apt_rwy_t *apt_runway(const apt_info_t *apt, const char *id);
+
+/* OFPs dropped into a directory, take from the flight loop */
+extern int tlsb_watch_start(const char *dir);
+extern void tlsb_watch_stop(void);
+extern int tlsb_watch_take(ofp_info_t *ofp_info, char *fn, int fn_len);
+
+/* asynchronous clipboard read, poll from the flight loop */
+extern int clipboard_start(int timeout_ms);
+extern int clipboard_poll(char *buffer, int buflen);
+extern void clipboard_stop(void);
@@ -0,0 +1,459 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Index over the airports and runways of X-Plane's apt.dat files.
+ *
+ * Every apt.dat (custom scenery packs, global airports, default) gets its own
+ * index file in the cache directory that is mmap'ed:
+ *   header
+ *   airports    sorted by icao, each a range of runway ends
+ *   runway ends
+ *
+ * An index is rebuilt only when size or mtime of its apt.dat changes, so
+ * adding or updating a scenery pack costs just the parse of that pack.
+ * Lookups go through the sources in scenery_packs.ini order, first hit wins.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "tlsb.h"
+
+#define APT_MAGIC "TLSBAPT1"
+#define APT_MAX_SRC 500
+
+typedef struct {
+    char icao[8];
+    float lat, lon;
+    int32_t elevation;
+    uint32_t first_rwy, n_rwy;
+} apt_rec_t;
+
+typedef struct {
+    char id[4];
+    float lat, lon;             /* threshold */
+    float heading, length;      /* true, m */
+    float width, displaced;     /* m */
+} apt_rwy_rec_t;
+
+typedef struct {
+    char magic[8];
+    int64_t src_size, src_mtime;
+    uint32_t n_apt, n_rwy;
+    uint32_t off_apt, off_rwy;
+} apt_hdr_t;
+
+typedef struct {
+    uint64_t id;                /* hash of the apt.dat path */
+    void *base;
+    long size;
+    const apt_hdr_t *hdr;
+    const apt_rec_t *apts;
+    const apt_rwy_rec_t *rwys;
+} apt_src_t;
+
+static apt_src_t srcs[APT_MAX_SRC];
+static int n_src;
+static volatile int apt_is_ready;
+
+/* great circle distance in m and initial true course in degrees */
+static void
+dist_crs(double lat1, double lon1, double lat2, double lon2, float *dist, float *crs)
+{
+    const double d2r = M_PI / 180.0;
+    lat1 *= d2r; lon1 *= d2r; lat2 *= d2r; lon2 *= d2r;
+
+    double a = sin((lat2 - lat1) / 2) * sin((lat2 - lat1) / 2)
+               + cos(lat1) * cos(lat2) * sin((lon2 - lon1) / 2) * sin((lon2 - lon1) / 2);
+    *dist = 2.0 * 6371000.0 * atan2(sqrt(a), sqrt(1.0 - a));
+
+    double c = atan2(sin(lon2 - lon1) * cos(lat2),
+                     cos(lat1) * sin(lat2) - sin(lat1) * cos(lat2) * cos(lon2 - lon1)) / d2r;
+    *crs = fmod(c + 360.0, 360.0);
+}
+
+/* ------------------------------------------------------------------ build */
+
+/* airports are collected with their runways and sorted afterwards */
+typedef struct {
+    apt_rec_t a;
+    uint32_t src_rwy;           /* into the unsorted runway list */
+} build_apt_t;
+
+static int
+cmp_apt(const void *a, const void *b)
+{
+    const build_apt_t *pa = a, *pb = b;
+    int c = strncmp(pa->a.icao, pb->a.icao, 8);
+    if (c)
+        return c;
+    return pa->src_rwy < pb->src_rwy ? -1 : (pa->src_rwy > pb->src_rwy);
+}
+
+static void
+set_end(apt_rwy_rec_t *r, const char *id, double lat, double lon, double lat2, double lon2,
+        float width, float displaced)
+{
+    memset(r, 0, sizeof(*r));
+    memcpy(r->id, id, strnlen(id, sizeof(r->id) - 1));
+    r->lat = lat;
+    r->lon = lon;
+    r->width = width;
+    r->displaced = displaced;
+    dist_crs(lat, lon, lat2, lon2, &r->length, &r->heading);
+}
+
+/* mean of the thresholds as airport position */
+static void
+finish_apt(build_apt_t *ba, const apt_rwy_rec_t *rwys)
+{
+    if (0 == ba->a.n_rwy)
+        return;
+    double lat = 0.0, lon = 0.0;
+    for (uint32_t i = 0; i < ba->a.n_rwy; i++) {
+        lat += rwys[ba->src_rwy + i].lat;
+        lon += rwys[ba->src_rwy + i].lon;
+    }
+    ba->a.lat = lat / ba->a.n_rwy;
+    ba->a.lon = lon / ba->a.n_rwy;
+}
+
+/* a cancelled build leaves no index behind */
+static int
+build_index(const char *src, const apt_hdr_t *fp, const char *idx_fn, const tlsb_cancel_t *cancel)
+{
+    char line[512];
+    build_apt_t *bapts = NULL;
+    apt_rwy_rec_t *brwys = NULL, *rwys = NULL;
+    int n_apt = 0, cap_apt = 0, n_rwy = 0, cap_rwy = 0, res = 0;
+    long t0 = tlsb_now_ms();
+
+    FILE *f = fopen(src, "r");
+    if (NULL == f)
+        goto out;
+
+    /* only land airports (row code 1) and land runways (100) are of interest */
+    build_apt_t *cur = NULL;
+    int continued = 0;          /* rest of a line longer than the buffer */
+    while (fgets(line, sizeof(line), f)) {
+        if (tlsb_cancelled(cancel)) {
+            fclose(f);
+            log_msg("apt: index build for '%s' cancelled", src);
+            goto out;
+        }
+
+        int cont = continued;
+        continued = (NULL == strchr(line, '\n'));
+        if (cont || line[0] != '1')
+            continue;
+
+        if (line[1] == ' ' || line[1] == '\t' || line[1] == '6' || line[1] == '7') {
+            /* 1, 16 (seaplane base), 17 (heliport): elevation deprecated deprecated icao name */
+            if (n_apt > 0)
+                finish_apt(&bapts[n_apt - 1], brwys);
+            cur = NULL;
+            int code, elevation;
+            char icao[9];
+            if (line[1] != ' ' && line[1] != '\t')
+                continue;
+            if (3 != sscanf(line, "%d %d %*d %*d %8s", &code, &elevation, icao) || code != 1)
+                continue;
+            if (!tlsb_grow(TLSB_MEM_APT, (void **)&bapts, &cap_apt, n_apt, sizeof(*bapts))) {
+                fclose(f);
+                goto out;
+            }
+            cur = &bapts[n_apt++];
+            memset(cur, 0, sizeof(*cur));
+            memcpy(cur->a.icao, icao, strnlen(icao, sizeof(cur->a.icao)));
+            cur->a.elevation = elevation;
+            cur->src_rwy = n_rwy;
+            continue;
+        }
+
+        /* 100 width surface shoulder smoothness centerline edge signs, then per end:
+           id lat lon displaced overrun marking approach_lights tdz reil */
+        if (cur && 0 == strncmp(line, "100 ", 4)) {
+            char id1[5], id2[5];
+            double lat1, lon1, lat2, lon2;
+            float width, disp1, disp2;
+            if (9 != sscanf(line, "%*d %f %*d %*d %*f %*d %*d %*d %4s %lf %lf %f %*f %*d %*d %*d %*d "
+                                   "%4s %lf %lf %f", &width, id1, &lat1, &lon1, &disp1, id2, &lat2, &lon2, &disp2))
+                continue;
+            if (!tlsb_grow(TLSB_MEM_APT, (void **)&brwys, &cap_rwy, n_rwy + 1, sizeof(*brwys))) {
+                fclose(f);
+                goto out;
+            }
+            set_end(&brwys[n_rwy++], id1, lat1, lon1, lat2, lon2, width, disp1);
+            set_end(&brwys[n_rwy++], id2, lat2, lon2, lat1, lon1, width, disp2);
+            cur->a.n_rwy += 2;
+        }
+    }
+    fclose(f);
+    if (n_apt > 0)
+        finish_apt(&bapts[n_apt - 1], brwys);
+
+    qsort(bapts, n_apt, sizeof(*bapts), cmp_apt);
+
+    /* runways in airport order, duplicate airports keep the first one */
+    rwys = tlsb_malloc(TLSB_MEM_APT, (n_rwy + 1) * sizeof(*rwys));
+    if (NULL == rwys)
+        goto out;
+    int n_out = 0;
+    uint32_t n_rwy_out = 0;
+    for (int i = 0; i < n_apt; i++) {
+        if (n_out > 0 && 0 == strncmp(bapts[i].a.icao, bapts[n_out - 1].a.icao, 8))
+            continue;
+        memcpy(rwys + n_rwy_out, brwys + bapts[i].src_rwy, bapts[i].a.n_rwy * sizeof(*rwys));
+        bapts[i].a.first_rwy = n_rwy_out;
+        n_rwy_out += bapts[i].a.n_rwy;
+        bapts[n_out++] = bapts[i];
+    }
+
+    apt_hdr_t h = *fp;
+    memcpy(h.magic, APT_MAGIC, 8);
+    h.n_apt = n_out;
+    h.n_rwy = n_rwy_out;
+    h.off_apt = sizeof(h);
+    h.off_rwy = h.off_apt + n_out * sizeof(apt_rec_t);
+
+    char tfn[520];
+    snprintf(tfn, sizeof(tfn), "%s.tmp", idx_fn);
+    f = fopen(tfn, "wb");
+    if (NULL == f) {
+        log_msg("apt: can't create '%s'", tfn);
+        goto out;
+    }
+
+    res = (1 == fwrite(&h, sizeof(h), 1, f));
+    for (int i = 0; res && i < n_out; i++)
+        res = (1 == fwrite(&bapts[i].a, sizeof(apt_rec_t), 1, f));
+    res = res && (n_rwy_out == fwrite(rwys, sizeof(apt_rwy_rec_t), n_rwy_out, f));
+
+    if (fclose(f))
+        res = 0;
+    res = res && tlsb_rename(tfn, idx_fn);
+    if (!res)
+        remove(tfn);
+    else
+        log_msg("apt index built for '%s': %d airports, %u runway ends in %ld ms",
+                src, n_out, n_rwy_out, tlsb_now_ms() - t0);
+
+  out:
+    if (!res && !tlsb_cancelled(cancel))
+        log_msg("apt: can't build index for '%s'", src);
+    tlsb_free(bapts);
+    tlsb_free(brwys);
+    tlsb_free(rwys);
+    return res;
+}
+
+/* map the index into slot s, return success == 1 if it matches the fingerprint */
+static int
+map_index(const char *idx_fn, const apt_hdr_t *fp, apt_src_t *s)
+{
+    long size;
+    void *base = tlsb_map_file(idx_fn, &size);
+    if (NULL == base)
+        return 0;
+
+    const apt_hdr_t *h = base;
+    if ((size_t)size < sizeof(*h) || memcmp(h->magic, APT_MAGIC, 8)
+        || h->src_size != fp->src_size || h->src_mtime != fp->src_mtime
+        || h->off_rwy + h->n_rwy * sizeof(apt_rwy_rec_t) != (size_t)size) {
+        tlsb_unmap_file(base, size);
+        return 0;
+    }
+
+    s->base = base;
+    s->size = size;
+    s->hdr = h;
+    s->apts = (const apt_rec_t *)((char *)base + h->off_apt);
+    s->rwys = (const apt_rwy_rec_t *)((char *)base + h->off_rwy);
+    return 1;
+}
+
+/* add apt.dat fn as next source, build its index if needed */
+static void
+add_source(const char *fn, const char *cache_dir, const tlsb_cancel_t *cancel)
+{
+    long size, mtime;
+    if (n_src >= APT_MAX_SRC || tlsb_cancelled(cancel) || !tlsb_file_stat(fn, &size, &mtime))
+        return;
+
+    apt_hdr_t fp;
+    memset(&fp, 0, sizeof(fp));
+    fp.src_size = size;
+    fp.src_mtime = mtime;
+
+    char idx_fn[512];
+    uint64_t id = tlsb_fnv1a(TLSB_FNV_INIT, fn, strlen(fn));
+    snprintf(idx_fn, sizeof(idx_fn), "%s/apt_%016llx.idx", cache_dir, (unsigned long long)id);
+
+    /* the same file may be listed twice */
+    for (int i = 0; i < n_src; i++)
+        if (srcs[i].id == id)
+            return;
+
+    apt_src_t *s = &srcs[n_src];
+    if (!map_index(idx_fn, &fp, s)) {
+        if (!build_index(fn, &fp, idx_fn, cancel) || !map_index(idx_fn, &fp, s))
+            return;
+    }
+    s->id = id;
+    n_src++;
+}
+
+/*
+ * Load or build the indices of all apt.dat files, in the priority order of
+ * scenery_packs.ini followed by the global and default airports.
+ * A full rebuild takes a while so call it from a thread, cancel stops it
+ * within a line of apt.dat.
+ */
+int
+apt_init(const char *xpdir, const char *cache_dir, const tlsb_cancel_t *cancel)
+{
+    char line[600], fn[1024];
+    long t0 = tlsb_now_ms();
+
+    snprintf(fn, sizeof(fn), "%s/Custom Scenery/scenery_packs.ini", xpdir);
+    FILE *f = fopen(fn, "r");
+    if (f) {
+        while (!tlsb_cancelled(cancel) && fgets(line, sizeof(line), f)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (strncmp(line, "SCENERY_PACK ", 13))
+                continue;
+
+            /* *GLOBAL_AIRPORTS* is where XP12 has the global airports in the order */
+            const char *pack = line + 13;
+            if (0 == strcmp(pack, "*GLOBAL_AIRPORTS*"))
+                snprintf(fn, sizeof(fn), "%s/Global Scenery/Global Airports/Earth nav data/apt.dat", xpdir);
+            else if (pack[0] == '/' || (pack[0] && pack[1] == ':'))
+                snprintf(fn, sizeof(fn), "%sEarth nav data/apt.dat", pack);
+            else
+                snprintf(fn, sizeof(fn), "%s/%sEarth nav data/apt.dat", xpdir, pack);
+            add_source(fn, cache_dir, cancel);
+        }
+        fclose(f);
+    }
+
+    /* XP12 global airports when not listed, XP11 default airports */
+    snprintf(fn, sizeof(fn), "%s/Global Scenery/Global Airports/Earth nav data/apt.dat", xpdir);
+    add_source(fn, cache_dir, cancel);
+    snprintf(fn, sizeof(fn), "%s/Resources/default scenery/default apt dat/Earth nav data/apt.dat", xpdir);
+    add_source(fn, cache_dir, cancel);
+
+    if (tlsb_cancelled(cancel)) {
+        log_msg("apt: cancelled");
+        return 0;
+    }
+
+    if (0 == n_src) {
+        log_msg("apt: no apt.dat found");
+        return 0;
+    }
+
+    log_msg("apt: %d apt.dat files in %ld ms", n_src, tlsb_now_ms() - t0);
+    apt_is_ready = 1;
+    return 1;
+}
+
+int
+apt_ready(void)
+{
+    return apt_is_ready;
+}
+
+void
+apt_cleanup(void)
+{
+    apt_is_ready = 0;
+    for (int i = 0; i < n_src; i++)
+        tlsb_unmap_file(srcs[i].base, srcs[i].size);
+    n_src = 0;
+}
+
+/* ------------------------------------------------------------------ query */
+
+static const apt_rec_t *
+find_apt(const apt_src_t *s, const char *icao)
+{
+    uint32_t lo = 0, hi = s->hdr->n_apt;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        int c = strncmp(s->apts[mid].icao, icao, 8);
+        if (c == 0)
+            return &s->apts[mid];
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+/* airport with its runway ends from the highest priority apt.dat, return success == 1 */
+int
+apt_lookup(const char *icao, apt_info_t *apt)
+{
+    memset(apt, 0, sizeof(*apt));
+    if (!apt_is_ready)
+        return 0;
+
+    for (int i = 0; i < n_src; i++) {
+        const apt_rec_t *a = find_apt(&srcs[i], icao);
+        if (NULL == a)
+            continue;
+
+        memcpy(apt->icao, a->icao, 8);
+        apt->lat = a->lat;
+        apt->lon = a->lon;
+        apt->elevation = a->elevation;
+        for (uint32_t j = 0; j < a->n_rwy && apt->n_rwy < APT_MAX_RWY; j++) {
+            const apt_rwy_rec_t *r = &srcs[i].rwys[a->first_rwy + j];
+            apt_rwy_t *rw = &apt->rwy[apt->n_rwy++];
+            memcpy(rw->id, r->id, sizeof(r->id));
+            rw->lat = r->lat;
+            rw->lon = r->lon;
+            rw->heading = r->heading;
+            rw->length = r->length;
+            rw->width = r->width;
+            rw->displaced = r->displaced;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* runway end by id, NULL if unknown */
+const apt_rwy_t *
+apt_runway(const apt_info_t *apt, const char *id)
+{
+    for (int i = 0; i < apt->n_rwy; i++)
+        if (0 == strcmp(apt->rwy[i].id, id))
+            return &apt->rwy[i];
+    return NULL;
+}
@@ -0,0 +1,314 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Content addressed cache for downloaded files.
+ *
+ * Blobs live in <dir>/<hash>.<ext>, <dir>/index maps a key (OFP time_generated + link)
+ * to the hash of the content. We also remember hash, size and mtime of what we
+ * installed at a destination so an unchanged file is not rewritten.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "tlsb.h"
+
+#define N_ENTRY 20
+#define N_DEST 8
+
+typedef struct _cache_entry
+{
+    char key[200];
+    char ext[8];
+    uint64_t hash;
+} cache_entry_t;
+
+typedef struct _cache_dest
+{
+    char fn[520];
+    uint64_t hash;
+    long size, mtime;
+} cache_dest_t;
+
+static char cache_dir[400];
+static cache_entry_t entry[N_ENTRY];    /* oldest first */
+static int n_entry;
+static cache_dest_t dest[N_DEST];
+static int n_dest;
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t
+tlsb_fnv1a(uint64_t h, const void *ptr, size_t len)
+{
+    const unsigned char *p = ptr;
+    while (len-- > 0) {
+        h ^= *p++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+void
+tlsb_hash_init(tlsb_hash_t *h)
+{
+    h->top = h->chunk = TLSB_FNV_INIT;
+    h->pos = 0;
+}
+
+void
+tlsb_hash_fold(tlsb_hash_t *h, uint64_t chunk_hash)
+{
+    unsigned char b[8];
+    for (int i = 0; i < 8; i++)
+        b[i] = chunk_hash >> (8 * i);
+    h->top = tlsb_fnv1a(h->top, b, sizeof(b));
+}
+
+void
+tlsb_hash_update(tlsb_hash_t *h, const void *ptr, size_t len)
+{
+    const char *p = ptr;
+    while (len > 0) {
+        long in_chunk = h->pos % TLSB_HASH_CHUNK;
+        size_t n = TLSB_HASH_CHUNK - in_chunk;
+        if (n > len)
+            n = len;
+
+        h->chunk = tlsb_fnv1a(h->chunk, p, n);
+        h->pos += n;
+        p += n;
+        len -= n;
+
+        if (0 == h->pos % TLSB_HASH_CHUNK) {
+            tlsb_hash_fold(h, h->chunk);
+            h->chunk = TLSB_FNV_INIT;
+        }
+    }
+}
+
+uint64_t
+tlsb_hash_final(tlsb_hash_t *h)
+{
+    if (0 != h->pos % TLSB_HASH_CHUNK) {
+        tlsb_hash_fold(h, h->chunk);
+        h->chunk = TLSB_FNV_INIT;
+        h->pos = (h->pos / TLSB_HASH_CHUNK + 1) * TLSB_HASH_CHUNK;
+    }
+    return h->top;
+}
+
+static void
+blob_fn(char *buffer, int buflen, uint64_t hash, const char *ext)
+{
+    snprintf(buffer, buflen, "%s/%016" PRIx64 ".%s", cache_dir, hash, ext);
+}
+
+static void
+load_index(void)
+{
+    char fn[520], line[700];
+    snprintf(fn, sizeof(fn), "%s/index", cache_dir);
+
+    n_entry = n_dest = 0;
+    FILE *f = fopen(fn, "rb");
+    if (NULL == f)
+        return;
+
+    while (NULL != fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        int ofs;
+
+        if ('K' == line[0] && n_entry < N_ENTRY) {
+            cache_entry_t *e = &entry[n_entry];
+            if (2 == sscanf(line, "K %" SCNx64 " %7s %n", &e->hash, e->ext, &ofs)) {
+                strncpy(e->key, line + ofs, sizeof(e->key) - 1);
+                n_entry++;
+            }
+        } else if ('D' == line[0] && n_dest < N_DEST) {
+            cache_dest_t *d = &dest[n_dest];
+            if (3 == sscanf(line, "D %" SCNx64 " %ld %ld %n", &d->hash, &d->size, &d->mtime, &ofs)) {
+                strncpy(d->fn, line + ofs, sizeof(d->fn) - 1);
+                n_dest++;
+            }
+        }
+    }
+
+    fclose(f);
+    log_msg("cache: %d entries, %d destinations", n_entry, n_dest);
+}
+
+static void
+save_index(void)
+{
+    char fn[520], tfn[520];
+    snprintf(fn, sizeof(fn), "%s/index", cache_dir);
+    snprintf(tfn, sizeof(tfn), "%s/index.tmp", cache_dir);
+
+    FILE *f = fopen(tfn, "wb");
+    if (NULL == f)
+        return;
+
+    for (int i = 0; i < n_entry; i++)
+        fprintf(f, "K %016" PRIx64 " %s %s\n", entry[i].hash, entry[i].ext, entry[i].key);
+
+    for (int i = 0; i < n_dest; i++)
+        fprintf(f, "D %016" PRIx64 " %ld %ld %s\n", dest[i].hash, dest[i].size, dest[i].mtime, dest[i].fn);
+
+    if (0 == fclose(f))
+        tlsb_rename(tfn, fn);
+}
+
+static void
+add_entry(const char *key, const char *ext, uint64_t hash)
+{
+    if (N_ENTRY == n_entry) {
+        /* evict the oldest one and its blob if it's not referenced by others */
+        cache_entry_t *e = &entry[0];
+        int referenced = 0;
+        for (int i = 1; i < n_entry; i++)
+            if (entry[i].hash == e->hash && 0 == strcmp(entry[i].ext, e->ext))
+                referenced = 1;
+
+        if (!referenced) {
+            char bfn[520];
+            blob_fn(bfn, sizeof(bfn), e->hash, e->ext);
+            unlink(bfn);
+        }
+
+        memmove(&entry[0], &entry[1], (N_ENTRY - 1) * sizeof(cache_entry_t));
+        n_entry--;
+    }
+
+    cache_entry_t *e = &entry[n_entry++];
+    memset(e, 0, sizeof(*e));
+    snprintf(e->key, sizeof(e->key), "%s", key);
+    snprintf(e->ext, sizeof(e->ext), "%s", ext);
+    e->hash = hash;
+}
+
+static cache_dest_t *
+find_dest(const char *fn)
+{
+    for (int i = 0; i < n_dest; i++)
+        if (0 == strcmp(dest[i].fn, fn))
+            return &dest[i];
+
+    if (N_DEST == n_dest) {
+        memmove(&dest[0], &dest[1], (N_DEST - 1) * sizeof(cache_dest_t));
+        n_dest--;
+    }
+
+    cache_dest_t *d = &dest[n_dest++];
+    memset(d, 0, sizeof(*d));
+    strncpy(d->fn, fn, sizeof(d->fn) - 1);
+    return d;
+}
+
+void
+tlsb_cache_init(const char *dir)
+{
+    pthread_mutex_lock(&cache_mutex);
+    strncpy(cache_dir, dir, sizeof(cache_dir) - 1);
+    if (tlsb_mkdir(cache_dir))
+        load_index();
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+/*
+ * Get url to fn through the cache.
+ * changed is set to 0 if fn already had this very content and was not touched.
+ * return success == 1
+ */
+int
+tlsb_cache_get(const char *key, const char *url, const char *fn, int timeout, int *changed,
+               const tlsb_cancel_t *cancel)
+{
+    char bfn[520], tfn[520], ext[8];
+    uint64_t hash = 0;
+    int hit = 0;
+
+    *changed = 0;
+
+    const char *e = strrchr(fn, '.');
+    strncpy(ext, e ? e + 1 : "bin", sizeof(ext) - 1);
+    ext[sizeof(ext) - 1] = '\0';
+
+    pthread_mutex_lock(&cache_mutex);
+    for (int i = n_entry - 1; i >= 0; i--)
+        if (0 == strcmp(entry[i].key, key) && 0 == strcmp(entry[i].ext, ext)) {
+            hash = entry[i].hash;
+            blob_fn(bfn, sizeof(bfn), hash, ext);
+            hit = (0 <= tlsb_file_size(bfn));
+            break;
+        }
+    pthread_mutex_unlock(&cache_mutex);
+
+    if (hit) {
+        log_msg("cache hit for '%s'", key);
+    } else {
+        /* name of temp file depends on key so a download can resume */
+        snprintf(tfn, sizeof(tfn), "%s/dl_%016" PRIx64 ".%s", cache_dir,
+                 tlsb_fnv1a(TLSB_FNV_INIT, key, strlen(key)), ext);
+        if (0 == tlsb_download(url, tfn, timeout, &hash, cancel))
+            return 0;
+
+        blob_fn(bfn, sizeof(bfn), hash, ext);
+        if (0 <= tlsb_file_size(bfn))
+            unlink(tfn);    /* same content under another key */
+        else if (0 == tlsb_rename(tfn, bfn))
+            return 0;
+
+        pthread_mutex_lock(&cache_mutex);
+        add_entry(key, ext, hash);
+        save_index();
+        pthread_mutex_unlock(&cache_mutex);
+    }
+
+    long size, mtime;
+    int res = 1;
+
+    pthread_mutex_lock(&cache_mutex);
+    cache_dest_t *d = find_dest(fn);
+    if (d->hash == hash && tlsb_file_stat(fn, &size, &mtime)
+        && size == d->size && mtime == d->mtime) {
+        log_msg("'%s' is unchanged", fn);
+    } else {
+        res = tlsb_copy_file(bfn, fn);
+        if (res && tlsb_file_stat(fn, &d->size, &d->mtime)) {
+            d->hash = hash;
+            *changed = 1;
+        } else {
+            d->hash = 0;
+        }
+        save_index();
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+    return res;
+}
@@ -0,0 +1,119 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Asynchronous clipboard read.
+ *
+ * The platform get_clipboard() runs in a worker thread, the caller polls
+ * from the flight loop. A result that arrives after the deadline is dropped.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "tlsb.h"
+
+static pthread_mutex_t clip_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t clip_thread;
+static int clip_thread_valid;
+static int clip_running;        /* worker has not yet finished */
+static int clip_result;         /* 1 = text, -1 = failed, 0 = pending */
+static int clip_timeout_ms;
+static uint64_t clip_deadline;
+static char clip_buffer[512];
+
+static void *
+clip_proc(void *arg)
+{
+    char buffer[sizeof(clip_buffer)];
+    buffer[0] = '\0';
+    int res = get_clipboard(buffer, sizeof(buffer), clip_timeout_ms);
+
+    pthread_mutex_lock(&clip_mutex);
+    if (clip_result == 0) {
+        if (res && buffer[0]) {
+            strcpy(clip_buffer, buffer);
+            clip_result = 1;
+        } else
+            clip_result = -1;
+    }
+    clip_running = 0;
+    pthread_mutex_unlock(&clip_mutex);
+    return NULL;
+}
+
+/* start a read, returns 0 if a previous read is still running */
+int
+clipboard_start(int timeout_ms)
+{
+    pthread_mutex_lock(&clip_mutex);
+    int busy = clip_running;
+    pthread_mutex_unlock(&clip_mutex);
+    if (busy)
+        return 0;
+
+    if (clip_thread_valid)
+        pthread_join(clip_thread, NULL);
+
+    clip_running = 1;
+    clip_result = 0;
+    clip_timeout_ms = timeout_ms;
+    clip_deadline = tlsb_now_ms() + timeout_ms;
+    clip_thread_valid = (0 == pthread_create(&clip_thread, NULL, clip_proc, NULL));
+    if (!clip_thread_valid) {
+        clip_running = 0;
+        clip_result = -1;
+    }
+    return 1;
+}
+
+/* 1 = text in buffer, 0 = still pending, -1 = empty, failed or timed out */
+int
+clipboard_poll(char *buffer, int buflen)
+{
+    pthread_mutex_lock(&clip_mutex);
+    if (clip_result == 0 && tlsb_now_ms() >= clip_deadline) {
+        log_msg("clipboard read timed out");
+        clip_result = -1;
+    }
+
+    int res = clip_result;
+    if (res > 0) {
+        strncpy(buffer, clip_buffer, buflen);
+        buffer[buflen - 1] = '\0';
+    }
+    pthread_mutex_unlock(&clip_mutex);
+    return res;
+}
+
+/* wait for the worker, call before the plugin is unloaded */
+void
+clipboard_stop(void)
+{
+    if (clip_thread_valid) {
+        pthread_join(clip_thread, NULL);
+        clip_thread_valid = 0;
+    }
+}
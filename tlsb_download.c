@@ -0,0 +1,475 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Download a file in a robust way.
+ *
+ * Data goes to segment files <fn>.part<n> and the complete file is renamed to fn
+ * so a reader never sees a truncated file.
+ * The first request asks for the first segment only. If the server honours the range
+ * it tells us the total size and the remainder is fetched in parallel ranges.
+ * The layout of segments is a function of the total size only and that is recorded
+ * in <fn>.part.info so an interrupted download can resume where it stopped.
+ *
+ * Segments are aligned to TLSB_HASH_CHUNK so each one can hash its chunks while
+ * streaming. Only data of a resumed segment that is already on disk is read back.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "tlsb.h"
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+#define SEG0_LEN TLSB_HASH_CHUNK   /* first request */
+#define SEG_MIN  TLSB_HASH_CHUNK   /* min size of a parallel segment */
+#define N_SEG_MAX 5             /* segment 0 + up to 4 parallel ones */
+
+typedef struct _segment
+{
+    const char *url;
+    tlsb_cancel_t *cancel;      /* shared by the segments of a download */
+    char fn[520];
+    long start, end;            /* end is inclusive */
+    int timeout;
+    int allow_full;             /* a "200 OK" with the full body is fine */
+    int restart;                /* server ignores the range or it is out of bounds */
+    int result;                 /* 1 = complete */
+    long total_length;
+    FILE *f;
+
+    /* chunk hashes of this segment */
+    uint64_t *hashes;
+    int n_hashes, max_hashes;
+    uint64_t cur;
+    long cur_len;
+} segment_t;
+
+static void
+part_fn(char *buffer, int buflen, const char *fn, int seg)
+{
+    if (seg < 0)
+        snprintf(buffer, buflen, "%s.part.info", fn);
+    else
+        snprintf(buffer, buflen, "%s.part%d", fn, seg);
+}
+
+static void
+remove_parts(const char *fn)
+{
+    char pfn[520];
+    for (int i = -1; i < N_SEG_MAX; i++) {
+        part_fn(pfn, sizeof(pfn), fn, i);
+        unlink(pfn);    /* unchecked */
+    }
+}
+
+/* segments are a function of the total length only, return # of segments */
+static int
+layout(long total, long *start, long *end)
+{
+    long seg0 = MIN(total, SEG0_LEN);
+    start[0] = 0;
+    end[0] = seg0 - 1;
+
+    long rest = total - seg0;
+    if (rest <= 0)
+        return 1;
+
+    int n = rest / SEG_MIN;
+    if (n < 1) n = 1;
+    if (n > N_SEG_MAX - 1) n = N_SEG_MAX - 1;
+
+    long seg_len = (rest + n - 1) / n;
+    seg_len = (seg_len + TLSB_HASH_CHUNK - 1) / TLSB_HASH_CHUNK * TLSB_HASH_CHUNK;
+    for (int i = 1; i <= n; i++) {
+        start[i] = seg0 + (i - 1) * seg_len;
+        end[i] = MIN(start[i] + seg_len, total) - 1;
+        if (end[i] == total - 1)
+            return i + 1;
+    }
+
+    return n + 1;
+}
+
+/* finish the current chunk */
+static int
+hash_flush(segment_t *seg)
+{
+    if (0 == seg->cur_len)
+        return 1;
+
+    if (seg->n_hashes == seg->max_hashes) {
+        int max = seg->max_hashes ? 2 * seg->max_hashes : 8;
+        uint64_t *h = tlsb_realloc(TLSB_MEM_DOWNLOAD, seg->hashes, max * sizeof(uint64_t));
+        if (NULL == h)
+            return 0;
+        seg->hashes = h;
+        seg->max_hashes = max;
+    }
+
+    seg->hashes[seg->n_hashes++] = seg->cur;
+    seg->cur = TLSB_FNV_INIT;
+    seg->cur_len = 0;
+    return 1;
+}
+
+static int
+hash_update(segment_t *seg, const char *ptr, size_t len)
+{
+    while (len > 0) {
+        size_t n = MIN(len, (size_t)(TLSB_HASH_CHUNK - seg->cur_len));
+        seg->cur = tlsb_fnv1a(seg->cur, ptr, n);
+        seg->cur_len += n;
+        ptr += n;
+        len -= n;
+
+        if (TLSB_HASH_CHUNK == seg->cur_len && !hash_flush(seg))
+            return 0;
+    }
+
+    return 1;
+}
+
+/* hash what is already on disk from a previous run */
+static int
+hash_file(segment_t *seg)
+{
+    char buffer[16 * 1024];
+    FILE *f = fopen(seg->fn, "rb");
+    if (NULL == f)
+        return 1;
+
+    size_t n;
+    int res = 1;
+    while (res && 0 < (n = fread(buffer, 1, sizeof(buffer), f)))
+        res = hash_update(seg, buffer, n);
+
+    fclose(f);
+    return res;
+}
+
+static size_t
+segment_write_cb(const void *ptr, size_t len, tlsb_http_req_t *req)
+{
+    segment_t *seg = req->write_ctx;
+
+    if (206 != req->http_status) {
+        if (200 != req->http_status || req->range_start > 0 || !seg->allow_full) {
+            if (200 == req->http_status || 416 == req->http_status) {
+                seg->restart = 1;
+                seg->cancel->cancelled = 1;     /* the others are in vain */
+            }
+            return 0;   /* abort transfer */
+        }
+    }
+
+    len = fwrite(ptr, 1, len, seg->f);
+    if (!hash_update(seg, ptr, len))
+        return 0;
+    return len;
+}
+
+/* get a segment, resume if partially present */
+static void *
+get_segment(void *arg)
+{
+    segment_t *seg = arg;
+    seg->result = 0;
+    seg->n_hashes = 0;
+    seg->cur = TLSB_FNV_INIT;
+    seg->cur_len = 0;
+
+    long have = tlsb_file_size(seg->fn);
+    if (have < 0)
+        have = 0;
+
+    long len = seg->end - seg->start + 1;
+    if (have > len)
+        return NULL;
+
+    if (have > 0 && !hash_file(seg))
+        return NULL;
+
+    if (have == len) {
+        seg->result = hash_flush(seg);
+        return NULL;
+    }
+
+    if (NULL == (seg->f = fopen(seg->fn, "ab"))) {
+        log_msg("Can't create file '%s'", seg->fn);
+        return NULL;
+    }
+
+    tlsb_http_req_t req;
+    memset(&req, 0, sizeof(req));
+    req.url = seg->url;
+    req.timeout = seg->timeout;
+    req.retries = 2;
+    req.cancel = seg->cancel;
+    req.write_cb = segment_write_cb;
+    req.write_ctx = seg;
+    req.range_start = seg->start + have;
+    req.range_end = seg->end;
+
+    int res = tlsb_http_request(&req);
+    if (fclose(seg->f))
+        res = 0;
+    seg->f = NULL;
+
+    if (416 == req.http_status) {
+        seg->restart = 1;
+        seg->cancel->cancelled = 1;
+    }
+
+    seg->total_length = (req.accept_ranges || 206 == req.http_status) ? req.total_length : -1;
+    if (200 == req.http_status && seg->allow_full && 0 == req.range_start)
+        seg->total_length = -2;     /* indicates the full body */
+
+    if (res && (200 == req.http_status || 206 == req.http_status))
+        seg->result = hash_flush(seg);
+    else
+        log_msg("segment %ld-%ld failed, http status %d", req.range_start, seg->end, req.http_status);
+
+    return NULL;
+}
+
+static int
+read_info(const char *fn, const char *url, long *total)
+{
+    char ifn[520], line[500];
+    part_fn(ifn, sizeof(ifn), fn, -1);
+
+    FILE *f = fopen(ifn, "rb");
+    if (NULL == f)
+        return 0;
+
+    int res = 0;
+    if (NULL != fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (0 == strcmp(line, url) && NULL != fgets(line, sizeof(line), f)) {
+            *total = atol(line);
+            res = (*total > 0);
+        }
+    }
+
+    fclose(f);
+    return res;
+}
+
+static void
+write_info(const char *fn, const char *url, long total)
+{
+    char ifn[520];
+    part_fn(ifn, sizeof(ifn), fn, -1);
+
+    FILE *f = fopen(ifn, "wb");
+    if (NULL == f)
+        return;
+
+    fprintf(f, "%s\n%ld\n", url, total);
+    fclose(f);
+}
+
+/* concatenate segments into a temp file, then rename */
+static int
+assemble(const char *fn, segment_t *seg, int n_seg)
+{
+    char tfn[520];
+    static char buffer[64 * 1024];
+    static pthread_mutex_t buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    if (1 == n_seg)
+        return tlsb_rename(seg[0].fn, fn);
+
+    snprintf(tfn, sizeof(tfn), "%s.part", fn);
+    FILE *out = fopen(tfn, "wb");
+    if (NULL == out) {
+        log_msg("Can't create file '%s'", tfn);
+        return 0;
+    }
+
+    int res = 1;
+    pthread_mutex_lock(&buffer_mutex);
+    for (int i = 0; i < n_seg && res; i++) {
+        FILE *in = fopen(seg[i].fn, "rb");
+        if (NULL == in) {
+            res = 0;
+            break;
+        }
+
+        size_t n;
+        while (0 < (n = fread(buffer, 1, sizeof(buffer), in)))
+            if (n != fwrite(buffer, 1, n, out)) {
+                res = 0;
+                break;
+            }
+
+        fclose(in);
+    }
+    pthread_mutex_unlock(&buffer_mutex);
+
+    if (fclose(out))
+        res = 0;
+
+    if (res)
+        res = tlsb_rename(tfn, fn);
+
+    if (!res) {
+        log_msg("Can't assemble '%s'", fn);
+        unlink(tfn);
+    }
+
+    return res;
+}
+
+/* return 1 = ok, 0 = failure but resumable, -1 = start over */
+static int
+download(const char *url, const char *fn, int timeout, const tlsb_cancel_t *cancel,
+         segment_t *seg, int *n_seg_out)
+{
+    long start[N_SEG_MAX], end[N_SEG_MAX];
+    long total;
+    tlsb_cancel_t seg_cancel = { 0, cancel };
+
+    *n_seg_out = 1;
+    for (int i = 0; i < N_SEG_MAX; i++) {
+        seg[i].url = url;
+        seg[i].cancel = &seg_cancel;
+        seg[i].timeout = timeout;
+        part_fn(seg[i].fn, sizeof(seg[i].fn), fn, i);
+    }
+
+    if (!read_info(fn, url, &total)) {
+        remove_parts(fn);
+
+        /* we don't know anything about the file, get the first segment */
+        seg[0].start = 0;
+        seg[0].end = SEG0_LEN - 1;
+        seg[0].allow_full = 1;
+        get_segment(&seg[0]);
+
+        if (seg[0].restart)
+            return -1;
+
+        if (-2 == seg[0].total_length) {
+            /* server sent everything in one go, nothing to resume */
+            if (seg[0].result && assemble(fn, seg, 1))
+                return 1;
+            remove_parts(fn);
+            return 0;
+        }
+
+        total = seg[0].total_length;
+        if (total <= 0)
+            return seg[0].result ? -1 : 0;
+
+        write_info(fn, url, total);
+    }
+
+    int n_seg = layout(total, start, end);
+    *n_seg_out = n_seg;
+    log_msg("download '%s': %ld bytes in %d segment(s)", fn, total, n_seg);
+
+    pthread_t tid[N_SEG_MAX];
+    int started[N_SEG_MAX];
+    for (int i = 0; i < n_seg; i++) {
+        started[i] = 0;
+        if (seg[i].result && seg[i].start == start[i] && seg[i].end == end[i])
+            continue;   /* the first segment from above */
+
+        seg[i].start = start[i];
+        seg[i].end = end[i];
+        seg[i].allow_full = 0;
+        started[i] = (0 == pthread_create(&tid[i], NULL, get_segment, &seg[i]));
+        if (!started[i])
+            get_segment(&seg[i]);
+    }
+
+    /* the threads write into seg[] so all are joined before anything is decided */
+    for (int i = 0; i < n_seg; i++)
+        if (started[i])
+            pthread_join(tid[i], NULL);
+
+    int res = 1;
+    for (int i = 0; i < n_seg; i++) {
+        if (seg[i].restart)
+            return -1;
+
+        if (!seg[i].result || tlsb_file_size(seg[i].fn) != end[i] - start[i] + 1)
+            res = 0;
+    }
+
+    if (!res)
+        return 0;
+
+    if (!assemble(fn, seg, n_seg))
+        return 0;
+
+    remove_parts(fn);
+    return 1;
+}
+
+/*
+ * return success == 1, hash (if not NULL) receives the content hash.
+ * If cancelled the partial download is kept for a later resume.
+ */
+int
+tlsb_download(const char *url, const char *fn, int timeout, uint64_t *hash,
+              const tlsb_cancel_t *cancel)
+{
+    segment_t seg[N_SEG_MAX];
+    int res = 0;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int n_seg;
+        memset(seg, 0, sizeof(seg));
+        res = download(url, fn, timeout, cancel, seg, &n_seg);
+
+        if (1 == res && hash) {
+            tlsb_hash_t h;
+            tlsb_hash_init(&h);
+            for (int i = 0; i < n_seg; i++)
+                for (int j = 0; j < seg[i].n_hashes; j++)
+                    tlsb_hash_fold(&h, seg[i].hashes[j]);
+            *hash = tlsb_hash_final(&h);
+        }
+
+        for (int i = 0; i < N_SEG_MAX; i++)
+            tlsb_free(seg[i].hashes);
+
+        if (res >= 0 || tlsb_cancelled(cancel))
+            return res > 0;
+
+        /* server does not honour ranges (anymore), start over */
+        log_msg("download '%s': starting over", fn);
+        remove_parts(fn);
+    }
+
+    return 0;
+}
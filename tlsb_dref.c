@@ -0,0 +1,170 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OFP fields as datarefs tlsb/ofp/...
+ *
+ * Values are converted once per OFP into a snapshot, the accessors only copy
+ * from there. tlsb/ofp/generation changes with every new OFP.
+ * Accessors and publishing both run in the main thread.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "XPLMDataAccess.h"
+
+#include "tlsb.h"
+
+typedef struct {
+    const char *s;
+    int len;        /* incl. terminating 0 */
+} dref_str_t;
+
+static struct {
+    int generation, valid, ci, cruise_fl, pax_count, est_time_enroute;
+    int isa_dev, wind_component, tropopause, max_passengers;
+    float fuel_plan_ramp, freight, payload, oew;
+    ofp_info_t ofp;     /* strings point in here */
+    dref_str_t units, icao_airline, flight_number, aircraft_icao, origin, origin_rwy,
+               destination, destination_rwy, alternate, route, alt_route,
+               time_generated, airac;
+} snap;
+
+static int
+get_int(void *ref)
+{
+    return *(int *)ref;
+}
+
+static float
+get_float(void *ref)
+{
+    return *(float *)ref;
+}
+
+static int
+get_str(void *ref, void *values, int offset, int max)
+{
+    const dref_str_t *str = ref;
+    if (NULL == values)
+        return str->len;
+
+    if (offset >= str->len || max <= 0)
+        return 0;
+
+    int n = str->len - offset;
+    if (n > max)
+        n = max;
+    memcpy(values, str->s + offset, n);
+    return n;
+}
+
+typedef struct {
+    const char *name;
+    XPLMDataTypeID type;
+    void *ref;
+} dref_def_t;
+
+static const dref_def_t drefs[] = {
+#define I(f) { "tlsb/ofp/" #f, xplmType_Int, &snap.f }
+#define F(f) { "tlsb/ofp/" #f, xplmType_Float, &snap.f }
+#define S(f) { "tlsb/ofp/" #f, xplmType_Data, &snap.f }
+    I(generation), I(valid), I(ci), I(cruise_fl), I(pax_count), I(est_time_enroute),
+    I(isa_dev), I(wind_component), I(tropopause), I(max_passengers),
+    F(fuel_plan_ramp), F(freight), F(payload), F(oew),
+    S(units), S(icao_airline), S(flight_number), S(aircraft_icao), S(origin), S(origin_rwy),
+    S(destination), S(destination_rwy), S(alternate), S(route), S(alt_route),
+    S(time_generated), S(airac)
+#undef I
+#undef F
+#undef S
+};
+
+#define N_DREF (sizeof(drefs) / sizeof(drefs[0]))
+static XPLMDataRef dref_ids[N_DREF];
+
+static void
+set_strings(void)
+{
+#define S(f) snap.f.s = snap.ofp.f; snap.f.len = strlen(snap.ofp.f) + 1
+    S(units); S(icao_airline); S(flight_number); S(aircraft_icao); S(origin); S(origin_rwy);
+    S(destination); S(destination_rwy); S(alternate); S(route); S(alt_route);
+    S(time_generated); S(airac);
+#undef S
+}
+
+void
+tlsb_dref_init(void)
+{
+    set_strings();
+    for (unsigned i = 0; i < N_DREF; i++) {
+        const dref_def_t *d = &drefs[i];
+        dref_ids[i] = XPLMRegisterDataAccessor(d->name, d->type, 0,
+                          d->type == xplmType_Int ? get_int : NULL, NULL,
+                          d->type == xplmType_Float ? get_float : NULL, NULL,
+                          NULL, NULL, NULL, NULL, NULL, NULL,
+                          d->type == xplmType_Data ? get_str : NULL, NULL,
+                          d->ref, NULL);
+    }
+}
+
+/* take a new OFP, call from the main thread */
+void
+tlsb_dref_publish(const ofp_info_t *ofp_info)
+{
+    snap.ofp = *ofp_info;
+    /* the struct is zeroed, but strncpy'ed fields may lack the terminator */
+#define T(f) snap.ofp.f[sizeof(snap.ofp.f) - 1] = '\0'
+    T(units); T(icao_airline); T(flight_number); T(aircraft_icao); T(origin); T(origin_rwy);
+    T(destination); T(destination_rwy); T(alternate); T(route); T(alt_route);
+    T(time_generated); T(airac);
+#undef T
+    set_strings();
+
+    snap.valid = ofp_info->valid;
+    snap.ci = atoi(ofp_info->ci);
+    snap.cruise_fl = atoi(ofp_info->altitude);
+    snap.pax_count = atoi(ofp_info->pax_count);
+    snap.est_time_enroute = atoi(ofp_info->est_time_enroute);
+    snap.isa_dev = atoi(ofp_info->isa_dev);
+    snap.wind_component = atoi(ofp_info->wind_component);
+    snap.tropopause = atoi(ofp_info->tropopause);
+    snap.max_passengers = atoi(ofp_info->max_passengers);
+    snap.fuel_plan_ramp = atof(ofp_info->fuel_plan_ramp);
+    snap.freight = atof(ofp_info->freight);
+    snap.payload = atof(ofp_info->payload);
+    snap.oew = atof(ofp_info->oew);
+    snap.generation++;
+}
+
+void
+tlsb_dref_cleanup(void)
+{
+    for (unsigned i = 0; i < N_DREF; i++)
+        if (dref_ids[i]) {
+            XPLMUnregisterDataAccessor(dref_ids[i]);
+            dref_ids[i] = NULL;
+        }
+}
@@ -0,0 +1,187 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* small file helpers that differ between platforms */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "tlsb.h"
+
+/* return size of file or -1 if it does not exist */
+long
+tlsb_file_size(const char *fn)
+{
+    struct stat sb;
+    if (0 != stat(fn, &sb))
+        return -1;
+    return sb.st_size;
+}
+
+/* return success == 1 */
+int
+tlsb_file_stat(const char *fn, long *size, long *mtime)
+{
+    struct stat sb;
+    if (0 != stat(fn, &sb))
+        return 0;
+    *size = sb.st_size;
+    *mtime = sb.st_mtime;
+    return 1;
+}
+
+/* create directory if it does not exist, return success == 1 */
+int
+tlsb_mkdir(const char *dir)
+{
+#ifdef WINDOWS
+    int res = mkdir(dir);
+#else
+    int res = mkdir(dir, 0755);
+#endif
+    if (0 != res && EEXIST != errno) {
+        log_msg("Can't create directory '%s'", dir);
+        return 0;
+    }
+    return 1;
+}
+
+/* rename replacing an existing target, return success == 1 */
+int
+tlsb_rename(const char *from, const char *to)
+{
+#ifdef WINDOWS
+    /* rename() fails on windows if the target exists */
+    if (! MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        log_msg("Can't rename '%s' to '%s': %u", from, to, GetLastError());
+        return 0;
+    }
+#else
+    if (0 != rename(from, to)) {
+        log_msg("Can't rename '%s' to '%s'", from, to);
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+/* copy to a temp file and rename, return success == 1 */
+int
+tlsb_copy_file(const char *from, const char *to)
+{
+    char tfn[520], buffer[16 * 1024];
+
+    snprintf(tfn, sizeof(tfn), "%s.tmp", to);
+    FILE *in = fopen(from, "rb");
+    if (NULL == in) {
+        log_msg("Can't open '%s'", from);
+        return 0;
+    }
+
+    FILE *out = fopen(tfn, "wb");
+    if (NULL == out) {
+        log_msg("Can't create file '%s'", tfn);
+        fclose(in);
+        return 0;
+    }
+
+    int res = 1;
+    size_t n;
+    while (0 < (n = fread(buffer, 1, sizeof(buffer), in)))
+        if (n != fwrite(buffer, 1, n, out)) {
+            res = 0;
+            break;
+        }
+
+    fclose(in);
+    if (fclose(out))
+        res = 0;
+
+    if (res)
+        res = tlsb_rename(tfn, to);
+
+    if (!res)
+        unlink(tfn);
+    return res;
+}
+
+/* map a whole file read only, returns NULL on failure */
+void *
+tlsb_map_file(const char *fn, long *size)
+{
+    void *addr = NULL;
+    long sz = tlsb_file_size(fn);
+    if (sz <= 0)
+        return NULL;
+
+#ifdef WINDOWS
+    HANDLE fh = CreateFileA(fn, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == fh)
+        return NULL;
+
+    HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mh) {
+        addr = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mh);    /* the view keeps the mapping alive */
+    }
+    CloseHandle(fh);
+#else
+    int fd = open(fn, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    addr = mmap(NULL, sz, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == addr)
+        addr = NULL;
+#endif
+
+    if (NULL == addr)
+        log_msg("Can't map '%s'", fn);
+    else
+        *size = sz;
+    return addr;
+}
+
+void
+tlsb_unmap_file(void *addr, long size)
+{
+#ifdef WINDOWS
+    UnmapViewOfFile(addr);
+#else
+    munmap(addr, size);
+#endif
+}
@@ -0,0 +1,204 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Write an X-Plane 11/12 .fms flight plan from the navlog of the OFP,
+ * so no second download is needed.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "tlsb.h"
+
+typedef struct {
+    char *data;
+    int len, size;
+} strbuf_t;
+
+static void
+sb_printf(strbuf_t *sb, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(sb->data + sb->len, sb->size - sb->len, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        sb->len += n;
+    if (sb->len > sb->size - 1)
+        sb->len = sb->size - 1;     /* truncated, caught by the caller */
+}
+
+/* X-Plane waypoint type or 0 for pseudo waypoints like TOC/TOD */
+static int
+fix_type(const char *type)
+{
+    if (0 == strcmp(type, "apt")) return 1;
+    if (0 == strcmp(type, "ndb")) return 2;
+    if (0 == strcmp(type, "vor")) return 3;
+    if (0 == strcmp(type, "wpt")) return 11;
+    if (0 == strcmp(type, "ltlg")) return 28;
+    return 0;
+}
+
+/* return 1 if content equals the file */
+static int
+same_content(const char *fn, const char *data, int len)
+{
+    if (tlsb_file_size(fn) != len)
+        return 0;
+
+    FILE *f = fopen(fn, "rb");
+    if (NULL == f)
+        return 0;
+
+    char *buffer = tlsb_malloc(TLSB_MEM_FMS, len + 1);
+    int res = (buffer && len == (int)fread(buffer, 1, len, f) && 0 == memcmp(buffer, data, len));
+    tlsb_free(buffer);
+    fclose(f);
+    return res;
+}
+
+/*
+ * Enroute part: all fixes that are not part of a SID/STAR, plus the last fix
+ * of the SID and the first of the STAR. Airports are written as ADEP/ADES.
+ * An unchanged file is not rewritten. Return success == 1.
+ */
+int
+tlsb_write_fms(const ofp_info_t *ofp_info, const char *fn, int *changed)
+{
+    const ofp_fix_t *nl = ofp_info->navlog;
+    int n = ofp_info->n_fix;
+    const char *sid = "", *star = "";
+    int res = 0;
+
+    *changed = 0;
+    if (0 == n) {
+        log_msg("OFP has no navlog");
+        return 0;
+    }
+
+    /* an incomplete route must not look like a complete one */
+    if (ofp_info->navlog_truncated) {
+        log_msg("navlog is truncated, can't write the .fms");
+        return 0;
+    }
+
+    /* first and last enroute fix */
+    int first = -1, last = -1;
+    for (int i = 0; i < n; i++)
+        if (!nl[i].is_sid_star && fix_type(nl[i].type) > 1) {
+            if (first < 0)
+                first = i;
+            last = i;
+        }
+
+    for (int i = 0; i < n && (first < 0 || i < first); i++)
+        if (nl[i].is_sid_star)
+            sid = nl[i].via;
+
+    for (int i = n - 1; i > last; i--)
+        if (nl[i].is_sid_star)
+            star = nl[i].via;
+
+    strbuf_t sb = { tlsb_malloc(TLSB_MEM_FMS, 64 * 1024), 0, 64 * 1024 };
+    if (NULL == sb.data)
+        return 0;
+
+    sb_printf(&sb, "I\n1100 Version\nCYCLE %s\n", ofp_info->airac);
+    sb_printf(&sb, "ADEP %s\n", ofp_info->origin);
+    if (ofp_info->origin_rwy[0])
+        sb_printf(&sb, "DEPRWY RW%s\n", ofp_info->origin_rwy);
+    if (sid[0])
+        sb_printf(&sb, "SID %s\n", sid);
+    sb_printf(&sb, "ADES %s\n", ofp_info->destination);
+    if (ofp_info->destination_rwy[0])
+        sb_printf(&sb, "DESRWY RW%s\n", ofp_info->destination_rwy);
+    if (star[0])
+        sb_printf(&sb, "STAR %s\n", star);
+
+    /* collect enroute fixes first, we need the count upfront */
+    int idx[OFP_MAX_FIX], n_enr = 0;
+    for (int i = 0; i < n; i++) {
+        int type = fix_type(nl[i].type);
+        if (type <= 1)
+            continue;
+
+        int sid_exit = nl[i].is_sid_star && i < first && (i + 1 >= n || !nl[i + 1].is_sid_star);
+        int star_entry = nl[i].is_sid_star && i > last && (i == 0 || !nl[i - 1].is_sid_star);
+        if (nl[i].is_sid_star && !sid_exit && !star_entry && first >= 0)
+            continue;
+        idx[n_enr++] = i;
+    }
+
+    sb_printf(&sb, "NUMENR %d\n", n_enr + 2);
+    sb_printf(&sb, "1 %s ADEP %f %f %f\n", ofp_info->origin, atof(ofp_info->origin_elevation),
+              atof(ofp_info->origin_lat), atof(ofp_info->origin_lon));
+
+    for (int k = 0; k < n_enr; k++) {
+        const ofp_fix_t *fix = &nl[idx[k]];
+        const char *via = fix->via;
+        if (k == 0 || fix->is_sid_star || via[0] == '\0' || 0 == strcmp(via, "DCT"))
+            via = "DRCT";
+        sb_printf(&sb, "%d %s %s %f %f %f\n", fix_type(fix->type), fix->ident, via,
+                  (double)fix->altitude, fix->lat, fix->lon);
+    }
+
+    sb_printf(&sb, "1 %s ADES %f %f %f\n", ofp_info->destination, atof(ofp_info->destination_elevation),
+              atof(ofp_info->destination_lat), atof(ofp_info->destination_lon));
+
+    if (sb.len >= sb.size - 1) {
+        log_msg("fms plan too large");
+        goto out;
+    }
+
+    if (same_content(fn, sb.data, sb.len)) {
+        res = 1;
+        goto out;
+    }
+
+    /* write to a temp file and rename so the FMS never sees a partial file */
+    char tfn[520];
+    snprintf(tfn, sizeof(tfn), "%s.tmp", fn);
+    FILE *f = fopen(tfn, "wb");
+    if (NULL == f) {
+        log_msg("Can't create '%s'", tfn);
+        goto out;
+    }
+
+    res = (sb.len == (int)fwrite(sb.data, 1, sb.len, f));
+    if (fclose(f))
+        res = 0;
+    res = res && tlsb_rename(tfn, fn);
+    if (!res)
+        unlink(tfn);
+    *changed = res;
+
+  out:
+    tlsb_free(sb.data);
+    return res;
+}
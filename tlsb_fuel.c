@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Fuel on board against the planned burn.
+ *
+ * The plan is a table of (time after takeoff, planned FOB) points from the
+ * navlog. Time only moves forward so the segment cursor advances by a step
+ * now and then and each update is O(1).
+ * The trend is the change of the delta per hour, sampled every TREND_S seconds
+ * and smoothed.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tlsb.h"
+
+#define TREND_S 60.0f
+#define TREND_ALPHA 0.3f
+
+/* build the plan table, return # of points, < 2 if the navlog has no fuel data */
+int
+tlsb_fuel_plan(tlsb_fuel_mon_t *fm, const ofp_info_t *ofp_info)
+{
+    float to_kg = (0 == strcmp("lbs", ofp_info->units)) ? LB_2_KG : 1.0f;
+    memset(fm, 0, sizeof(*fm));
+
+    /* the plan would freeze at the last fix kept */
+    if (ofp_info->navlog_truncated) {
+        log_msg("navlog is truncated, no fuel monitor");
+        return 0;
+    }
+
+    float fob = atof(ofp_info->fuel_plan_takeoff);
+    if (fob > 0.0f) {
+        fm->t[0] = 0.0f;
+        fm->fob[0] = fob * to_kg;
+        fm->n = 1;
+    }
+
+    for (int i = 0; i < ofp_info->n_fix; i++) {
+        const ofp_fix_t *fix = &ofp_info->navlog[i];
+        if (fix->fuel_onboard <= 0.0f)
+            continue;
+
+        /* fixes with the same time, e.g. TOD right after a waypoint */
+        if (fm->n > 0 && fix->time_total <= fm->t[fm->n - 1])
+            continue;
+
+        fm->t[fm->n] = fix->time_total;
+        fm->fob[fm->n] = fix->fuel_onboard * to_kg;
+        fm->n++;
+    }
+
+    fm->t_sample = -1.0f;
+    return fm->n;
+}
+
+/* t = s after takeoff, fob = actual fuel on board in kg */
+void
+tlsb_fuel_update(tlsb_fuel_mon_t *fm, float t, float fob)
+{
+    if (fm->n < 2)
+        return;
+
+    /* time went back, e.g. a situation was loaded */
+    if (t < fm->t[fm->cur] || t < fm->t_sample) {
+        fm->cur = 0;
+        fm->t_sample = -1.0f;
+    }
+
+    while (fm->cur < fm->n - 2 && t >= fm->t[fm->cur + 1])
+        fm->cur++;
+
+    int c = fm->cur;
+    float f = (t - fm->t[c]) / (fm->t[c + 1] - fm->t[c]);
+    if (f < 0.0f) f = 0.0f;
+    if (f > 1.0f) f = 1.0f;
+    fm->plan = fm->fob[c] + f * (fm->fob[c + 1] - fm->fob[c]);
+    fm->delta = fob - fm->plan;
+
+    if (fm->t_sample < 0.0f) {
+        fm->trend_valid = 0;
+        fm->t_sample = t;
+        fm->delta_sample = fm->delta;
+    } else if (t - fm->t_sample >= TREND_S) {
+        float rate = (fm->delta - fm->delta_sample) * 3600.0f / (t - fm->t_sample);
+        fm->trend = fm->trend_valid ? fm->trend + TREND_ALPHA * (rate - fm->trend) : rate;
+        fm->trend_valid = 1;
+        fm->t_sample = t;
+        fm->delta_sample = fm->delta;
+    }
+}
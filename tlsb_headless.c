@@ -0,0 +1,356 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Headless driver for the plugin, linked against the stub XPLM/Widgets runtime.
+ * Runs a script of user and sim actions and reports CPU time and allocations
+ * of every plugin callback, so draw and xfer path regressions show up on any
+ * Linux box.
+ *
+ * tlsb_headless [options] action ...
+ *
+ * options:
+ * -x xp_dir        X-Plane directory, the directories the plugin needs are created
+ *                  (default ./xp_headless/)
+ * -a acf_file      aircraft file (default A321.acf)
+ * -i icao          ICAO of the aircraft (default A321)
+ * -p pilot_id      write the plugin's preferences for that pilot id
+ * -w dir           with -p: load OFPs written to dir
+ * -t transport     native, record:<dir>, replay:<dir> or replay-fast:<dir>
+ * -f ms            frame time (default 20)
+ * -l site=us[/allocs]  fail if the callbacks starting with site take more than us
+ *                  per call on average or make more than allocs allocations in a call
+ * -q               don't show the plugin's log
+ *
+ * actions:
+ * load, unload                 user aircraft loaded / unloaded
+ * disable, enable              the plugin disabled / enabled by the user
+ * frames n                     run n frames
+ * cmd name                     a command, e.g. tlsb/fetch_xfer
+ * menu item                    a plugins menu item, e.g. "Show widget"
+ * button label                 push a button
+ * type caption text            enter text into the field right of a caption, e.g. "Find:"
+ * wheel n                      turn the mouse wheel over the scroll view
+ * dref name                    show a dataref
+ * screen                       strings drawn in the last frame
+ * writes                       dataref writes and commands the plugin sent
+ * copy from to                 copy a file, e.g. an OFP into the watch directory
+ * set name value               set a dataref of the sim
+ * fly s flow lat lon           fly s seconds of sim time to lat/lon burning flow kg/h,
+ *                              20 frames/s without waiting, then stay airborne
+ *
+ * default: load frames 50 menu "Show widget" frames 50
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "XPLMPlugin.h"
+#include "XPWidgets.h"
+#include "XPStandardWidgets.h"
+
+#include "tlsb.h"
+#include "xplm_stub.h"
+
+extern int XPluginStart(char *name, char *sig, char *desc);
+extern void XPluginStop(void);
+extern int XPluginEnable(void);
+extern void XPluginDisable(void);
+extern void XPluginReceiveMessage(XPLMPluginID from, long msg, void *param);
+
+#define MAX_LIMIT 20
+static struct {
+    char site[60];
+    double us;
+    long allocs;
+} limit[MAX_LIMIT];
+static int n_limit;
+
+static void
+mkdirs(const char *dir)
+{
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "%s", dir);
+    for (char *s = tmp + 1; *s; s++)
+        if (*s == '/') {
+            *s = '\0';
+            mkdir(tmp, 0755);
+            *s = '/';
+        }
+    mkdir(tmp, 0755);
+}
+
+static void
+setup(const char *xpdir, const char *icao, const char *pilot_id, const char *watch_dir)
+{
+    char path[600];
+
+    snprintf(path, sizeof(path), "%sResources/plugins/ToLissData/Situations", xpdir);
+    mkdirs(path);
+    snprintf(path, sizeof(path), "%sOutput/FMS plans", xpdir);
+    mkdirs(path);
+    snprintf(path, sizeof(path), "%sOutput/preferences", xpdir);
+    mkdirs(path);
+
+    if (pilot_id) {
+        /* pilot id, pdf, fms, asxp, prefetch, watch */
+        snprintf(path, sizeof(path), "%sOutput/preferences/toliss_simbrief.prf", xpdir);
+        FILE *f = fopen(path, "wb");
+        if (f) {
+            fprintf(f, "%s\n0\n0\n0\n0\n%d%s\n", pilot_id, watch_dir ? 1 : 0, watch_dir ? watch_dir : "");
+            fclose(f);
+        }
+    }
+
+    /* what the sim and the ToLiss provide */
+    xplm_stub_dataref("sim/graphics/VR/enabled", 0);
+    xplm_stub_dataref_bytes("sim/aircraft/view/acf_ICAO", icao);
+    xplm_stub_dataref("AirbusFBW/NoPax", 0);
+    xplm_stub_dataref("AirbusFBW/PaxDistrib", 0);
+    xplm_stub_dataref("AirbusFBW/AftCargo", 0);
+    xplm_stub_dataref("AirbusFBW/FwdCargo", 0);
+    xplm_stub_dataref("AirbusFBW/WriteFOB", 0);
+    xplm_stub_dataref("AirbusFBW/PopUpHeightArray", 0);
+    xplm_stub_dataref("sim/flightmodel/weight/m_fuel_total", 0);
+    xplm_stub_dataref("sim/flightmodel/failures/onground_any", 1);
+    xplm_stub_dataref("sim/time/total_flight_time_sec", 0);
+    xplm_stub_dataref("sim/time/zulu_time_sec", 12 * 3600);
+    xplm_stub_dataref("sim/flightmodel/position/latitude", 0);
+    xplm_stub_dataref("sim/flightmodel/position/longitude", 0);
+    xplm_stub_dataref("sim/flightmodel/position/groundspeed", 0);
+    xplm_stub_command("AirbusFBW/SetWeightAndCG");
+    xplm_stub_command("toliss_airbus/iscs_open");
+}
+
+static void
+frames(int n, int frame_ms)
+{
+    for (int i = 0; i < n; i++) {
+        xplm_stub_frame();
+        usleep(frame_ms * 1000);
+    }
+}
+
+/* sim time, fuel and position go on with every frame, on a straight line in lat/lon */
+static void
+fly(double s, double flow, double lat1, double lon1)
+{
+    double t = xplm_stub_value("sim/time/total_flight_time_sec");
+    double zulu = xplm_stub_value("sim/time/zulu_time_sec");
+    double fuel = xplm_stub_value("sim/flightmodel/weight/m_fuel_total");
+    double lat0 = xplm_stub_value("sim/flightmodel/position/latitude");
+    double lon0 = xplm_stub_value("sim/flightmodel/position/longitude");
+
+    double dlat = lat1 - lat0, dlon = (lon1 - lon0) * cos((lat0 + lat1) * M_PI / 360.0);
+    double gs = 60.0 * sqrt(dlat * dlat + dlon * dlon) / s * 1852.0;     /* m/s */
+
+    xplm_stub_dataref("sim/flightmodel/failures/onground_any", 0);
+    xplm_stub_dataref("sim/flightmodel/position/groundspeed", gs);
+    int n = (int)(s / 0.05);
+    for (int i = 1; i <= n; i++) {
+        double f = (double)i / n;
+        t += 0.05;
+        zulu += 0.05;
+        fuel -= flow * 0.05 / 3600.0;
+        xplm_stub_dataref("sim/time/total_flight_time_sec", t);
+        xplm_stub_dataref("sim/time/zulu_time_sec", zulu);
+        xplm_stub_dataref("sim/flightmodel/weight/m_fuel_total", fuel);
+        xplm_stub_dataref("sim/flightmodel/position/latitude", lat0 + f * (lat1 - lat0));
+        xplm_stub_dataref("sim/flightmodel/position/longitude", lon0 + f * (lon1 - lon0));
+        xplm_stub_frame();
+    }
+}
+
+static void
+message(const char *site, long msg)
+{
+    xplm_stub_measure_begin(site);
+    XPluginReceiveMessage(0, msg, NULL);
+    xplm_stub_measure_end();
+}
+
+static int
+need(int argc, int i, int n)
+{
+    if (i + n >= argc) {
+        fprintf(stderr, "missing argument\n");
+        exit(2);
+    }
+    return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *xpdir = "./xp_headless/", *acf_file = "A321.acf", *icao = "A321";
+    const char *pilot_id = NULL, *watch_dir = NULL;
+    int frame_ms = 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "+x:a:i:p:w:t:f:l:q")) != -1) {
+        switch (opt) {
+            case 'x': xpdir = optarg; break;
+            case 'a': acf_file = optarg; break;
+            case 'i': icao = optarg; break;
+            case 'p': pilot_id = optarg; break;
+            case 'w': watch_dir = optarg; break;
+            case 'f': frame_ms = atoi(optarg); break;
+            case 'q': xplm_stub_quiet(1); break;
+
+            case 't':
+                if (!tlsb_transport_select(optarg))
+                    exit(2);
+                break;
+
+            case 'l':
+                if (n_limit < MAX_LIMIT) {
+                    limit[n_limit].us = -1;
+                    limit[n_limit].allocs = -1;
+                    if (sscanf(optarg, "%59[^=]=%lf/%ld", limit[n_limit].site, &limit[n_limit].us,
+                               &limit[n_limit].allocs) < 2) {
+                        fprintf(stderr, "bad limit '%s'\n", optarg);
+                        exit(2);
+                    }
+                    n_limit++;
+                }
+                break;
+
+            default:
+                exit(2);
+        }
+    }
+
+    static char *dflt[] = { "load", "frames", "50", "menu", "Show widget", "frames", "50" };
+    if (optind == argc) {
+        argv = dflt;
+        argc = sizeof(dflt) / sizeof(dflt[0]);
+        optind = 0;
+    }
+
+    char xpdir_s[512];
+    snprintf(xpdir_s, sizeof(xpdir_s), "%s%s", xpdir, xpdir[strlen(xpdir) - 1] == '/' ? "" : "/");
+
+    char acf_path[600];
+    snprintf(acf_path, sizeof(acf_path), "%sAircraft/%s", xpdir_s, acf_file);
+    xplm_stub_init(xpdir_s, acf_file, acf_path);
+    setup(xpdir_s, icao, pilot_id, watch_dir);
+
+    char name[256], sig[256], desc[256];
+    xplm_stub_measure_begin("XPluginStart");
+    XPluginStart(name, sig, desc);
+    xplm_stub_measure_end();
+    xplm_stub_measure_begin("XPluginEnable");
+    XPluginEnable();
+    xplm_stub_measure_end();
+
+    for (int i = optind; i < argc; i++) {
+        const char *a = argv[i];
+
+        if (0 == strcmp(a, "load")) {
+            message("msg PLANE_LOADED", XPLM_MSG_PLANE_LOADED);
+        } else if (0 == strcmp(a, "unload")) {
+            message("msg PLANE_UNLOADED", XPLM_MSG_PLANE_UNLOADED);
+        } else if (0 == strcmp(a, "disable")) {
+            xplm_stub_measure_begin("XPluginDisable");
+            XPluginDisable();
+            xplm_stub_measure_end();
+        } else if (0 == strcmp(a, "enable")) {
+            xplm_stub_measure_begin("XPluginEnable");
+            XPluginEnable();
+            xplm_stub_measure_end();
+        } else if (0 == strcmp(a, "frames") && need(argc, i, 1)) {
+            frames(atoi(argv[++i]), frame_ms);
+        } else if (0 == strcmp(a, "cmd") && need(argc, i, 1)) {
+            if (!xplm_stub_run_command(argv[++i]))
+                fprintf(stderr, "no command '%s'\n", argv[i]);
+        } else if (0 == strcmp(a, "menu") && need(argc, i, 1)) {
+            if (!xplm_stub_menu(argv[++i]))
+                fprintf(stderr, "no menu item '%s'\n", argv[i]);
+        } else if (0 == strcmp(a, "button") && need(argc, i, 1)) {
+            void *w = xplm_stub_find_widget(argv[++i]);
+            if (w)
+                xplm_stub_send(w, xpMsg_PushButtonPressed, xpMode_UpChain, (intptr_t)w, 0);
+            else
+                fprintf(stderr, "no button '%s'\n", argv[i]);
+        } else if (0 == strcmp(a, "type") && need(argc, i, 2)) {
+            void *w = xplm_stub_find_widget(argv[++i]);
+            w = w ? xplm_stub_next_widget(w, 1) : NULL;
+            if (w)
+                xplm_stub_set_descriptor(w, argv[i + 1]);
+            else
+                fprintf(stderr, "no text field right of '%s'\n", argv[i]);
+            i++;
+        } else if (0 == strcmp(a, "wheel") && need(argc, i, 1)) {
+            /* the scroll view is the custom widget created before its scroll bar */
+            void *w = xplm_stub_find_class(xpWidgetClass_ScrollBar);
+            w = w ? xplm_stub_next_widget(w, -1) : NULL;
+            XPMouseState_t ms = { 0, 0, 0, atoi(argv[++i]) };
+            if (w)
+                xplm_stub_send(w, xpMsg_MouseWheel, xpMode_Direct, (intptr_t)&ms, 0);
+            else
+                fprintf(stderr, "no scroll view\n");
+        } else if (0 == strcmp(a, "dref") && need(argc, i, 1)) {
+            char buf[1024];
+            if (xplm_stub_read_dataref(argv[++i], buf, sizeof(buf)))
+                printf("%s = '%s'\n", argv[i], buf);
+            else
+                fprintf(stderr, "no dataref '%s'\n", argv[i]);
+        } else if (0 == strcmp(a, "screen")) {
+            xplm_stub_screen(stdout);
+        } else if (0 == strcmp(a, "writes")) {
+            xplm_stub_writes(stdout);
+        } else if (0 == strcmp(a, "set") && need(argc, i, 2)) {
+            xplm_stub_dataref(argv[i + 1], atof(argv[i + 2]));
+            i += 2;
+        } else if (0 == strcmp(a, "fly") && need(argc, i, 4)) {
+            fly(atof(argv[i + 1]), atof(argv[i + 2]), atof(argv[i + 3]), atof(argv[i + 4]));
+            i += 4;
+        } else if (0 == strcmp(a, "copy") && need(argc, i, 2)) {
+            if (!tlsb_copy_file(argv[i + 1], argv[i + 2]))
+                fprintf(stderr, "can't copy '%s'\n", argv[i + 1]);
+            i += 2;
+        } else {
+            fprintf(stderr, "unknown action '%s'\n", a);
+            exit(2);
+        }
+    }
+
+    xplm_stub_measure_begin("XPluginDisable");
+    XPluginDisable();
+    xplm_stub_measure_end();
+    xplm_stub_measure_begin("XPluginStop");
+    XPluginStop();
+    xplm_stub_measure_end();
+
+    xplm_stub_report(stdout);
+
+    int n_viol = 0;
+    for (int i = 0; i < n_limit; i++)
+        n_viol += xplm_stub_check(limit[i].site, limit[i].us, limit[i].allocs);
+    exit(n_viol ? 1 : 0);
+}
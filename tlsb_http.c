@@ -0,0 +1,653 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Common http layer on top of the backends (curl or WinHTTP).
+ *
+ * It keeps a short latency history per host and derives timeouts from that,
+ * retries failed requests with exponential backoff and jitter and optionally
+ * sends a hedged second request if the first one is slow to respond.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "tlsb.h"
+
+#define N_SAMPLE 32
+#define N_HOST 4
+#define MIN_SAMPLES 5           /* below that we use defaults */
+
+#define CONNECT_TIMEOUT_DEF 5000
+#define CONNECT_TIMEOUT_MIN 1500
+#define CONNECT_TIMEOUT_MAX 10000
+#define LOW_SPEED_LIMIT 512
+#define LOW_SPEED_TIME_DEF 5      /* s */
+#define LOW_SPEED_TIME_MIN 3
+#define LOW_SPEED_TIME_MAX 20
+#define BACKOFF_BASE_MS 250
+#define HEDGE_MIN_MS 200
+#define HEDGE_MAX_MS 5000
+
+typedef struct _host_stats
+{
+    char host[80];
+    int n, pos;
+    int connect[N_SAMPLE], ttfb[N_SAMPLE];
+} host_stats_t;
+
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static host_stats_t host_stats[N_HOST];
+static int host_next;
+static int n_request, n_failed, n_cancelled, n_retry, n_hedged, n_hedge_won;
+static long n_bytes, n_wire_bytes, decode_us;     /* successful compressed requests */
+static int n_live_attempts;     /* detached threads of hedged requests */
+static unsigned int rnd_state = 0x2545F491;
+
+int
+tlsb_cancelled(const tlsb_cancel_t *cancel)
+{
+    for (; cancel; cancel = cancel->parent)
+        if (cancel->cancelled)
+            return 1;
+    return 0;
+}
+
+long
+tlsb_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+static void
+url_host(const char *url, char *host, int len)
+{
+    const char *s = strstr(url, "://");
+    s = s ? s + 3 : url;
+    int n = strcspn(s, ":/?");
+    if (n >= len)
+        n = len - 1;
+    memcpy(host, s, n);
+    host[n] = '\0';
+}
+
+/* call with stats_mutex held */
+static host_stats_t *
+find_host(const char *url, int create)
+{
+    char host[80];
+    url_host(url, host, sizeof(host));
+
+    for (int i = 0; i < N_HOST; i++)
+        if (0 == strcmp(host_stats[i].host, host))
+            return &host_stats[i];
+
+    if (!create)
+        return NULL;
+
+    host_stats_t *hs = &host_stats[host_next];
+    host_next = (host_next + 1) % N_HOST;
+    memset(hs, 0, sizeof(*hs));
+    strcpy(hs->host, host);
+    return hs;
+}
+
+/* percentile of the samples, -1 if there are not enough of them */
+static int
+percentile(const int *sample, int n, int pct)
+{
+    int v[N_SAMPLE], m = 0;
+
+    for (int i = 0; i < n; i++)
+        if (sample[i] >= 0)
+            v[m++] = sample[i];
+
+    if (m < MIN_SAMPLES)
+        return -1;
+
+    /* insertion sort, it's just a few */
+    for (int i = 1; i < m; i++) {
+        int x = v[i], j = i - 1;
+        for (; j >= 0 && v[j] > x; j--)
+            v[j + 1] = v[j];
+        v[j + 1] = x;
+    }
+
+    return v[(m * pct + 99) / 100 - 1];
+}
+
+static void
+p95(const char *url, int *connect_p95, int *ttfb_p95)
+{
+    *connect_p95 = *ttfb_p95 = -1;
+    pthread_mutex_lock(&stats_mutex);
+    host_stats_t *hs = find_host(url, 0);
+    if (hs) {
+        *connect_p95 = percentile(hs->connect, hs->n, 95);
+        *ttfb_p95 = percentile(hs->ttfb, hs->n, 95);
+    }
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+static void
+record(const tlsb_http_req_t *req, int res)
+{
+    int cancelled = tlsb_cancelled(req->cancel);
+
+    pthread_mutex_lock(&stats_mutex);
+    n_request++;
+    if (cancelled)
+        n_cancelled++;
+    else if (!res)
+        n_failed++;
+
+    if (res && req->compress) {
+        n_bytes += req->ret_len;
+        n_wire_bytes += req->wire_len;
+        decode_us += req->decode_us;
+    }
+
+    if (res && req->ttfb_ms >= 0) {
+        host_stats_t *hs = find_host(req->url, 1);
+        hs->connect[hs->pos] = req->connect_ms;
+        hs->ttfb[hs->pos] = req->ttfb_ms;
+        hs->pos = (hs->pos + 1) % N_SAMPLE;
+        if (hs->n < N_SAMPLE)
+            hs->n++;
+    }
+    pthread_mutex_unlock(&stats_mutex);
+
+    char enc[100] = "";
+    if (req->content_encoding[0])
+        snprintf(enc, sizeof(enc), " (%s: %ld on the wire, decoded in %d us)", req->content_encoding,
+                 req->wire_len, req->decode_us);
+
+    log_msg("http: status %d, %ld bytes%s, connect %d ms, ttfb %d ms, total %d ms, attempt %d%s",
+            req->http_status, req->ret_len, enc, req->connect_ms, req->ttfb_ms, req->total_ms,
+            req->attempts, res ? "" : (cancelled ? ", cancelled" : ", failed"));
+}
+
+/* uniform in [0, n) */
+static int
+rnd(int n)
+{
+    pthread_mutex_lock(&stats_mutex);
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    unsigned int r = rnd_state;
+    pthread_mutex_unlock(&stats_mutex);
+    return n > 0 ? r % n : 0;
+}
+
+/* sleep unless cancelled, return 0 if cancelled */
+static int
+sleep_ms(int ms, const tlsb_cancel_t *cancel)
+{
+    long until = tlsb_now_ms() + ms;
+    while (!tlsb_cancelled(cancel)) {
+        long left = until - tlsb_now_ms();
+        if (left <= 0)
+            return 1;
+        if (left > 50)
+            left = 50;
+        struct timespec ts = { 0, left * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    return 0;
+}
+
+/* ---------------------------------------- hedged requests ---------------------------------------- */
+typedef struct _hedge hedge_t;
+
+typedef struct _attempt
+{
+    tlsb_http_req_t req;
+    char url[512];              /* the attempt may outlive the caller's request */
+    tlsb_cancel_t cancel;       /* own token, hedged_perform forwards the caller's cancel */
+    hedge_t *hedge;
+    char *data;
+    size_t len, size;
+    pthread_t tid;
+    int started, done, result;
+} attempt_t;
+
+/* the loser may take a moment to notice the cancel so the last one out frees this */
+struct _hedge
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int first_byte;
+    int refs;
+    attempt_t a[2];
+};
+
+static void
+hedge_release(hedge_t *h)
+{
+    pthread_mutex_lock(&h->mutex);
+    int refs = --h->refs;
+    pthread_mutex_unlock(&h->mutex);
+
+    if (refs > 0)
+        return;
+
+    for (int i = 0; i < 2; i++)
+        tlsb_free(h->a[i].data);
+    pthread_cond_destroy(&h->cond);
+    pthread_mutex_destroy(&h->mutex);
+    tlsb_free(h);
+}
+
+static size_t
+attempt_write_cb(const void *ptr, size_t len, tlsb_http_req_t *req)
+{
+    attempt_t *a = req->write_ctx;
+
+    if (a->len + len > a->size) {
+        size_t size = a->size ? 2 * a->size : 256 * 1024;
+        while (a->len + len > size)
+            size *= 2;
+
+        char *data = tlsb_realloc(TLSB_MEM_HTTP, a->data, size);
+        if (NULL == data)
+            return 0;
+        a->data = data;
+        a->size = size;
+    }
+
+    memcpy(a->data + a->len, ptr, len);
+    a->len += len;
+
+    if (!a->hedge->first_byte) {
+        pthread_mutex_lock(&a->hedge->mutex);
+        a->hedge->first_byte = 1;
+        pthread_cond_broadcast(&a->hedge->cond);
+        pthread_mutex_unlock(&a->hedge->mutex);
+    }
+
+    return len;
+}
+
+static void *
+attempt_proc(void *arg)
+{
+    attempt_t *a = arg;
+    int res = tlsb_http_perform(&a->req);
+
+    pthread_mutex_lock(&a->hedge->mutex);
+    a->result = res;
+    a->done = 1;
+    pthread_cond_broadcast(&a->hedge->cond);
+    pthread_mutex_unlock(&a->hedge->mutex);
+
+    hedge_release(a->hedge);
+
+    pthread_mutex_lock(&stats_mutex);
+    n_live_attempts--;
+    pthread_mutex_unlock(&stats_mutex);
+    return NULL;
+}
+
+static int
+attempt_start(hedge_t *h, int i, const tlsb_http_req_t *req)
+{
+    attempt_t *a = &h->a[i];
+    if (snprintf(a->url, sizeof(a->url), "%s", req->url) >= (int)sizeof(a->url))
+        return 0;
+
+    /* a detached loser must not touch anything of the caller */
+    a->req = *req;
+    a->req.url = a->url;
+    a->req.f = NULL;
+    a->req.write_cb = attempt_write_cb;
+    a->req.write_ctx = a;
+    a->cancel.cancelled = 0;
+    a->cancel.parent = NULL;
+    a->req.cancel = &a->cancel;
+    a->hedge = h;
+
+    pthread_mutex_lock(&h->mutex);
+    h->refs++;
+    pthread_mutex_unlock(&h->mutex);
+
+    pthread_mutex_lock(&stats_mutex);
+    n_live_attempts++;
+    pthread_mutex_unlock(&stats_mutex);
+
+    a->started = (0 == pthread_create(&a->tid, NULL, attempt_proc, a));
+    if (a->started) {
+        pthread_detach(a->tid);
+    } else {
+        hedge_release(h);
+        pthread_mutex_lock(&stats_mutex);
+        n_live_attempts--;
+        pthread_mutex_unlock(&stats_mutex);
+    }
+    return a->started;
+}
+
+/* wait for a condition or until deadline, call with mutex held */
+static void
+hedge_wait(hedge_t *h, long deadline_ms)
+{
+    long wait_ms = deadline_ms - tlsb_now_ms();
+    if (wait_ms > 100)
+        wait_ms = 100;      /* poll the cancel token of the caller */
+    if (wait_ms <= 0)
+        return;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += wait_ms * 1000000L;
+    ts.tv_sec += ts.tv_nsec / 1000000000L;
+    ts.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(&h->cond, &h->mutex, &ts);
+}
+
+static int
+hedged_perform(tlsb_http_req_t *req)
+{
+    int connect_p95, ttfb_p95;
+    p95(req->url, &connect_p95, &ttfb_p95);
+
+    /* without history we don't know what "slow" is */
+    if (ttfb_p95 < 0)
+        return tlsb_http_perform(req);
+
+    int delay = ttfb_p95;
+    if (delay < HEDGE_MIN_MS) delay = HEDGE_MIN_MS;
+    if (delay > HEDGE_MAX_MS) delay = HEDGE_MAX_MS;
+
+    hedge_t *h = tlsb_calloc(TLSB_MEM_HTTP, 1, sizeof(hedge_t));
+    if (NULL == h)
+        return tlsb_http_perform(req);
+
+    pthread_mutex_init(&h->mutex, NULL);
+    pthread_cond_init(&h->cond, NULL);
+    h->refs = 1;
+
+    if (!attempt_start(h, 0, req)) {
+        hedge_release(h);
+        return tlsb_http_perform(req);
+    }
+
+    long hedge_at = tlsb_now_ms() + delay;
+    int winner = -1;
+
+    pthread_mutex_lock(&h->mutex);
+    while (1) {
+        if (tlsb_cancelled(req->cancel))
+            break;
+
+        if (!h->a[1].started && !h->first_byte && !h->a[0].done && tlsb_now_ms() >= hedge_at) {
+            log_msg("http: no response after %d ms, sending hedged request", delay);
+            pthread_mutex_unlock(&h->mutex);
+            attempt_start(h, 1, req);
+            pthread_mutex_lock(&h->mutex);
+            pthread_mutex_lock(&stats_mutex);
+            n_hedged++;
+            pthread_mutex_unlock(&stats_mutex);
+        }
+
+        int all_done = 1;
+        for (int i = 0; i < 2; i++) {
+            if (h->a[i].started && h->a[i].done && h->a[i].result && winner < 0)
+                winner = i;
+            if (h->a[i].started && !h->a[i].done)
+                all_done = 0;
+        }
+
+        if (winner >= 0 || all_done)
+            break;
+
+        hedge_wait(h, h->a[1].started ? tlsb_now_ms() + 100 : hedge_at);
+    }
+
+    /* cancel the loser(s), they free themselves when done */
+    for (int i = 0; i < 2; i++)
+        if (h->a[i].started && i != winner)
+            h->a[i].cancel.cancelled = 1;
+    pthread_mutex_unlock(&h->mutex);
+
+    if (1 == winner) {
+        pthread_mutex_lock(&stats_mutex);
+        n_hedge_won++;
+        pthread_mutex_unlock(&stats_mutex);
+    }
+
+    /* report the winner or the first attempt if that is finished */
+    attempt_t *a = &h->a[winner < 0 ? 0 : winner];
+    req->ret_len = 0;
+    if (a->done) {
+        req->http_status = a->req.http_status;
+        req->accept_ranges = a->req.accept_ranges;
+        req->total_length = a->req.total_length;
+        req->connect_ms = a->req.connect_ms;
+        req->ttfb_ms = a->req.ttfb_ms;
+        req->total_ms = a->req.total_ms;
+        req->wire_len = a->req.wire_len;
+        req->decode_us = a->req.decode_us;
+        memcpy(req->content_encoding, a->req.content_encoding, sizeof(req->content_encoding));
+    }
+
+    int res = (winner >= 0);
+    if (res && a->len > 0) {
+        if (req->write_cb)
+            res = (a->len == req->write_cb(a->data, a->len, req));
+        else if (req->f)
+            res = (a->len == fwrite(a->data, 1, a->len, req->f));
+        req->ret_len = a->len;
+    }
+
+    hedge_release(h);
+    return res;
+}
+
+/* ---------------------------------------- status check ---------------------------------------- */
+/* the server may do better on the next try */
+static int
+retryable_status(int status)
+{
+    return 408 == status || 429 == status || status >= 500;
+}
+
+typedef struct {
+    size_t (*write_cb)(const void *ptr, size_t len, tlsb_http_req_t *req);
+    void *write_ctx;
+    int rejected;
+} status_ctx_t;
+
+/* the body of an error response never reaches the sink of the caller */
+static size_t
+status_write_cb(const void *ptr, size_t len, tlsb_http_req_t *req)
+{
+    status_ctx_t *sc = req->write_ctx;
+
+    /* the status is in with the first byte of the body */
+    if (retryable_status(req->http_status)) {
+        sc->rejected = 1;
+        return 0;
+    }
+
+    size_t n = len;
+    if (sc->write_cb) {
+        req->write_cb = sc->write_cb;
+        req->write_ctx = sc->write_ctx;
+        n = sc->write_cb(ptr, len, req);
+        req->write_cb = status_write_cb;
+        req->write_ctx = sc;
+    } else if (req->f)
+        n = fwrite(ptr, 1, len, req->f);
+    return n;
+}
+
+static int
+status_perform(tlsb_http_req_t *req)
+{
+    status_ctx_t sc;
+    memset(&sc, 0, sizeof(sc));
+    sc.write_cb = req->write_cb;
+    sc.write_ctx = req->write_ctx;
+
+    req->write_cb = status_write_cb;
+    req->write_ctx = &sc;
+    int res = req->hedge ? hedged_perform(req) : tlsb_http_perform(req);
+    req->write_cb = sc.write_cb;
+    req->write_ctx = sc.write_ctx;
+
+    if (sc.rejected)
+        req->ret_len = 0;       /* a hedge counts the buffered error body */
+
+    if (sc.rejected || (res && retryable_status(req->http_status)))
+        res = 0;
+    return res;
+}
+
+/* ---------------------------------------- API ---------------------------------------- */
+int
+tlsb_http_request(tlsb_http_req_t *req)
+{
+    int connect_p95, ttfb_p95;
+    p95(req->url, &connect_p95, &ttfb_p95);
+
+    if (0 == req->connect_timeout_ms) {
+        int ct = CONNECT_TIMEOUT_DEF;
+        if (connect_p95 >= 0) {
+            ct = 4 * connect_p95;
+            if (ct < CONNECT_TIMEOUT_MIN) ct = CONNECT_TIMEOUT_MIN;
+            if (ct > CONNECT_TIMEOUT_MAX) ct = CONNECT_TIMEOUT_MAX;
+        }
+        req->connect_timeout_ms = ct;
+    }
+
+    if (req->connect_timeout_ms > req->timeout * 1000)
+        req->connect_timeout_ms = req->timeout * 1000;
+
+    /* the wait for the first byte counts as a stall too */
+    if (0 == req->low_speed_time) {
+        int lst = LOW_SPEED_TIME_DEF;
+        if (ttfb_p95 >= 0) {
+            lst = (2 * ttfb_p95 + 999) / 1000;
+            if (lst < LOW_SPEED_TIME_MIN) lst = LOW_SPEED_TIME_MIN;
+            if (lst > LOW_SPEED_TIME_MAX) lst = LOW_SPEED_TIME_MAX;
+        }
+        req->low_speed_time = lst;
+        req->low_speed_limit = LOW_SPEED_LIMIT;
+    }
+
+    int res;
+    for (req->attempts = 1; ; req->attempts++) {
+        res = status_perform(req);
+        record(req, res);
+
+        /* only retry if nothing went to the sink yet */
+        if (res || tlsb_cancelled(req->cancel) || req->ret_len > 0 || req->attempts > req->retries)
+            break;
+
+        int backoff = BACKOFF_BASE_MS << (req->attempts - 1);
+        backoff = backoff / 2 + rnd(backoff / 2 + 1);
+        log_msg("http: retry in %d ms", backoff);
+        if (!sleep_ms(backoff, req->cancel))
+            break;
+
+        pthread_mutex_lock(&stats_mutex);
+        n_retry++;
+        pthread_mutex_unlock(&stats_mutex);
+    }
+
+    return res;
+}
+
+int
+tlsb_http_get(const char *url, FILE *f, int *ret_len, int timeout)
+{
+    tlsb_http_req_t req;
+    memset(&req, 0, sizeof(req));
+    req.url = url;
+    req.f = f;
+    req.timeout = timeout;
+
+    int res = tlsb_http_request(&req);
+    if (res && ret_len) *ret_len = req.ret_len;
+    return res;
+}
+
+/*
+ * Wait for stray hedged requests and release the transport.
+ * Their cancel token must be cancelled already.
+ * return 1 if everything was released
+ */
+int
+tlsb_http_cleanup(int wait_ms)
+{
+    long until = tlsb_now_ms() + wait_ms;
+    int live;
+
+    while (1) {
+        pthread_mutex_lock(&stats_mutex);
+        live = n_live_attempts;
+        pthread_mutex_unlock(&stats_mutex);
+
+        if (0 == live || tlsb_now_ms() >= until)
+            break;
+
+        struct timespec ts = { 0, 10 * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+
+    if (live > 0) {
+        log_msg("http: %d requests still active, transport not released", live);
+        return 0;
+    }
+
+    tlsb_http_backend_cleanup();
+    return 1;
+}
+
+void
+tlsb_http_log_stats(void)
+{
+    pthread_mutex_lock(&stats_mutex);
+    log_msg("http stats: %d requests, %d failed, %d cancelled, %d retries, %d hedged, %d won by hedge",
+            n_request, n_failed, n_cancelled, n_retry, n_hedged, n_hedge_won);
+    if (n_bytes > 0)
+        log_msg("  compressed requests: %ld kB, %ld kB on the wire, %ld ms decoding",
+                n_bytes / 1024, n_wire_bytes / 1024, decode_us / 1000);
+
+    for (int i = 0; i < N_HOST; i++) {
+        host_stats_t *hs = &host_stats[i];
+        if (hs->n > 0)
+            log_msg("  %s: %d samples, p95 connect %d ms, p50/p95 ttfb %d/%d ms", hs->host, hs->n,
+                    percentile(hs->connect, hs->n, 95),
+                    percentile(hs->ttfb, hs->n, 50), percentile(hs->ttfb, hs->n, 95));
+    }
+    pthread_mutex_unlock(&stats_mutex);
+}
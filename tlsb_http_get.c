@@ -24,6 +24,9 @@ SOFTWARE.
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+#include <pthread.h>
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -31,18 +34,61 @@ SOFTWARE.
 
 #include "tlsb.h"
 
-int tlsb_http_get(const char *url, FILE *f, int *ret_len, int timeout)
+/* query a numeric header, -1 if not present */
+static long
+query_header_num(HINTERNET hRequest, DWORD what)
 {
+    DWORD val, len = sizeof(val);
+    if (! WinHttpQueryHeaders(hRequest, what | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX,
+                              &val, &len, WINHTTP_NO_HEADER_INDEX))
+        return -1;
+    return val;
+}
+
+static int
+query_header_str(HINTERNET hRequest, DWORD what, char *buffer, int buflen)
+{
+    WCHAR val[200];
+    DWORD len = sizeof(val);
+    if (! WinHttpQueryHeaders(hRequest, what, WINHTTP_HEADER_NAME_BY_INDEX,
+                              val, &len, WINHTTP_NO_HEADER_INDEX))
+        return 0;
+    wcstombs_s(NULL, buffer, buflen, val, _TRUNCATE);
+    return 1;
+}
+
+/* the session is kept so connections and tls sessions can be reused */
+static HINTERNET hSession;
+static pthread_once_t session_once = PTHREAD_ONCE_INIT;
+
+static void
+open_session(void)
+{
+    hSession = WinHttpOpen( L"toliss_sb",
+            WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+            WINHTTP_NO_PROXY_NAME,
+            WINHTTP_NO_PROXY_BYPASS, 0 );
+}
+
+static int
+winhttp_perform(tlsb_http_req_t *req)
+{
+    const char *url = req->url;
+    long start_ms = tlsb_now_ms();
+
     DWORD dwSize = 0;
     DWORD dwDownloaded = 0;
     BOOL  bResults = FALSE;
-    HINTERNET  hSession = NULL,
-               hConnect = NULL,
+    HINTERNET  hConnect = NULL,
                hRequest = NULL;
 
     int result = 0;
-    if (ret_len)
-        *ret_len = 0;
+    req->http_status = 0;
+    req->accept_ranges = 0;
+    req->total_length = -1;
+    req->ret_len = 0;
+    req->connect_ms = req->ttfb_ms = req->total_ms = -1;
+    req->content_encoding[0] = '\0';
 
     int url_len = strlen(url);
     WCHAR *url_wc = alloca((url_len + 1) * sizeof(WCHAR));
@@ -69,23 +115,12 @@ int tlsb_http_get(const char *url, FILE *f, int *ret_len, int timeout)
 
     char buffer[16 * 1024];
 
-    // Use WinHttpOpen to obtain a session handle.
-    hSession = WinHttpOpen( L"toliss_sb",
-            WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-            WINHTTP_NO_PROXY_NAME,
-            WINHTTP_NO_PROXY_BYPASS, 0 );
-
+    pthread_once(&session_once, open_session);
     if (NULL == hSession) {
         log_msg("Can't open HTTP session");
         goto error_out;
     }
 
-    timeout *= 1000;
-    if (! WinHttpSetTimeouts(hSession, timeout, timeout, timeout, timeout)) {
-        log_msg("can't set timeouts");
-        goto error_out;
-    }
-
     hConnect = WinHttpConnect(hSession, host_wc, urlComp.nPort, 0);
     if (NULL == hConnect) {
         log_msg("Can't open HTTP session");
@@ -100,7 +135,30 @@ int tlsb_http_get(const char *url, FILE *f, int *ret_len, int timeout)
         goto error_out;
     }
 
-    bResults = WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
+    /* WinHTTP has no low speed limit, a receive timeout is the closest thing */
+    int timeout = req->timeout * 1000;
+    int connect_timeout = req->connect_timeout_ms ? req->connect_timeout_ms : timeout;
+    int receive_timeout = req->low_speed_time ? req->low_speed_time * 1000 : timeout;
+    if (! WinHttpSetTimeouts(hRequest, connect_timeout, connect_timeout, timeout, receive_timeout)) {
+        log_msg("can't set timeouts");
+        goto error_out;
+    }
+
+    /* no WINHTTP_OPTION_DECOMPRESSION, the body is decoded in tlsb_transport.c */
+    WCHAR headers[200];
+    int hlen = 0;
+    headers[0] = L'\0';
+    if (req->range_start > 0 || req->range_end > 0) {
+        if (req->range_end > 0)
+            hlen = swprintf(headers, 100, L"Range: bytes=%ld-%ld\r\n", req->range_start, req->range_end);
+        else
+            hlen = swprintf(headers, 100, L"Range: bytes=%ld-\r\n", req->range_start);
+    }
+    if (req->compress)
+        swprintf(headers + hlen, 200 - hlen, L"Accept-Encoding: gzip, deflate\r\n");
+
+    bResults = WinHttpSendRequest(hRequest, headers[0] ? headers : WINHTTP_NO_ADDITIONAL_HEADERS,
+                                  headers[0] ? (DWORD)-1L : 0,
                                   WINHTTP_NO_REQUEST_DATA, 0, 0, 0);
     if (! bResults) {
         log_msg("Can't send HTTP request: %u", GetLastError());
@@ -109,11 +167,41 @@ int tlsb_http_get(const char *url, FILE *f, int *ret_len, int timeout)
 
     bResults = WinHttpReceiveResponse(hRequest, NULL);
     if (! bResults) {
-        log_msg("Can't receive response", GetLastError());
+        log_msg("Can't receive response: %u", GetLastError());
         goto error_out;
     }
 
+    req->ttfb_ms = tlsb_now_ms() - start_ms;
+
+    char hdr[200];
+    req->http_status = query_header_num(hRequest, WINHTTP_QUERY_STATUS_CODE);
+    if (query_header_str(hRequest, WINHTTP_QUERY_ACCEPT_RANGES, hdr, sizeof(hdr)))
+        req->accept_ranges = (NULL != strstr(hdr, "bytes"));
+
+    if (206 == req->http_status) {
+        if (query_header_str(hRequest, WINHTTP_QUERY_CONTENT_RANGE, hdr, sizeof(hdr))) {
+            char *s = strchr(hdr, '/');
+            if (s && '*' != s[1])
+                req->total_length = atol(s + 1);
+        }
+    } else {
+        req->total_length = query_header_num(hRequest, WINHTTP_QUERY_CONTENT_LENGTH);
+    }
+
+    if (query_header_str(hRequest, WINHTTP_QUERY_CONTENT_ENCODING, hdr, sizeof(hdr)))
+        snprintf(req->content_encoding, sizeof(req->content_encoding), "%s", hdr);
+
     while (1) {
+        if (tlsb_cancelled(req->cancel)) {
+            log_msg("request cancelled");
+            goto error_out;
+        }
+
+        if (tlsb_now_ms() - start_ms > timeout) {
+            log_msg("request timed out");
+            goto error_out;
+        }
+
         DWORD res = WinHttpQueryDataAvailable(hRequest, &dwSize);
         if (!res) {
             log_msg("%d, Error %u in WinHttpQueryDataAvailable.", res, GetLastError());
@@ -134,28 +222,44 @@ int tlsb_http_get(const char *url, FILE *f, int *ret_len, int timeout)
                goto error_out;
             }
 
-            if (NULL != f) {
-                fwrite(buffer, 1, dwDownloaded, f);
-                if (ferror(f)) {
+            if (req->write_cb) {
+                if (dwDownloaded != req->write_cb(buffer, dwDownloaded, req)) {
+                    log_msg("write callback failed");
+                    goto error_out;
+                }
+            } else if (NULL != req->f) {
+                fwrite(buffer, 1, dwDownloaded, req->f);
+                if (ferror(req->f)) {
                     log_msg("error wrinting file");
                     goto error_out;
                 }
             }
 
             dwSize -= dwDownloaded;
-            if (ret_len)
-                *ret_len += dwDownloaded;
+            req->ret_len += dwDownloaded;
         }
     }
 
     result = 1;
 
 error_out:
+    req->total_ms = tlsb_now_ms() - start_ms;
+
     // Close any open handles.
     if (hRequest) WinHttpCloseHandle(hRequest);
     if (hConnect) WinHttpCloseHandle(hConnect);
-    if (hSession) WinHttpCloseHandle(hSession);
 
-    log_msg("tlsb_http_get result: %d", result);
     return result;
 }
+
+/* call only when no request is active anymore */
+static void
+winhttp_cleanup(void)
+{
+    if (hSession) {
+        WinHttpCloseHandle(hSession);
+        hSession = NULL;
+    }
+}
+
+const tlsb_transport_t tlsb_transport_native = { "winhttp", winhttp_perform, winhttp_cleanup };
@@ -0,0 +1,207 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Counted allocations.
+ *
+ * Every block carries a small header with its size and subsystem so a free
+ * can be booked back without a lookup. The counters are updated with atomics
+ * as allocations happen on the fetch, download and index threads.
+ * The peak of the total restarts at a mark so a fetch can report its own.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tlsb.h"
+
+/* keeps the alignment of malloc */
+#define HDR_SIZE 16
+
+typedef struct {
+    size_t size;
+    int sub;
+} hdr_t;
+
+static const char *sub_name[TLSB_MEM_N] = {
+    "ofp", "http", "search", "navdata", "apt", "fms", "download", "ui"
+};
+
+static tlsb_mem_stat_t mem_stat[TLSB_MEM_N + 1];    /* the last one is the total */
+
+static void
+book(tlsb_mem_stat_t *s, long size)
+{
+    if (size > 0) {
+        __atomic_add_fetch(&s->bytes, size, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&s->count, 1, __ATOMIC_RELAXED);
+    }
+
+    long live = __atomic_add_fetch(&s->live, size, __ATOMIC_RELAXED);
+    long peak = __atomic_load_n(&s->peak, __ATOMIC_RELAXED);
+    while (live > peak
+           && !__atomic_compare_exchange_n(&s->peak, &peak, live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void *
+account(hdr_t *h, int sub, size_t size)
+{
+    h->size = size;
+    h->sub = sub;
+    book(&mem_stat[sub], size);
+    book(&mem_stat[TLSB_MEM_N], size);
+    return (char *)h + HDR_SIZE;
+}
+
+static void
+release(hdr_t *h)
+{
+    book(&mem_stat[h->sub], -(long)h->size);
+    book(&mem_stat[TLSB_MEM_N], -(long)h->size);
+}
+
+void *
+tlsb_malloc(int sub, size_t size)
+{
+    hdr_t *h = malloc(HDR_SIZE + size);
+    if (NULL == h)
+        return NULL;
+    return account(h, sub, size);
+}
+
+void *
+tlsb_calloc(int sub, size_t n, size_t size)
+{
+    hdr_t *h = calloc(1, HDR_SIZE + n * size);
+    if (NULL == h)
+        return NULL;
+    return account(h, sub, n * size);
+}
+
+void *
+tlsb_realloc(int sub, void *p, size_t size)
+{
+    if (NULL == p)
+        return tlsb_malloc(sub, size);
+
+    hdr_t *h = (hdr_t *)((char *)p - HDR_SIZE);
+    hdr_t old = *h;
+    h = realloc(h, HDR_SIZE + size);
+    if (NULL == h)
+        return NULL;    /* the old block is still there and booked */
+
+    release(&old);
+    return account(h, sub, size);
+}
+
+void
+tlsb_free(void *p)
+{
+    if (NULL == p)
+        return;
+
+    hdr_t *h = (hdr_t *)((char *)p - HDR_SIZE);
+    release(h);
+    free(h);
+}
+
+/*
+ * Make room for element n of a growing array, return 0 if out of memory.
+ * *p is still valid then and to be freed by the caller.
+ */
+int
+tlsb_grow(int sub, void **p, int *cap, int n, size_t sz)
+{
+    if (n < *cap)
+        return 1;
+
+    int c = *cap ? 2 * *cap : 4096;
+    while (n >= c)
+        c *= 2;
+
+    void *q = tlsb_realloc(sub, *p, (size_t)c * sz);
+    if (NULL == q) {
+        log_msg("%s: out of memory", tlsb_mem_name(sub));
+        return 0;
+    }
+
+    *p = q;
+    *cap = c;
+    return 1;
+}
+
+const char *
+tlsb_mem_name(int sub)
+{
+    return sub < TLSB_MEM_N ? sub_name[sub] : "total";
+}
+
+/* sub == TLSB_MEM_N for the total */
+void
+tlsb_mem_get(int sub, tlsb_mem_stat_t *st)
+{
+    tlsb_mem_stat_t *s = &mem_stat[sub];
+    st->bytes = __atomic_load_n(&s->bytes, __ATOMIC_RELAXED);
+    st->count = __atomic_load_n(&s->count, __ATOMIC_RELAXED);
+    st->live = __atomic_load_n(&s->live, __ATOMIC_RELAXED);
+    st->peak = __atomic_load_n(&s->peak, __ATOMIC_RELAXED);
+}
+
+/* snapshot the total and restart its peak */
+void
+tlsb_mem_mark(tlsb_mem_stat_t *mark)
+{
+    tlsb_mem_get(TLSB_MEM_N, mark);
+    __atomic_store_n(&mem_stat[TLSB_MEM_N].peak, mark->live, __ATOMIC_RELAXED);
+}
+
+/*
+ * What happened since the mark: bytes and count allocated, live is what
+ * is still held and peak the high water mark above the level at the mark.
+ * The peak covers all threads, overlapping fetches see each other.
+ */
+void
+tlsb_mem_since(const tlsb_mem_stat_t *mark, tlsb_mem_stat_t *d)
+{
+    tlsb_mem_stat_t now;
+    tlsb_mem_get(TLSB_MEM_N, &now);
+    d->bytes = now.bytes - mark->bytes;
+    d->count = now.count - mark->count;
+    d->live = now.live - mark->live;
+    d->peak = now.peak - mark->live;
+}
+
+void
+tlsb_mem_log_stats(void)
+{
+    tlsb_mem_stat_t st;
+    for (int i = 0; i <= TLSB_MEM_N; i++) {
+        tlsb_mem_get(i, &st);
+        if (st.count > 0)
+            log_msg("mem %-8s %6ld kB live, peak %6ld kB, %7ld kB in %ld allocations", tlsb_mem_name(i),
+                    st.live / 1024, st.peak / 1024, st.bytes / 1024, st.count);
+    }
+}
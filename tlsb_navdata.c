@@ -0,0 +1,789 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Index over X-Plane's earth_fix.dat, earth_nav.dat and earth_awy.dat.
+ *
+ * The index is a single file that is mmap'ed:
+ *   header
+ *   points      sorted by ident, region
+ *   airways     sorted by name, each a range of edges
+ *   edges       both directions, sorted by airway, from point
+ *   grid        1x1 degree cells, start index into cell_pts (NAV_CELLS + 1 entries)
+ *   cell_pts    point indices sorted by cell
+ *
+ * It is rebuilt when size or mtime of a source file changes.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include "tlsb.h"
+
+#define NAV_MAGIC "TLSBNAV1"
+#define NAV_CELLS (360 * 180)
+
+enum { NAV_NDB = 2, NAV_VOR = 3, NAV_FIX = 11 };
+
+typedef struct {
+    char ident[8];
+    char region[3];
+    uint8_t type;
+    float lat, lon;
+} nav_point_t;
+
+typedef struct {
+    char name[8];
+    uint32_t first, n;
+} nav_awy_t;
+
+typedef struct {
+    uint32_t from, to;
+} nav_edge_t;
+
+typedef struct {
+    char magic[8];
+    uint64_t src_id;            /* hash of source paths */
+    int64_t src_size[3], src_mtime[3];
+    uint32_t n_point, n_awy, n_edge;
+    uint32_t off_point, off_awy, off_edge, off_grid, off_cell;
+} nav_hdr_t;
+
+/* mapped index */
+static void *nav_base;
+static long nav_size;
+static const nav_hdr_t *hdr;
+static const nav_point_t *points;
+static const nav_awy_t *awys;
+static const nav_edge_t *edges;
+static const uint32_t *grid, *cell_pts;
+static volatile int nav_is_ready;
+
+static const char *src_name[3] = { "earth_fix.dat", "earth_nav.dat", "earth_awy.dat" };
+
+static int
+cell_of(float lat, float lon)
+{
+    int r = (int)floorf(lat) + 90;
+    int c = (int)floorf(lon) + 180;
+    if (r < 0) r = 0;
+    if (r > 179) r = 179;
+    if (c < 0) c = 0;
+    if (c > 359) c = 359;
+    return r * 360 + c;
+}
+
+/* distance in nm, flat earth is good enough to pick among same named points */
+static float
+dist_nm(float lat1, float lon1, float lat2, float lon2)
+{
+    float dlon = fabsf(lon1 - lon2);
+    if (dlon > 180.0f)
+        dlon = 360.0f - dlon;
+    dlon *= cosf((lat1 + lat2) * (float)(M_PI / 360.0));
+    float dlat = lat1 - lat2;
+    return 60.0f * sqrtf(dlat * dlat + dlon * dlon);
+}
+
+/* first point with ident or n_point */
+static uint32_t
+lower_bound(const nav_point_t *pts, uint32_t n, const char *ident)
+{
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (strncmp(pts[mid].ident, ident, 8) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static const nav_awy_t *
+find_awy(const char *name)
+{
+    uint32_t lo = 0, hi = hdr->n_awy;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        int c = strncmp(awys[mid].name, name, 8);
+        if (c == 0)
+            return &awys[mid];
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+/* ------------------------------------------------------------------ build */
+
+typedef struct {
+    char name[8];
+    nav_edge_t e;
+} build_edge_t;
+
+static int
+cmp_point(const void *a, const void *b)
+{
+    const nav_point_t *pa = a, *pb = b;
+    int c = strncmp(pa->ident, pb->ident, 8);
+    if (c)
+        return c;
+    c = strcmp(pa->region, pb->region);
+    if (c)
+        return c;
+    return pa->type - pb->type;
+}
+
+static int
+cmp_edge(const void *a, const void *b)
+{
+    const build_edge_t *ea = a, *eb = b;
+    int c = strncmp(ea->name, eb->name, 8);
+    if (c)
+        return c;
+    if (ea->e.from != eb->e.from)
+        return ea->e.from < eb->e.from ? -1 : 1;
+    return ea->e.to < eb->e.to ? -1 : (ea->e.to > eb->e.to);
+}
+
+/* point index by ident, region and type or -1 */
+static int
+build_find(const nav_point_t *pts, int n, const char *ident, const char *region, int type)
+{
+    for (uint32_t i = lower_bound(pts, n, ident);
+         i < (uint32_t)n && 0 == strncmp(pts[i].ident, ident, 8); i++)
+        if (0 == strcmp(pts[i].region, region) && pts[i].type == type)
+            return i;
+    return -1;
+}
+
+static void
+set_point(nav_point_t *p, const char *ident, const char *region, int type, double lat, double lon)
+{
+    memset(p, 0, sizeof(*p));
+    memcpy(p->ident, ident, strnlen(ident, sizeof(p->ident)));
+    memcpy(p->region, region, strnlen(region, sizeof(p->region) - 1));
+    p->type = type;
+    p->lat = lat;
+    p->lon = lon;
+}
+
+/* a cancelled build leaves no index behind */
+static int
+build_index(const char src[3][512], const nav_hdr_t *fp, const char *idx_fn,
+            const tlsb_cancel_t *cancel)
+{
+    char line[512];
+    nav_point_t *pts = NULL;
+    build_edge_t *bedges = NULL;
+    nav_awy_t *bawys = NULL;
+    uint32_t *bgrid = NULL, *bcell = NULL;
+    int n_pts = 0, cap_pts = 0, n_edges = 0, cap_edges = 0, res = 0;
+    long t0 = tlsb_now_ms();
+
+    /* fixes: lat lon ident airport region [type] */
+    FILE *f = fopen(src[0], "r");
+    if (NULL == f)
+        goto out;
+    while (fgets(line, sizeof(line), f)) {
+        if (tlsb_cancelled(cancel)) {
+            fclose(f);
+            log_msg("navdata: index build cancelled");
+            goto out;
+        }
+        double lat, lon;
+        char ident[9], apt[9], region[4];
+        if (5 != sscanf(line, "%lf %lf %8s %8s %3s", &lat, &lon, ident, apt, region))
+            continue;
+        if (!tlsb_grow(TLSB_MEM_NAV, (void **)&pts, &cap_pts, n_pts, sizeof(*pts))) {
+            fclose(f);
+            goto out;
+        }
+        set_point(&pts[n_pts++], ident, region, NAV_FIX, lat, lon);
+    }
+    fclose(f);
+
+    /* navaids: code lat lon elev freq range var ident terminal region name */
+    f = fopen(src[1], "r");
+    if (NULL == f)
+        goto out;
+    while (fgets(line, sizeof(line), f)) {
+        if (tlsb_cancelled(cancel)) {
+            fclose(f);
+            log_msg("navdata: index build cancelled");
+            goto out;
+        }
+        int code;
+        double lat, lon;
+        char ident[9], region[4];
+        if (5 != sscanf(line, "%d %lf %lf %*s %*s %*s %*s %8s %*s %3s",
+                        &code, &lat, &lon, ident, region))
+            continue;
+        /* code 12 is the DME part of a VOR/DME that we already have as 3 */
+        if (code != NAV_NDB && code != NAV_VOR && code != 13)
+            continue;
+        if (!tlsb_grow(TLSB_MEM_NAV, (void **)&pts, &cap_pts, n_pts, sizeof(*pts))) {
+            fclose(f);
+            goto out;
+        }
+        set_point(&pts[n_pts++], ident, region, code == NAV_NDB ? NAV_NDB : NAV_VOR, lat, lon);
+    }
+    fclose(f);
+
+    qsort(pts, n_pts, sizeof(*pts), cmp_point);
+
+    /* airway segments: id1 region1 type1 id2 region2 type2 dir level base top name[-name...] */
+    f = fopen(src[2], "r");
+    if (NULL == f)
+        goto out;
+    while (fgets(line, sizeof(line), f)) {
+        if (tlsb_cancelled(cancel)) {
+            fclose(f);
+            log_msg("navdata: index build cancelled");
+            goto out;
+        }
+        char id1[9], r1[4], id2[9], r2[4], names[256];
+        int t1, t2;
+        if (7 != sscanf(line, "%8s %3s %d %8s %3s %d %*s %*s %*s %*s %255s",
+                        id1, r1, &t1, id2, r2, &t2, names))
+            continue;
+        int p1 = build_find(pts, n_pts, id1, r1, t1);
+        int p2 = build_find(pts, n_pts, id2, r2, t2);
+        if (p1 < 0 || p2 < 0)
+            continue;
+
+        char *save, *name = strtok_r(names, "-", &save);
+        for (; name; name = strtok_r(NULL, "-", &save)) {
+            for (int dir = 0; dir < 2; dir++) {
+                if (!tlsb_grow(TLSB_MEM_NAV, (void **)&bedges, &cap_edges, n_edges, sizeof(*bedges))) {
+                    fclose(f);
+                    goto out;
+                }
+                build_edge_t *be = &bedges[n_edges++];
+                memset(be->name, 0, sizeof(be->name));
+                memcpy(be->name, name, strnlen(name, sizeof(be->name)));
+                be->e.from = dir ? p2 : p1;
+                be->e.to = dir ? p1 : p2;
+            }
+        }
+    }
+    fclose(f);
+
+    qsort(bedges, n_edges, sizeof(*bedges), cmp_edge);
+
+    int n_awys = 0;
+    bawys = tlsb_malloc(TLSB_MEM_NAV, (n_edges + 1) * sizeof(*bawys));
+    if (NULL == bawys)
+        goto out;
+    for (int i = 0; i < n_edges; i++) {
+        if (i == 0 || strncmp(bedges[i].name, bedges[i - 1].name, 8)) {
+            memcpy(bawys[n_awys].name, bedges[i].name, 8);
+            bawys[n_awys].first = i;
+            bawys[n_awys].n = 0;
+            n_awys++;
+        }
+        bawys[n_awys - 1].n++;
+    }
+
+    /* spatial grid, counting sort by cell */
+    bgrid = tlsb_calloc(TLSB_MEM_NAV, NAV_CELLS + 1, sizeof(*bgrid));
+    bcell = tlsb_malloc(TLSB_MEM_NAV, (n_pts + 1) * sizeof(*bcell));
+    if (NULL == bgrid || NULL == bcell)
+        goto out;
+    for (int i = 0; i < n_pts; i++)
+        bgrid[cell_of(pts[i].lat, pts[i].lon) + 1]++;
+    for (int i = 0; i < NAV_CELLS; i++)
+        bgrid[i + 1] += bgrid[i];
+    for (int i = 0; i < n_pts; i++) {
+        int c = cell_of(pts[i].lat, pts[i].lon);
+        bcell[bgrid[c]++] = i;
+    }
+    /* bgrid[c] is now the end of cell c, shift back to start indices */
+    memmove(bgrid + 1, bgrid, NAV_CELLS * sizeof(*bgrid));
+    bgrid[0] = 0;
+
+    nav_hdr_t h = *fp;
+    memcpy(h.magic, NAV_MAGIC, 8);
+    h.n_point = n_pts;
+    h.n_awy = n_awys;
+    h.n_edge = n_edges;
+    h.off_point = sizeof(h);
+    h.off_awy = h.off_point + n_pts * sizeof(nav_point_t);
+    h.off_edge = h.off_awy + n_awys * sizeof(nav_awy_t);
+    h.off_grid = h.off_edge + n_edges * sizeof(nav_edge_t);
+    h.off_cell = h.off_grid + (NAV_CELLS + 1) * sizeof(uint32_t);
+
+    char tfn[520];
+    snprintf(tfn, sizeof(tfn), "%s.tmp", idx_fn);
+    f = fopen(tfn, "wb");
+    if (NULL == f) {
+        log_msg("navdata: can't create '%s'", tfn);
+        goto out;
+    }
+
+    res = (1 == fwrite(&h, sizeof(h), 1, f))
+          && (n_pts == (int)fwrite(pts, sizeof(nav_point_t), n_pts, f))
+          && (n_awys == (int)fwrite(bawys, sizeof(nav_awy_t), n_awys, f));
+    for (int i = 0; res && i < n_edges; i++)
+        res = (1 == fwrite(&bedges[i].e, sizeof(nav_edge_t), 1, f));
+    res = res && (NAV_CELLS + 1 == fwrite(bgrid, sizeof(uint32_t), NAV_CELLS + 1, f))
+          && (n_pts == (int)fwrite(bcell, sizeof(uint32_t), n_pts, f));
+
+    if (fclose(f))
+        res = 0;
+    res = res && tlsb_rename(tfn, idx_fn);
+    if (!res)
+        unlink(tfn);
+    else
+        log_msg("navdata index built: %d points, %d airways, %d edges in %ld ms",
+                n_pts, n_awys, n_edges / 2, tlsb_now_ms() - t0);
+
+  out:
+    if (!res && !tlsb_cancelled(cancel))
+        log_msg("navdata: can't build index");
+    tlsb_free(pts);
+    tlsb_free(bedges);
+    tlsb_free(bawys);
+    tlsb_free(bgrid);
+    tlsb_free(bcell);
+    return res;
+}
+
+/* map the index, return success == 1 if it matches the fingerprint */
+static int
+map_index(const char *idx_fn, const nav_hdr_t *fp)
+{
+    long size;
+    void *base = tlsb_map_file(idx_fn, &size);
+    if (NULL == base)
+        return 0;
+
+    const nav_hdr_t *h = base;
+    if ((size_t)size < sizeof(*h) || memcmp(h->magic, NAV_MAGIC, 8)
+        || h->src_id != fp->src_id
+        || memcmp(h->src_size, fp->src_size, sizeof(fp->src_size))
+        || memcmp(h->src_mtime, fp->src_mtime, sizeof(fp->src_mtime))
+        || h->off_cell + h->n_point * sizeof(uint32_t) != (size_t)size) {
+        tlsb_unmap_file(base, size);
+        return 0;
+    }
+
+    nav_base = base;
+    nav_size = size;
+    hdr = h;
+    points = (const nav_point_t *)((char *)base + h->off_point);
+    awys = (const nav_awy_t *)((char *)base + h->off_awy);
+    edges = (const nav_edge_t *)((char *)base + h->off_edge);
+    grid = (const uint32_t *)((char *)base + h->off_grid);
+    cell_pts = (const uint32_t *)((char *)base + h->off_cell);
+    return 1;
+}
+
+/*
+ * Load or build the index. Custom Data is preferred over default data.
+ * This may take a second on a rebuild, so call it from a thread, cancel stops
+ * it within a line of the source files.
+ */
+int
+nav_init(const char *xpdir, const char *cache_dir, const tlsb_cancel_t *cancel)
+{
+    char src[3][512], idx_fn[512];
+    nav_hdr_t fp;
+
+    memset(&fp, 0, sizeof(fp));
+    fp.src_id = TLSB_FNV_INIT;
+    for (int i = 0; i < 3; i++) {
+        long size, mtime;
+        snprintf(src[i], sizeof(src[i]), "%s/Custom Data/%s", xpdir, src_name[i]);
+        if (!tlsb_file_stat(src[i], &size, &mtime)) {
+            snprintf(src[i], sizeof(src[i]), "%s/Resources/default data/%s", xpdir, src_name[i]);
+            if (!tlsb_file_stat(src[i], &size, &mtime)) {
+                log_msg("navdata: no %s", src_name[i]);
+                return 0;
+            }
+        }
+        fp.src_id = tlsb_fnv1a(fp.src_id, src[i], strlen(src[i]));
+        fp.src_size[i] = size;
+        fp.src_mtime[i] = mtime;
+    }
+
+    snprintf(idx_fn, sizeof(idx_fn), "%s/navdata.idx", cache_dir);
+    if (!map_index(idx_fn, &fp)) {
+        log_msg("navdata index is missing or stale, rebuilding");
+        if (!build_index(src, &fp, idx_fn, cancel) || !map_index(idx_fn, &fp))
+            return 0;
+    }
+
+    log_msg("navdata: %s, %u points, %u airways", src[0], hdr->n_point, hdr->n_awy);
+    nav_is_ready = 1;
+    return 1;
+}
+
+int
+nav_ready(void)
+{
+    return nav_is_ready;
+}
+
+void
+nav_cleanup(void)
+{
+    if (nav_base) {
+        nav_is_ready = 0;
+        tlsb_unmap_file(nav_base, nav_size);
+        nav_base = NULL;
+    }
+}
+
+/* ------------------------------------------------------------------ query */
+
+/* nearest point to lat/lon within the surrounding 3x3 cells, return success == 1 */
+int
+nav_nearest(float lat, float lon, nav_wpt_t *wpt)
+{
+    if (!nav_is_ready)
+        return 0;
+
+    const nav_point_t *best = NULL;
+    float best_d = 1.0E9f;
+    int r0 = (int)floorf(lat) + 90, c0 = (int)floorf(lon) + 180;
+
+    for (int r = r0 - 1; r <= r0 + 1; r++) {
+        if (r < 0 || r > 179)
+            continue;
+        for (int c = c0 - 1; c <= c0 + 1; c++) {
+            int cell = r * 360 + (c + 360) % 360;
+            for (uint32_t i = grid[cell]; i < grid[cell + 1]; i++) {
+                const nav_point_t *p = &points[cell_pts[i]];
+                float d = dist_nm(lat, lon, p->lat, p->lon);
+                if (d < best_d) {
+                    best_d = d;
+                    best = p;
+                }
+            }
+        }
+    }
+
+    if (NULL == best)
+        return 0;
+
+    memset(wpt, 0, sizeof(*wpt));
+    memcpy(wpt->ident, best->ident, 8);
+    wpt->lat = best->lat;
+    wpt->lon = best->lon;
+    return 1;
+}
+
+/* among points named ident the one nearest to lat/lon (lat > 90: any), -1 if unknown */
+static int
+lookup(const char *ident, float lat, float lon)
+{
+    int best = -1;
+    float best_d = 1.0E9f;
+
+    for (uint32_t i = lower_bound(points, hdr->n_point, ident);
+         i < hdr->n_point && 0 == strncmp(points[i].ident, ident, 8); i++) {
+        float d = lat > 90.0f ? 0.0f : dist_nm(lat, lon, points[i].lat, points[i].lon);
+        if (best < 0 || d < best_d) {
+            best = i;
+            best_d = d;
+        }
+    }
+    return best;
+}
+
+/* without a position yet pick the namesake of ident nearest to a namesake of next */
+static int
+lookup_pair(const char *ident, const char *next)
+{
+    int best = -1;
+    float best_d = 1.0E9f;
+
+    uint32_t j0 = lower_bound(points, hdr->n_point, next);
+    for (uint32_t i = lower_bound(points, hdr->n_point, ident);
+         i < hdr->n_point && 0 == strncmp(points[i].ident, ident, 8); i++) {
+        if (best < 0)
+            best = i;
+        for (uint32_t j = j0; j < hdr->n_point && 0 == strncmp(points[j].ident, next, 8); j++) {
+            float d = dist_nm(points[i].lat, points[i].lon, points[j].lat, points[j].lon);
+            if (d < best_d) {
+                best = i;
+                best_d = d;
+            }
+        }
+    }
+    return best;
+}
+
+/* parse 5020N (ARINC 424) or 50N020W / 5030N02000W (ICAO), return success == 1 */
+static int
+parse_coord(const char *tok, float *lat, float *lon)
+{
+    int len = strlen(tok);
+
+    if (len == 5 && isdigit(tok[0]) && isdigit(tok[1])) {
+        /* NNxxQ / NNQxx: Q encodes the quadrant, letter in the middle means lon >= 100 */
+        int q_pos = isalpha(tok[4]) ? 4 : 2;
+        char q = tok[q_pos];
+        if (!strchr("NESW", q) || !isdigit(tok[q_pos == 4 ? 2 : 3]))
+            return 0;
+        int a = atoi(tok), b = atoi(tok + (q_pos == 4 ? 2 : 3));
+        if (q_pos == 4)
+            a /= 100;
+        else
+            b += 100;
+        *lat = (q == 'N' || q == 'E') ? a : -a;
+        *lon = (q == 'E' || q == 'S') ? b : -b;
+        return 1;
+    }
+
+    int d1, m1 = 0, d2, m2 = 0;
+    char ns, ew;
+    if (len == 7 && 4 == sscanf(tok, "%2d%c%3d%c", &d1, &ns, &d2, &ew))
+        ;
+    else if (len == 11 && 6 == sscanf(tok, "%2d%2d%c%3d%2d%c", &d1, &m1, &ns, &d2, &m2, &ew))
+        ;
+    else
+        return 0;
+
+    if ((ns != 'N' && ns != 'S') || (ew != 'E' && ew != 'W'))
+        return 0;
+    *lat = (d1 + m1 / 60.0f) * (ns == 'N' ? 1 : -1);
+    *lon = (d2 + m2 / 60.0f) * (ew == 'E' ? 1 : -1);
+    return 1;
+}
+
+/* SID/STAR names like ANEK1B, only accepted at the ends of the route */
+static int
+is_procedure(const char *tok)
+{
+    int len = strlen(tok);
+    if (len < 4 || len > 7)
+        return 0;
+    int i = len - 1;
+    if (isalpha(tok[i]))
+        i--;
+    if (!isdigit(tok[i]))
+        return 0;
+    while (--i >= 0)
+        if (!isalpha(tok[i]))
+            return 0;
+    return 1;
+}
+
+static int
+add_wpt(nav_route_t *rte, const char *ident, const char *via, float lat, float lon)
+{
+    if (rte->n_wpt >= NAV_MAX_WPT)
+        return 0;
+    nav_wpt_t *w = &rte->wpt[rte->n_wpt++];
+    memset(w, 0, sizeof(*w));
+    memcpy(w->ident, ident, strnlen(ident, sizeof(w->ident) - 1));
+    memcpy(w->via, via, strnlen(via, sizeof(w->via) - 1));
+    w->lat = lat;
+    w->lon = lon;
+    return 1;
+}
+
+static void
+add_unknown(nav_route_t *rte, const char *tok)
+{
+    int len = strlen(rte->unknown);
+    rte->n_unknown++;
+    if (len + strlen(tok) + 2 < sizeof(rte->unknown))
+        snprintf(rte->unknown + len, sizeof(rte->unknown) - len, "%s%s", len ? " " : "", tok);
+}
+
+/* index of node in the sorted node list of an airway or -1 */
+static int
+awy_node(const nav_awy_t *a, uint32_t pt)
+{
+    uint32_t lo = a->first, hi = a->first + a->n;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (edges[mid].from < pt)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < a->first + a->n && edges[lo].from == pt) ? (int)lo : -1;
+}
+
+/*
+ * Expand airway a from point entry to a point named exit_id.
+ * Breadth first search over the edge list, appends the points after entry.
+ * Returns the exit point index or -1.
+ */
+static int
+expand_awy(const nav_awy_t *a, uint32_t entry, const char *exit_id, nav_route_t *rte)
+{
+    /* entry may be a namesake of the point on the airway */
+    int e = awy_node(a, entry);
+    for (uint32_t i = a->first; e < 0 && i < a->first + a->n; i++)
+        if (0 == strncmp(points[edges[i].from].ident, points[entry].ident, 8))
+            e = i;
+    if (e < 0)
+        return -1;
+
+    /* nodes are identified by the index of their first edge, parent[] is relative to a->first */
+    int *parent = tlsb_malloc(TLSB_MEM_NAV, a->n * sizeof(int));
+    int *queue = tlsb_malloc(TLSB_MEM_NAV, a->n * sizeof(int));
+    if (NULL == parent || NULL == queue) {
+        log_msg("navdata: out of memory expanding %.7s", a->name);
+        tlsb_free(parent);
+        tlsb_free(queue);
+        return -1;
+    }
+    for (uint32_t i = 0; i < a->n; i++)
+        parent[i] = -2;
+
+    int qh = 0, qt = 0, found = -1;
+    parent[e - a->first] = -1;
+    queue[qt++] = e;
+    while (qh < qt && found < 0) {
+        int n = queue[qh++];
+        uint32_t from = edges[n].from;
+        for (uint32_t i = n; i < a->first + a->n && edges[i].from == from; i++) {
+            int m = awy_node(a, edges[i].to);
+            if (m < 0 || parent[m - a->first] != -2)
+                continue;
+            parent[m - a->first] = n;
+            if (0 == strncmp(points[edges[i].to].ident, exit_id, 8)) {
+                found = m;
+                break;
+            }
+            queue[qt++] = m;
+        }
+    }
+
+    int res = -1;
+    if (found >= 0) {
+        /* walk back to the entry, then append in forward order */
+        int path_len = 0;
+        for (int n = found; n != e; n = parent[n - a->first])
+            queue[path_len++] = n;
+
+        char via[8];
+        memset(via, 0, sizeof(via));
+        memcpy(via, a->name, sizeof(a->name) - 1);
+        while (path_len > 0) {
+            const nav_point_t *p = &points[edges[queue[--path_len]].from];
+            char ident[9];
+            memcpy(ident, p->ident, 8);
+            ident[8] = '\0';
+            add_wpt(rte, ident, via, p->lat, p->lon);
+        }
+        res = edges[found].from;
+    }
+
+    tlsb_free(parent);
+    tlsb_free(queue);
+    return res;
+}
+
+/*
+ * Resolve and expand a simbrief route string.
+ * Airways are expanded, unresolvable tokens are collected in rte->unknown.
+ * Return number of waypoints or -1 if no navdata is available.
+ */
+int
+nav_route_check(const char *route, nav_route_t *rte)
+{
+    memset(rte, 0, sizeof(*rte));
+    if (!nav_is_ready)
+        return -1;
+
+    char buffer[1000];
+    char *tok[250];
+    int n_tok = 0;
+
+    strncpy(buffer, route, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    char *save;
+    for (char *t = strtok_r(buffer, " ", &save); t && n_tok < 250; t = strtok_r(NULL, " ", &save)) {
+        char *slash = strchr(t, '/');   /* speed / level change */
+        if (slash)
+            *slash = '\0';
+        if (*t && strcmp(t, "DCT"))
+            tok[n_tok++] = t;
+    }
+
+    int prev = -1;      /* last resolved navdata point */
+    float lat = 99.0f, lon = 0.0f;
+    for (int i = 0; i < n_tok; i++) {
+        const char *t = tok[i];
+
+        if (prev >= 0 && i + 1 < n_tok) {
+            const nav_awy_t *a = find_awy(t);
+            if (a) {
+                int exit = expand_awy(a, prev, tok[i + 1], rte);
+                if (exit < 0) {
+                    add_unknown(rte, t);
+                    continue;   /* resolve the next token as a point */
+                }
+                prev = exit;
+                lat = points[exit].lat;
+                lon = points[exit].lon;
+                i++;
+                continue;
+            }
+        }
+
+        float clat, clon;
+        if (parse_coord(t, &clat, &clon)) {
+            add_wpt(rte, t, "", clat, clon);
+            prev = -1;
+            lat = clat;
+            lon = clon;
+            continue;
+        }
+
+        int p;
+        if (lat > 90.0f && i + 1 < n_tok)
+            p = lookup_pair(t, tok[(i + 2 < n_tok && find_awy(tok[i + 1])) ? i + 2 : i + 1]);
+        else
+            p = lookup(t, lat, lon);
+        if (p >= 0) {
+            add_wpt(rte, t, "", points[p].lat, points[p].lon);
+            prev = p;
+            lat = points[p].lat;
+            lon = points[p].lon;
+            continue;
+        }
+
+        if ((i == 0 || i == n_tok - 1) && is_procedure(t))
+            continue;
+
+        add_unknown(rte, t);
+    }
+
+    return rte->n_wpt;
+}
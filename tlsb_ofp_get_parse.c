@@ -26,16 +26,13 @@ SOFTWARE.
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
-#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "tlsb.h"
 
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 
-#ifdef WIN
-#define unlink(f) _unlink(f)
-#endif
-
 void
 tlsb_dump_ofp_info(ofp_info_t *ofp_info)
 {
@@ -56,6 +53,7 @@ tlsb_dump_ofp_info(ofp_info_t *ofp_info)
         L(alt_route);
         L(max_passengers);
         L(fuel_plan_ramp);
+        L(fuel_plan_takeoff);
         L(oew);
         L(pax_count);
         L(freight);
@@ -65,6 +63,8 @@ tlsb_dump_ofp_info(ofp_info_t *ofp_info)
         L(sb_pdf_link);
         L(sb_fms_link);
         L(time_generated);
+        L(airac);
+        log_msg("navlog: %d fixes, %d wind levels", ofp_info->n_fix, ofp_info->n_wind_lvl);
     } else {
         log_msg(ofp_info->status);
     }
@@ -82,6 +82,10 @@ get_element_text(char *xml, int start_ofs, int end_ofs, const char *tag, int *te
     if (NULL == s)
         return 0;
 
+    /* not within the range */
+    if (s - xml >= end_ofs)
+        return 0;
+
     s += strlen(stag);
 
     /* don't run over end_ofs */
@@ -109,58 +113,107 @@ do { \
     } \
 } while (0)
 
-int
-tlsb_ofp_get_parse(const char *pilot_id, ofp_info_t *ofp_info)
+/* copy text of tag within [start, end) to buffer */
+static int
+fix_text(char *xml, int start, int end, const char *tag, char *buffer, int buflen)
 {
-    char *ofp = NULL;
-    FILE *f = NULL;
-
-    memset(ofp_info, 0, sizeof(*ofp_info));
-    int ofp_len;
-
-    char url[100];
-    sprintf(url, "https://www.simbrief.com/api/xml.fetcher.php?userid=%s", pilot_id);
-    // log_msg(url);
-
-    f = fopen(tlsb_tmp_fn, "wb+");
-    // is unrealiable on windows FILE *f = tmpfile();
-
-    if (NULL == f) {
-        log_msg("Can't create temporary file");
+    int s, e;
+    buffer[0] = '\0';
+    if (!get_element_text(xml, start, end, tag, &s, &e))
         return 0;
-    }
+    int len = MIN(buflen - 1, e - s);
+    memcpy(buffer, xml + s, len);
+    buffer[len] = '\0';
+    return 1;
+}
 
-    int res = tlsb_http_get(url, f, &ofp_len, 10);
+/* levels of a fix's wind_data, the level set is taken from the first fix */
+static void
+parse_wind(char *xml, int start, int end, ofp_info_t *ofp_info, int i_fix)
+{
+    int ls, le;
+    char tmp[20];
+
+    while (get_element_text(xml, start, end, "level", &ls, &le)) {
+        start = le;
+        fix_text(xml, ls, le, "altitude", tmp, sizeof(tmp));
+        int fl = atoi(tmp) / 100;
+
+        int l;
+        for (l = 0; l < ofp_info->n_wind_lvl; l++)
+            if (ofp_info->wind_fl[l] == fl)
+                break;
+
+        if (l == ofp_info->n_wind_lvl) {
+            /* new levels only from the first fix and in ascending order */
+            if (i_fix > 0 || l == OFP_MAX_WIND_LVL || (l > 0 && fl <= ofp_info->wind_fl[l - 1]))
+                continue;
+            ofp_info->wind_fl[ofp_info->n_wind_lvl++] = fl;
+        }
 
-    if (0 == res) {
-        strcpy(ofp_info->status, "Network error");
-        goto out;
+        ofp_wind_t *w = &ofp_info->wind[i_fix][l];
+        fix_text(xml, ls, le, "wind_dir", tmp, sizeof(tmp));
+        w->dir = atoi(tmp);
+        fix_text(xml, ls, le, "wind_spd", tmp, sizeof(tmp));
+        w->spd = atoi(tmp);
+        fix_text(xml, ls, le, "oat", tmp, sizeof(tmp));
+        w->oat = atoi(tmp);
     }
+}
 
-    log_msg("got ofp %d bytes", ofp_len);
-    rewind(f);
+static void
+parse_navlog(char *xml, int start, int end, ofp_info_t *ofp_info)
+{
+    int fs, fe;
+    char tmp[20];
+
+    while (get_element_text(xml, start, end, "fix", &fs, &fe)) {
+        if (ofp_info->n_fix == OFP_MAX_FIX) {
+            log_msg("navlog: more than %d fixes, the rest is dropped", OFP_MAX_FIX);
+            ofp_info->navlog_truncated = 1;
+            break;
+        }
 
-    if (NULL == (ofp = malloc(ofp_len+1))) {    /* + space for a terminating 0 */
-        log_msg("can't malloc OFP xml buffer");
-        res = 0;
-        goto out;
+        ofp_fix_t *fix = &ofp_info->navlog[ofp_info->n_fix++];
+        fix_text(xml, fs, fe, "ident", fix->ident, sizeof(fix->ident));
+        fix_text(xml, fs, fe, "type", fix->type, sizeof(fix->type));
+        fix_text(xml, fs, fe, "via_airway", fix->via, sizeof(fix->via));
+        fix_text(xml, fs, fe, "is_sid_star", tmp, sizeof(tmp));
+        fix->is_sid_star = atoi(tmp);
+        fix_text(xml, fs, fe, "altitude_feet", tmp, sizeof(tmp));
+        fix->altitude = atoi(tmp);
+        fix_text(xml, fs, fe, "pos_lat", tmp, sizeof(tmp));
+        fix->lat = atof(tmp);
+        fix_text(xml, fs, fe, "pos_long", tmp, sizeof(tmp));
+        fix->lon = atof(tmp);
+        fix_text(xml, fs, fe, "stage", fix->stage, sizeof(fix->stage));
+        fix_text(xml, fs, fe, "time_total", tmp, sizeof(tmp));
+        fix->time_total = atoi(tmp);
+        fix_text(xml, fs, fe, "fuel_plan_onboard", tmp, sizeof(tmp));
+        fix->fuel_onboard = atof(tmp);
+
+        int ws, we;
+        if (get_element_text(xml, fs, fe, "wind_data", &ws, &we))
+            parse_wind(xml, ws, we, ofp_info, ofp_info->n_fix - 1);
+        start = fe;
     }
+}
 
-    ofp_len = fread(ofp, 1, ofp_len, f);
-    res = 1;
-    ofp[ofp_len] = '\0';
-
+/* parse ofp[0, ofp_len), ofp[ofp_len] must be 0. Works on a prefix of the xml as well */
+static void
+parse_ofp(char *ofp, int ofp_len, ofp_info_t *ofp_info)
+{
     int out_s, out_e;
     if (POSITION("fetch")) {
         EXTRACT("status", status);
-        if (strcmp(ofp_info->status, "Success")) {
-            goto out;
-        }
+        if (strcmp(ofp_info->status, "Success"))
+            return;
     }
 
     if (POSITION("params")) {
         EXTRACT("time_generated", time_generated);
         EXTRACT("units", units);
+        EXTRACT("airac", airac);
     }
 
     if (POSITION("aircraft")) {
@@ -170,18 +223,28 @@ tlsb_ofp_get_parse(const char *pilot_id, ofp_info_t *ofp_info)
 
     if (POSITION("fuel")) {
         EXTRACT("plan_ramp", fuel_plan_ramp);
+        EXTRACT("plan_takeoff", fuel_plan_takeoff);
     }
 
     if (POSITION("origin")) {
         EXTRACT("icao_code", origin);
         EXTRACT("plan_rwy", origin_rwy);
+        EXTRACT("elevation", origin_elevation);
+        EXTRACT("pos_lat", origin_lat);
+        EXTRACT("pos_long", origin_lon);
     }
 
     if (POSITION("destination")) {
         EXTRACT("icao_code", destination);
         EXTRACT("plan_rwy", destination_rwy);
+        EXTRACT("elevation", destination_elevation);
+        EXTRACT("pos_lat", destination_lat);
+        EXTRACT("pos_long", destination_lon);
      }
 
+    if (POSITION("navlog"))
+        parse_navlog(ofp, out_s, out_e, ofp_info);
+
     if (POSITION("general")) {
         EXTRACT("icao_airline", icao_airline);
         EXTRACT("flight_number", flight_number);
@@ -222,10 +285,310 @@ tlsb_ofp_get_parse(const char *pilot_id, ofp_info_t *ofp_info)
     if (POSITION("xpe")) {
         EXTRACT("link", sb_fms_link);
     }
+}
+
+/* the briefing goes to the search index, once per OFP */
+static void
+add_briefing(char *ofp, int ofp_len, const ofp_info_t *ofp_info)
+{
+    int s, e;
+    if (0 == strcmp(ofp_info->status, "Success") && ofp_info->time_generated[0]
+        && get_element_text(ofp, 0, ofp_len, "plan_html", &s, &e))
+        tlsb_search_add(ofp_info->time_generated, ofp + s, e - s);
+}
+
+/*
+ * Reentrant and without globals, several threads may parse at the same time.
+ * xml[len] must be 0, xml is modified while parsing but restored.
+ */
+void
+tlsb_ofp_parse(char *xml, int len, ofp_info_t *ofp_info)
+{
+    memset(ofp_info, 0, sizeof(*ofp_info));
+    parse_ofp(xml, len, ofp_info);
+}
+
+/*
+ * Read and parse an OFP xml file, return its size or -1.
+ * With briefing set the briefing is added to the search index.
+ */
+long
+tlsb_ofp_parse_file(const char *fn, ofp_info_t *ofp_info, int briefing)
+{
+    memset(ofp_info, 0, sizeof(*ofp_info));
+
+    FILE *f = fopen(fn, "rb");
+    if (NULL == f)
+        return -1;
+
+    long len = -1;
+    char *xml = NULL;
+    if (0 == fseek(f, 0, SEEK_END) && (len = ftell(f)) >= 0 && 0 == fseek(f, 0, SEEK_SET)
+        && NULL != (xml = tlsb_malloc(TLSB_MEM_OFP, len + 1)) && len == (long)fread(xml, 1, len, f)) {
+        xml[len] = '\0';
+        parse_ofp(xml, len, ofp_info);
+        if (briefing)
+            add_briefing(xml, len, ofp_info);
+    } else {
+        len = -1;
+    }
+
+    tlsb_free(xml);
+    fclose(f);
+    return len;
+}
+
+/* receive the response into a growing buffer */
+typedef struct _membuf
+{
+    char *data;
+    size_t len, size;
+    tlsb_ofp_early_cb_t early_cb;   /* cleared when called */
+    void *early_ctx;
+} membuf_t;
+
+#define EARLY_TAG "</weights>"
+
+/* everything needed for loading the aircraft is in, parse what we have */
+static void
+early_parse(membuf_t *mb)
+{
+    tlsb_ofp_early_cb_t early_cb = mb->early_cb;
+    mb->early_cb = NULL;
+
+    ofp_info_t *oi = tlsb_calloc(TLSB_MEM_OFP, 1, sizeof(ofp_info_t));
+    if (NULL == oi)
+        return;
+
+    parse_ofp(mb->data, mb->len, oi);
+    log_msg("fuel and weights in after %d bytes", (int)mb->len);
+    if (0 == strcmp(oi->status, "Success"))
+        early_cb(oi, mb->early_ctx);
+    tlsb_free(oi);
+}
+
+static size_t
+membuf_write_cb(const void *ptr, size_t len, tlsb_http_req_t *req)
+{
+    membuf_t *mb = req->write_ctx;
+
+    if (mb->len + len + 1 > mb->size) {     /* + space for a terminating 0 */
+        size_t size = mb->size ? 2 * mb->size : 256 * 1024;
+        while (mb->len + len + 1 > size)
+            size *= 2;
+
+        char *data = tlsb_realloc(TLSB_MEM_OFP, mb->data, size);
+        if (NULL == data) {
+            log_msg("can't malloc OFP xml buffer");
+            return 0;
+        }
+        mb->data = data;
+        mb->size = size;
+    }
+
+    /* the tag may straddle two chunks */
+    size_t from = mb->len > sizeof(EARLY_TAG) ? mb->len - sizeof(EARLY_TAG) : 0;
+
+    memcpy(mb->data + mb->len, ptr, len);
+    mb->len += len;
+
+    if (mb->early_cb) {
+        mb->data[mb->len] = '\0';
+        if (strstr(mb->data + from, EARLY_TAG))
+            early_parse(mb);
+    }
+    return len;
+}
+
+/* allocations of the last fetch */
+static pthread_mutex_t mem_mutex = PTHREAD_MUTEX_INITIALIZER;
+static tlsb_mem_stat_t mem_fetch;
+
+static int
+fetch_parse(const char *pilot_id, ofp_info_t *ofp_info, const tlsb_cancel_t *cancel,
+            tlsb_ofp_early_cb_t early_cb, void *early_ctx)
+{
+    char *ofp = NULL;
+    membuf_t mb;
+    tlsb_mem_stat_t mark, d;
+
+    tlsb_mem_mark(&mark);
+
+    memset(ofp_info, 0, sizeof(*ofp_info));
+    memset(&mb, 0, sizeof(mb));
+    int ofp_len;
+
+    char url[100];
+    sprintf(url, "https://www.simbrief.com/api/xml.fetcher.php?userid=%s", pilot_id);
+    // log_msg(url);
+
+    tlsb_http_req_t req;
+    memset(&req, 0, sizeof(req));
+    req.url = url;
+    req.timeout = 10;
+    req.retries = 2;
+    req.hedge = (NULL == early_cb);     /* a hedged body is buffered */
+    req.compress = 1;                   /* xml compresses to about 1/8 */
+    req.cancel = cancel;
+    req.write_cb = membuf_write_cb;
+    req.write_ctx = &mb;
+    mb.early_cb = early_cb;
+    mb.early_ctx = early_ctx;
+
+    int res = tlsb_http_request(&req);
+
+    if (0 == res || NULL == mb.data) {
+        strcpy(ofp_info->status, tlsb_cancelled(cancel) ? "Cancelled" : "Network error");
+        res = 0;
+        goto out;
+    }
+
+    ofp = mb.data;
+    ofp_len = mb.len;
+    log_msg("got ofp %d bytes", ofp_len);
+    ofp[ofp_len] = '\0';
+    parse_ofp(ofp, ofp_len, ofp_info);
+
+    add_briefing(ofp, ofp_len, ofp_info);
 
 out:
-    if (ofp) free(ofp);
-    if (f) fclose(f);
-    unlink(tlsb_tmp_fn);   /* unchecked */
+    if (mb.data) tlsb_free(mb.data);
+
+    tlsb_mem_since(&mark, &d);
+    log_msg("fetch memory: %ld kB in %ld allocations, peak %ld kB, %ld kB retained",
+            d.bytes / 1024, d.count, d.peak / 1024, d.live / 1024);
+    pthread_mutex_lock(&mem_mutex);
+    mem_fetch = d;
+    pthread_mutex_unlock(&mem_mutex);
     return res;
 }
+
+void
+tlsb_ofp_mem_stat(tlsb_mem_stat_t *st)
+{
+    pthread_mutex_lock(&mem_mutex);
+    *st = mem_fetch;
+    pthread_mutex_unlock(&mem_mutex);
+}
+
+/*
+ * Single flight: commands, the button, prefetch and fetch_xfer may ask at the
+ * same time. Only one request per pilot_id goes out, the others wait for it and
+ * get the same result. A successful result is served from memory for OFP_FRESH
+ * seconds. If only the request in flight was cancelled the waiters ask again.
+ */
+#define OFP_FRESH 10
+
+static pthread_mutex_t sf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sf_cond = PTHREAD_COND_INITIALIZER;
+static char sf_pilot_id[20];
+static int sf_in_flight;
+static unsigned sf_gen;                 /* bumped when a request completes */
+static int sf_res, sf_fresh;
+static int sf_cancelled;                /* the last request was cancelled by its caller */
+static time_t sf_time;
+static ofp_info_t sf_info;
+
+/* called with sf_mutex held, polls the cancel token of the caller */
+static void
+sf_wait(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += 100 * 1000000L;
+    ts.tv_sec += ts.tv_nsec / 1000000000L;
+    ts.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(&sf_cond, &sf_mutex, &ts);
+}
+
+/*
+ * Reentrant, so it can run in a background thread.
+ * If early_cb is set the response is streamed and early_cb is called from within
+ * the transfer as soon as fuel and weights are in. It gets a partially
+ * filled ofp_info with status "Success".
+ * A caller that joins a request in flight or is served from memory gets no
+ * early_cb.
+ */
+int
+tlsb_ofp_get_parse_early(const char *pilot_id, ofp_info_t *ofp_info, const tlsb_cancel_t *cancel,
+                         tlsb_ofp_early_cb_t early_cb, void *early_ctx)
+{
+    int res;
+
+  again:
+    pthread_mutex_lock(&sf_mutex);
+    int same = (0 == strcmp(sf_pilot_id, pilot_id));
+
+    if (same && sf_in_flight) {
+        unsigned gen = sf_gen;
+        log_msg("joining OFP request in flight");
+        while (sf_gen == gen && !tlsb_cancelled(cancel))
+            sf_wait();
+
+        if (sf_gen == gen) {
+            pthread_mutex_unlock(&sf_mutex);
+            memset(ofp_info, 0, sizeof(*ofp_info));
+            strcpy(ofp_info->status, "Cancelled");
+            return 0;
+        }
+
+        /* its caller gave up, that's no answer for us */
+        if (sf_cancelled && !tlsb_cancelled(cancel)) {
+            pthread_mutex_unlock(&sf_mutex);
+            log_msg("OFP request in flight was cancelled, asking again");
+            goto again;
+        }
+        goto copy;
+    }
+
+    if (same && sf_fresh && time(NULL) - sf_time <= OFP_FRESH) {
+        log_msg("OFP served from memory, %d s old", (int)(time(NULL) - sf_time));
+        goto copy;
+    }
+
+    if (sf_in_flight) {
+        /* a different pilot_id, don't coalesce */
+        pthread_mutex_unlock(&sf_mutex);
+        return fetch_parse(pilot_id, ofp_info, cancel, early_cb, early_ctx);
+    }
+
+    strncpy(sf_pilot_id, pilot_id, sizeof(sf_pilot_id) - 1);
+    sf_in_flight = 1;
+    sf_fresh = 0;
+    pthread_mutex_unlock(&sf_mutex);
+
+    res = fetch_parse(pilot_id, ofp_info, cancel, early_cb, early_ctx);
+
+    pthread_mutex_lock(&sf_mutex);
+    memcpy(&sf_info, ofp_info, sizeof(sf_info));
+    sf_res = res;
+    sf_cancelled = (0 == res && tlsb_cancelled(cancel));
+    sf_fresh = (res && 0 == strcmp(ofp_info->status, "Success"));
+    sf_time = time(NULL);
+    sf_in_flight = 0;
+    sf_gen++;
+    pthread_cond_broadcast(&sf_cond);
+    pthread_mutex_unlock(&sf_mutex);
+    return res;
+
+copy:
+    memcpy(ofp_info, &sf_info, sizeof(*ofp_info));
+    res = sf_res;
+    pthread_mutex_unlock(&sf_mutex);
+    return res;
+}
+
+/* the next request goes to the network */
+void
+tlsb_ofp_forget(void)
+{
+    pthread_mutex_lock(&sf_mutex);
+    sf_fresh = 0;
+    pthread_mutex_unlock(&sf_mutex);
+}
+
+int
+tlsb_ofp_get_parse(const char *pilot_id, ofp_info_t *ofp_info, const tlsb_cancel_t *cancel)
+{
+    return tlsb_ofp_get_parse_early(pilot_id, ofp_info, cancel, NULL, NULL);
+}
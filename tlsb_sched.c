@@ -0,0 +1,179 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Cooperative task queue for work that must run on the main thread.
+ *
+ * tlsb_task_run() is called from the flight loop with a time budget. Ready
+ * tasks run in priority order, tasks of the same priority round robin.
+ * A task is a step function that does a small slice of work and tells
+ * whether and when it wants to run again. Long jobs check
+ * tlsb_task_time_left() to size their slices.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tlsb.h"
+
+#define MAX_TASK 32
+
+typedef struct {
+    const char *name;
+    int prio;
+    tlsb_task_fn_t fn;
+    void *ctx;
+    long due_us;
+    unsigned long last_run;     /* frame # */
+} task_t;
+
+static task_t tasks[MAX_TASK];
+static int n_task;
+static unsigned long frame;
+static long deadline_us;
+
+static long
+now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static int
+find_task(tlsb_task_fn_t fn, void *ctx)
+{
+    for (int i = 0; i < n_task; i++)
+        if (tasks[i].fn == fn && tasks[i].ctx == ctx)
+            return i;
+    return -1;
+}
+
+/*
+ * Queue fn(ctx) to run after delay_ms. A task with the same fn and ctx
+ * is rescheduled instead. Return success == 1
+ */
+int
+tlsb_task_add(const char *name, int prio, tlsb_task_fn_t fn, void *ctx, int delay_ms)
+{
+    int i = find_task(fn, ctx);
+    if (i < 0) {
+        if (n_task >= MAX_TASK) {
+            log_msg("task queue full, '%s' dropped", name);
+            return 0;
+        }
+        i = n_task++;
+        tasks[i].last_run = 0;
+    }
+
+    tasks[i].name = name;
+    tasks[i].prio = prio;
+    tasks[i].fn = fn;
+    tasks[i].ctx = ctx;
+    tasks[i].due_us = now_us() + delay_ms * 1000L;
+    return 1;
+}
+
+void
+tlsb_task_remove(tlsb_task_fn_t fn, void *ctx)
+{
+    int i = find_task(fn, ctx);
+    if (i >= 0)
+        tasks[i] = tasks[--n_task];
+}
+
+/* remaining budget of the current tlsb_task_run() in us */
+long
+tlsb_task_time_left(void)
+{
+    long left = deadline_us - now_us();
+    return left > 0 ? left : 0;
+}
+
+/*
+ * Run ready tasks for about budget_us, at least one step is always done.
+ * Return ms until the next task is due, 0 = ready now, -1 = queue is empty
+ */
+int
+tlsb_task_run(long budget_us)
+{
+    long start = now_us();
+    deadline_us = start + budget_us;
+    frame++;
+
+    for (int n_run = 0; ; n_run++) {
+        if (n_run > 0 && now_us() >= deadline_us)
+            break;
+
+        /* ready task with the highest priority that waited longest */
+        long now = now_us();
+        int best = -1;
+        for (int i = 0; i < n_task; i++) {
+            task_t *t = &tasks[i];
+            if (t->due_us > now || t->last_run == frame)
+                continue;
+            if (best < 0 || t->prio < tasks[best].prio
+                || (t->prio == tasks[best].prio && t->last_run < tasks[best].last_run))
+                best = i;
+        }
+
+        if (best < 0)
+            break;
+
+        task_t *t = &tasks[best];
+        t->last_run = frame;
+        tlsb_task_fn_t fn = t->fn;
+        void *ctx = t->ctx;
+        const char *name = t->name;
+
+        long t0 = now_us();
+        int res = fn(ctx);
+        long dt = now_us() - t0;
+        if (dt > 5 * budget_us)
+            log_msg("task '%s' took %ld us", name, dt);
+
+        /* the task may have added or removed tasks */
+        int i = find_task(fn, ctx);
+        if (i < 0)
+            continue;
+        if (res == TLSB_TASK_DONE)
+            tasks[i] = tasks[--n_task];
+        else if (res > 0)
+            tasks[i].due_us = now_us() + res * 1000L;
+    }
+
+    if (0 == n_task)
+        return -1;
+
+    long now = now_us(), next = -1;
+    for (int i = 0; i < n_task; i++) {
+        long d = tasks[i].due_us - now;
+        if (d < 0 || tasks[i].last_run == frame)
+            d = 0;
+        if (next < 0 || d < next)
+            next = d;
+    }
+    return (next + 999) / 1000;
+}
@@ -0,0 +1,220 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Virtualized scrolling list in a custom widget with a scroll bar.
+ *
+ * Only the rows in view are formatted and drawn. Formatted rows are cached
+ * in a ring indexed by row # so a frame without scrolling formats nothing and
+ * a scrolling frame formats just the rows that came into view.
+ * The cost of a frame depends on the height of the view, not the # of rows.
+ * The wheel or the scroll bar set a target row, the view glides there.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "XPLMGraphics.h"
+#include "XPWidgets.h"
+#include "XPStandardWidgets.h"
+
+#include "tlsb.h"
+#include "tlsb_scroll.h"
+
+#define ROW_H 15
+#define SB_W 14
+#define WHEEL_ROWS 3
+#define CACHE_ROWS 64       /* must be > n_vis + 1 */
+#define ROW_LEN 100
+
+struct _tlsb_scroll
+{
+    XPWidgetID widget, scroll_bar;
+    int n_vis, n_rows;
+    tlsb_row_fmt_t fmt;
+    void *ctx;
+    int target;             /* first row */
+    float pos;              /* first row shown, glides to target */
+    int cache_row[CACHE_ROWS];  /* row # in slot, -1 = empty */
+    char cache_hdr[CACHE_ROWS];
+    char cache[CACHE_ROWS][ROW_LEN];
+};
+
+static int
+max_first(const tlsb_scroll_t *sv)
+{
+    return sv->n_rows > sv->n_vis ? sv->n_rows - sv->n_vis : 0;
+}
+
+/* the slider has its max on top */
+static void
+set_target(tlsb_scroll_t *sv, int target)
+{
+    int mf = max_first(sv);
+    sv->target = target < 0 ? 0 : (target > mf ? mf : target);
+    XPSetWidgetProperty(sv->scroll_bar, xpProperty_ScrollBarMax, mf);
+    XPSetWidgetProperty(sv->scroll_bar, xpProperty_ScrollBarSliderPosition, mf - sv->target);
+}
+
+static const char *
+row_text(tlsb_scroll_t *sv, int row, int *hdr)
+{
+    int slot = row % CACHE_ROWS;
+    if (sv->cache_row[slot] != row) {
+        sv->cache_hdr[slot] = sv->fmt(row, sv->cache[slot], ROW_LEN, sv->ctx);
+        sv->cache_row[slot] = row;
+    }
+    *hdr = sv->cache_hdr[slot];
+    return sv->cache[slot];
+}
+
+static void
+draw(tlsb_scroll_t *sv)
+{
+    static float text_color[] = { 0.0, 0.3, 0.3 };
+    static float hdr_color[] = { 0.0, 0.0, 0.0 };
+    int left, top, right, bottom;
+
+    XPGetWidgetGeometry(sv->widget, &left, &top, &right, &bottom);
+
+    if (sv->pos != sv->target) {
+        sv->pos += (sv->target - sv->pos) * 0.35f;
+        if (fabsf(sv->target - sv->pos) < 0.05f)
+            sv->pos = sv->target;
+    }
+
+    /* rows that don't fit completely are skipped, XPLMDrawString doesn't clip */
+    int first = (int)sv->pos;
+    int y = top - ROW_H + (int)((sv->pos - first) * ROW_H);
+    for (int r = first; r < sv->n_rows && y >= bottom; r++, y -= ROW_H) {
+        if (y + ROW_H > top)
+            continue;
+        int hdr;
+        const char *s = row_text(sv, r, &hdr);
+        XPLMDrawString(hdr ? hdr_color : text_color, left + 3, y + 3, (char *)s, NULL,
+                       hdr ? xplmFont_Proportional : xplmFont_Basic);
+    }
+}
+
+static int
+scroll_cb(XPWidgetMessage msg, XPWidgetID widget_id, intptr_t param1, intptr_t param2)
+{
+    (void)param2;
+    tlsb_scroll_t *sv = (tlsb_scroll_t *)XPGetWidgetProperty(widget_id, xpProperty_Refcon, NULL);
+    if (NULL == sv)
+        return 0;
+
+    if (widget_id == sv->widget && msg == xpMsg_Draw) {
+        draw(sv);
+        return 1;
+    }
+
+    if (widget_id == sv->widget && msg == xpMsg_MouseWheel) {
+        set_target(sv, sv->target - WHEEL_ROWS * ((XPMouseState_t *)param1)->delta);
+        return 1;
+    }
+
+    if (widget_id == sv->scroll_bar && msg == xpMsg_ScrollBarSliderPositionChanged) {
+        int pos = XPGetWidgetProperty(sv->scroll_bar, xpProperty_ScrollBarSliderPosition, NULL);
+        sv->target = max_first(sv) - pos;
+        return 1;
+    }
+
+    return 0;
+}
+
+/* the view is positioned by tlsb_scroll_place(), n_vis rows high */
+tlsb_scroll_t *
+tlsb_scroll_create(XPWidgetID parent, int n_vis)
+{
+    tlsb_scroll_t *sv = tlsb_calloc(TLSB_MEM_UI, 1, sizeof(*sv));
+    if (NULL == sv)
+        return NULL;
+
+    sv->n_vis = n_vis < CACHE_ROWS - 1 ? n_vis : CACHE_ROWS - 2;
+    memset(sv->cache_row, 0xff, sizeof(sv->cache_row));
+
+    /* siblings, so the parent's geometry changes apply to both */
+    sv->widget = XPCreateCustomWidget(0, 0, 0, 0, 0, "", 0, parent, scroll_cb);
+    XPSetWidgetProperty(sv->widget, xpProperty_Refcon, (intptr_t)sv);
+
+    sv->scroll_bar = XPCreateWidget(0, 0, 0, 0, 0, "", 0, parent, xpWidgetClass_ScrollBar);
+    XPSetWidgetProperty(sv->scroll_bar, xpProperty_ScrollBarType, xpScrollBarTypeScrollBar);
+    XPSetWidgetProperty(sv->scroll_bar, xpProperty_ScrollBarMin, 0);
+    XPSetWidgetProperty(sv->scroll_bar, xpProperty_ScrollBarPageAmount, sv->n_vis);
+    XPSetWidgetProperty(sv->scroll_bar, xpProperty_Refcon, (intptr_t)sv);
+    XPAddWidgetCallback(sv->scroll_bar, scroll_cb);
+    set_target(sv, 0);
+    return sv;
+}
+
+void
+tlsb_scroll_destroy(tlsb_scroll_t *sv)
+{
+    if (NULL == sv)
+        return;
+    XPDestroyWidget(sv->scroll_bar, 1);
+    XPDestroyWidget(sv->widget, 1);
+    tlsb_free(sv);
+}
+
+/* new content, rows are formatted on demand */
+void
+tlsb_scroll_set_rows(tlsb_scroll_t *sv, int n_rows, tlsb_row_fmt_t fmt, void *ctx)
+{
+    sv->n_rows = n_rows;
+    sv->fmt = fmt;
+    sv->ctx = ctx;
+    memset(sv->cache_row, 0xff, sizeof(sv->cache_row));
+    sv->pos = 0.0f;
+    set_target(sv, 0);
+}
+
+/* place the view below top, call from the parent's draw. Return the height used */
+int
+tlsb_scroll_place(tlsb_scroll_t *sv, int left, int top, int right)
+{
+    if (0 == sv->n_rows) {
+        if (XPIsWidgetVisible(sv->widget)) {
+            XPHideWidget(sv->widget);
+            XPHideWidget(sv->scroll_bar);
+        }
+        return 0;
+    }
+
+    int h = sv->n_vis * ROW_H;
+    int l, t, r, b;
+    XPGetWidgetGeometry(sv->widget, &l, &t, &r, &b);
+    if (l != left || t != top || r != right - SB_W) {
+        XPSetWidgetGeometry(sv->widget, left, top, right - SB_W, top - h);
+        XPSetWidgetGeometry(sv->scroll_bar, right - SB_W, top, right, top - h);
+    }
+
+    if (!XPIsWidgetVisible(sv->widget)) {
+        XPShowWidget(sv->widget);
+        XPShowWidget(sv->scroll_bar);
+    }
+    return h;
+}
@@ -0,0 +1,40 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _TLSB_SCROLL_H_
+#define _TLSB_SCROLL_H_
+
+/* virtualized scrolling list of text rows, plugin only */
+#include "XPWidgets.h"
+
+/* format row # row into buf, return 1 for a heading */
+typedef int (*tlsb_row_fmt_t)(int row, char *buf, int buflen, void *ctx);
+
+typedef struct _tlsb_scroll tlsb_scroll_t;
+
+extern tlsb_scroll_t *tlsb_scroll_create(XPWidgetID parent, int n_vis);
+extern void tlsb_scroll_destroy(tlsb_scroll_t *sv);
+extern void tlsb_scroll_set_rows(tlsb_scroll_t *sv, int n_rows, tlsb_row_fmt_t fmt, void *ctx);
+extern int tlsb_scroll_place(tlsb_scroll_t *sv, int left, int top, int right);
+#endif
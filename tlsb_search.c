@@ -0,0 +1,621 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Full text search over the briefing (plan_html) of an OFP.
+ *
+ * The html is reduced to plain text and indexed once per OFP when it's fetched:
+ *   vocabulary  distinct token prefixes of up to KEY_LEN chars, sorted
+ *   postings    offsets of the tokens, grouped by vocabulary entry
+ *   blocks      paragraphs of up to BLOCK_LINES lines (a NOTAM, a TAF, ...)
+ *
+ * A query matches the blocks that contain all of its words as token prefixes,
+ * so the hits follow the search box keystroke by keystroke.
+ * The indexes of the last N_SLOT OFPs are kept, keyed by time_generated.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#include "tlsb.h"
+
+#define KEY_LEN 8
+#define BLOCK_LINES 8
+#define N_SLOT 3
+#define MAX_TERM 8
+#define MAX_ALT 4
+
+typedef struct {
+    uint64_t key;           /* first KEY_LEN chars, upper case, 0 padded */
+    uint32_t first;         /* into post */
+} vocab_t;
+
+struct _tlsb_search
+{
+    char key[16];
+    int refcnt;             /* protected by slot_mutex */
+    char *text;
+    int text_len;
+    int n_vocab, n_post, n_block;
+    vocab_t *vocab;         /* n_vocab + 1 entries */
+    uint32_t *post;
+    uint32_t *block;        /* start offsets, n_block + 1 entries */
+};
+
+static pthread_mutex_t slot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static tlsb_search_t *slot[N_SLOT];     /* most recent first */
+
+/* plain words to what the OFP says */
+static const char *abbrev[][2] = {
+    { "RUNWAY", "RWY" }, { "RUNWAYS", "RWY" }, { "TAXIWAY", "TWY" }, { "TAXIWAYS", "TWY" },
+    { "CLOSED", "CLSD" }, { "CLOSURE", "CLSD" }, { "CLOSURES", "CLSD" },
+    { "APPROACH", "APCH" }, { "ALTERNATE", "ALTN" },
+    { "DESTINATION", "DEST" }, { "WEATHER", "WX" }, { "FORECAST", "TAF" },
+    { NULL, NULL }
+};
+
+static const char *stop_word[] = { "A", "AN", "AT", "AND", "FOR", "IN", "OF", "ON", "THE", "TO", NULL };
+
+/* decode an entity, *s points behind the '&'. Return the char or 0 if unknown */
+static int
+entity(const char **s, const char *e)
+{
+    static const struct { const char *name; char c; } ent[] = {
+        { "lt;", '<' }, { "gt;", '>' }, { "amp;", '&' }, { "quot;", '"' },
+        { "apos;", '\'' }, { "nbsp;", ' ' }
+    };
+
+    for (unsigned i = 0; i < sizeof(ent) / sizeof(ent[0]); i++) {
+        int len = strlen(ent[i].name);
+        if (e - *s >= len && 0 == strncmp(*s, ent[i].name, len)) {
+            *s += len;
+            return ent[i].c;
+        }
+    }
+
+    if (*s < e && **s == '#') {
+        char *end;
+        long c = strtol(*s + 1, &end, 10);
+        if (end < e && *end == ';' && c > 0) {
+            *s = end + 1;
+            return c < 128 ? c : ' ';
+        }
+    }
+    return 0;
+}
+
+/* tags that end a line, opening or closing */
+static int
+is_break_tag(const char *tag)
+{
+    static const char *brk[] = { "br", "p", "div", "tr", "pre", "h1", "h2", "h3", "h4", "li", NULL };
+
+    for (int i = 0; brk[i]; i++)
+        if (0 == strcmp(tag, brk[i]))
+            return 1;
+    return 0;
+}
+
+/*
+ * plan_html is html escaped within the xml, so unescape that first, then
+ * drop the tags and decode the html entities. Return the length of the text.
+ */
+static int
+html_to_text(const char *html, int len, char *text)
+{
+    const char *s = html, *e = html + len;
+    char *o = text;
+
+    while (s < e) {
+        int c = *s++;
+        if (c == '&') {
+            int d = entity(&s, e);
+            c = d ? d : '&';
+        }
+        *o++ = c;
+    }
+
+    /* second pass in place, the output never gets longer */
+    s = text;
+    e = o;
+    o = text;
+    int tag_nl = 0;     /* "<br>\n" is one line break */
+    while (s < e) {
+        int c = *s++;
+        if (c == '<') {
+            char tag[8];
+            int n = 0;
+            if (s < e && *s == '/')
+                s++;
+            while (s < e && isalnum((unsigned char)*s)) {
+                if (n < (int)sizeof(tag) - 1)
+                    tag[n++] = tolower((unsigned char)*s);
+                s++;
+            }
+            tag[n] = '\0';
+            while (s < e && *s++ != '>')
+                ;
+            if (is_break_tag(tag)) {
+                *o++ = '\n';
+                tag_nl = 1;
+            }
+            continue;
+        }
+
+        if (c == '&') {
+            int d = entity(&s, e);
+            c = d ? d : '&';
+        }
+
+        if (c == '\r' || (c == '\n' && tag_nl)) {
+            tag_nl = 0;
+            continue;
+        }
+        tag_nl = 0;
+        *o++ = (c == '\t') ? ' ' : c;
+    }
+
+    *o = '\0';
+    return o - text;
+}
+
+static uint64_t
+token_key(const char *s, int len)
+{
+    uint64_t k = 0;
+    for (int i = 0; i < KEY_LEN; i++)
+        k = (k << 8) | (i < len ? (uint8_t)toupper((unsigned char)s[i]) : 0);
+    return k;
+}
+
+typedef struct {
+    uint64_t key;
+    uint32_t ofs;
+} entry_t;
+
+static int
+entry_cmp(const void *a, const void *b)
+{
+    const entry_t *ea = a, *eb = b;
+    if (ea->key != eb->key)
+        return ea->key < eb->key ? -1 : 1;
+    return (int)ea->ofs - (int)eb->ofs;
+}
+
+static void
+search_free(tlsb_search_t *idx)
+{
+    tlsb_free(idx->text);
+    tlsb_free(idx->vocab);
+    tlsb_free(idx->post);
+    tlsb_free(idx->block);
+    tlsb_free(idx);
+}
+
+static tlsb_search_t *
+search_build(const char *key, const char *html, int len)
+{
+    entry_t *ent = NULL;
+    tlsb_search_t *idx = tlsb_calloc(TLSB_MEM_SEARCH, 1, sizeof(*idx));
+    if (NULL == idx || NULL == (idx->text = tlsb_malloc(TLSB_MEM_SEARCH, len + 1)))
+        goto err;
+
+    strncpy(idx->key, key, sizeof(idx->key) - 1);
+    idx->refcnt = 1;
+    idx->text_len = html_to_text(html, len, idx->text);
+    const unsigned char *t = (const unsigned char *)idx->text;
+    int n = idx->text_len;
+
+    /* tokens are runs of letters and digits */
+    int n_ent = 0, size = 1024;
+    ent = tlsb_malloc(TLSB_MEM_SEARCH, size * sizeof(entry_t));
+    if (NULL == ent)
+        goto err;
+
+    for (int i = 0; i < n; ) {
+        if (!isalnum(t[i])) {
+            i++;
+            continue;
+        }
+
+        int s = i;
+        while (i < n && isalnum(t[i]))
+            i++;
+
+        if (n_ent == size) {
+            size *= 2;
+            entry_t *e = tlsb_realloc(TLSB_MEM_SEARCH, ent, size * sizeof(entry_t));
+            if (NULL == e)
+                goto err;
+            ent = e;
+        }
+        ent[n_ent].key = token_key((const char *)t + s, i - s);
+        ent[n_ent++].ofs = s;
+    }
+
+    qsort(ent, n_ent, sizeof(entry_t), entry_cmp);
+
+    idx->vocab = tlsb_malloc(TLSB_MEM_SEARCH, (n_ent + 1) * sizeof(vocab_t));
+    idx->post = tlsb_malloc(TLSB_MEM_SEARCH, (n_ent + 1) * sizeof(uint32_t));
+    if (NULL == idx->vocab || NULL == idx->post)
+        goto err;
+
+    for (int i = 0; i < n_ent; i++) {
+        if (i == 0 || ent[i].key != ent[i - 1].key) {
+            idx->vocab[idx->n_vocab].key = ent[i].key;
+            idx->vocab[idx->n_vocab++].first = i;
+        }
+        idx->post[i] = ent[i].ofs;
+    }
+    idx->n_post = n_ent;
+    idx->vocab[idx->n_vocab].first = n_ent;
+    tlsb_free(ent);
+    ent = NULL;
+
+    vocab_t *v = tlsb_realloc(TLSB_MEM_SEARCH, idx->vocab, (idx->n_vocab + 1) * sizeof(vocab_t));
+    if (v)
+        idx->vocab = v;
+
+    /* blocks end at a blank line or after BLOCK_LINES lines */
+    size = 256;
+    idx->block = tlsb_malloc(TLSB_MEM_SEARCH, size * sizeof(uint32_t));
+    if (NULL == idx->block)
+        goto err;
+
+    int lines = 0, blank = 1;
+    for (int i = 0; i <= n; ) {
+        const unsigned char *nl = memchr(t + i, '\n', n - i);
+        int e = nl ? nl - t : n;
+
+        int is_blank = 1;
+        for (int j = i; j < e; j++)
+            if (!isspace(t[j])) {
+                is_blank = 0;
+                break;
+            }
+
+        if (!is_blank && (blank || lines == BLOCK_LINES)) {
+            if (idx->n_block + 1 == size) {
+                size *= 2;
+                uint32_t *b = tlsb_realloc(TLSB_MEM_SEARCH, idx->block, size * sizeof(uint32_t));
+                if (NULL == b)
+                    goto err;
+                idx->block = b;
+            }
+            idx->block[idx->n_block++] = i;
+            lines = 0;
+        }
+
+        lines++;
+        blank = is_blank;
+        i = e + 1;
+    }
+    idx->block[idx->n_block] = n;
+    return idx;
+
+err:
+    log_msg("can't malloc search index");
+    tlsb_free(ent);
+    if (idx)
+        search_free(idx);
+    return NULL;
+}
+
+/* store the index of an OFP's briefing, an OFP that's already there is not indexed again */
+void
+tlsb_search_add(const char *key, const char *html, int len)
+{
+    tlsb_search_t *idx = tlsb_search_get(key);
+    if (idx) {
+        tlsb_search_release(idx);
+        return;
+    }
+
+    long t0 = tlsb_now_ms();
+    idx = search_build(key, html, len);
+    if (NULL == idx)
+        return;
+
+    log_msg("briefing indexed: %d bytes of text, %d tokens, %d distinct, %d blocks in %ld ms",
+            idx->text_len, idx->n_post, idx->n_vocab, idx->n_block, tlsb_now_ms() - t0);
+
+    tlsb_search_t *old = NULL;
+    pthread_mutex_lock(&slot_mutex);
+    for (int i = 0; i < N_SLOT; i++)
+        if (slot[i] && 0 == strcmp(slot[i]->key, key)) {
+            /* lost a race */
+            pthread_mutex_unlock(&slot_mutex);
+            search_free(idx);
+            return;
+        }
+
+    if (slot[N_SLOT - 1] && 0 == --slot[N_SLOT - 1]->refcnt)
+        old = slot[N_SLOT - 1];
+    memmove(slot + 1, slot, (N_SLOT - 1) * sizeof(slot[0]));
+    slot[0] = idx;
+    pthread_mutex_unlock(&slot_mutex);
+
+    if (old)
+        search_free(old);
+}
+
+/* get a reference to an index, NULL if there is none */
+tlsb_search_t *
+tlsb_search_get(const char *key)
+{
+    tlsb_search_t *idx = NULL;
+
+    pthread_mutex_lock(&slot_mutex);
+    for (int i = 0; i < N_SLOT; i++)
+        if (slot[i] && 0 == strcmp(slot[i]->key, key)) {
+            idx = slot[i];
+            idx->refcnt++;
+            break;
+        }
+    pthread_mutex_unlock(&slot_mutex);
+    return idx;
+}
+
+void
+tlsb_search_release(tlsb_search_t *idx)
+{
+    if (NULL == idx)
+        return;
+
+    pthread_mutex_lock(&slot_mutex);
+    int last = (0 == --idx->refcnt);
+    pthread_mutex_unlock(&slot_mutex);
+
+    if (last)
+        search_free(idx);
+}
+
+void
+tlsb_search_cleanup(void)
+{
+    for (int i = 0; i < N_SLOT; i++) {
+        pthread_mutex_lock(&slot_mutex);
+        tlsb_search_t *idx = slot[i];
+        slot[i] = NULL;
+        pthread_mutex_unlock(&slot_mutex);
+        tlsb_search_release(idx);
+    }
+}
+
+const char *
+tlsb_search_text(const tlsb_search_t *idx)
+{
+    return idx->text;
+}
+
+/* a query word and its alternatives */
+typedef struct {
+    int n_alt;
+    const char *alt[MAX_ALT];
+    int lo[MAX_ALT], hi[MAX_ALT];   /* vocabulary range */
+    int n_post;
+} term_t;
+
+/* vocabulary range of a prefix */
+static void
+prefix_range(const tlsb_search_t *idx, const char *p, int *lo, int *hi)
+{
+    int len = strlen(p);
+    uint64_t kl = token_key(p, len);
+    uint64_t kh = kl;
+    if (len < KEY_LEN)
+        kh |= (1ULL << (8 * (KEY_LEN - len))) - 1;
+
+    int l = 0, h = idx->n_vocab;
+    while (l < h) {
+        int m = (l + h) / 2;
+        if (idx->vocab[m].key < kl)
+            l = m + 1;
+        else
+            h = m;
+    }
+    *lo = l;
+
+    h = idx->n_vocab;
+    while (l < h) {
+        int m = (l + h) / 2;
+        if (idx->vocab[m].key <= kh)
+            l = m + 1;
+        else
+            h = m;
+    }
+    *hi = l;
+}
+
+/* p is upper case */
+static int
+prefix_match(const char *s, const char *p)
+{
+    while (*p)
+        if (toupper((unsigned char)*s++) != *p++)
+            return 0;
+    return 1;
+}
+
+static int
+block_of(const tlsb_search_t *idx, uint32_t ofs)
+{
+    int l = 0, h = idx->n_block;
+    while (h - l > 1) {
+        int m = (l + h) / 2;
+        if (idx->block[m] <= ofs)
+            l = m;
+        else
+            h = m;
+    }
+    return l;
+}
+
+static void
+term_add(term_t *t, const char *w)
+{
+    for (int i = 0; i < t->n_alt; i++)
+        if (0 == strcmp(t->alt[i], w))
+            return;
+    if (t->n_alt < MAX_ALT)
+        t->alt[t->n_alt++] = w;
+}
+
+static int
+term_cmp(const void *a, const void *b)
+{
+    return ((const term_t *)a)->n_post - ((const term_t *)b)->n_post;
+}
+
+/* the line of block b with most of the terms */
+static void
+best_line(const tlsb_search_t *idx, int b, const term_t *term, int n_term, tlsb_hit_t *hit)
+{
+    const char *text = idx->text;
+    int best = -1;
+
+    for (const char *s = text + idx->block[b]; s < text + idx->block[b + 1]; ) {
+        const char *e = strchr(s, '\n');
+        if (NULL == e)
+            e = text + idx->text_len;
+
+        int n = 0;
+        for (int i = 0; i < n_term; i++) {
+            int found = 0;
+            for (const char *t = s; t < e && !found; t++) {
+                if (!isalnum((unsigned char)*t) || (t > s && isalnum((unsigned char)t[-1])))
+                    continue;
+                for (int a = 0; a < term[i].n_alt && !found; a++)
+                    found = prefix_match(t, term[i].alt[a]);
+            }
+            n += found;
+        }
+
+        if (n > best) {
+            best = n;
+            hit->ofs = s - text;
+            hit->len = e - s;
+        }
+        s = e + 1;
+    }
+}
+
+/*
+ * Search the briefing, alias is a NULL terminated list of upper case word, replacement pairs
+ * (e.g. "DESTINATION", "EDDF"). Fill up to max_hits hits, each the line of
+ * a matching block with most of the words.
+ * Return the # of matching blocks.
+ */
+int
+tlsb_search_query(const tlsb_search_t *idx, const char *query, const char *const *alias,
+                  tlsb_hit_t *hits, int max_hits)
+{
+    char word[MAX_TERM][32];
+    term_t term[MAX_TERM];
+    int n_word = 0, n_term = 0;
+
+    /* split into upper case words */
+    for (const char *s = query; *s && n_word < MAX_TERM; ) {
+        if (!isalnum((unsigned char)*s)) {
+            s++;
+            continue;
+        }
+        int n = 0;
+        while (isalnum((unsigned char)*s)) {
+            if (n < (int)sizeof(word[0]) - 1)
+                word[n_word][n++] = toupper((unsigned char)*s);
+            s++;
+        }
+        word[n_word++][n] = '\0';
+    }
+
+    for (int i = 0; i < n_word; i++) {
+        int stop = 0;
+        for (int j = 0; stop_word[j]; j++)
+            stop |= (0 == strcmp(word[i], stop_word[j]));
+        if (stop && n_word > 1)
+            continue;
+
+        term_t *t = &term[n_term++];
+        memset(t, 0, sizeof(*t));
+        term_add(t, word[i]);
+        for (int j = 0; abbrev[j][0]; j++)
+            if (0 == strcmp(word[i], abbrev[j][0]))
+                term_add(t, abbrev[j][1]);
+        for (int j = 0; alias && alias[j] && alias[j + 1]; j += 2)
+            if (0 == strcmp(word[i], alias[j]))
+                term_add(t, alias[j + 1]);
+
+        for (int a = 0; a < t->n_alt; a++) {
+            prefix_range(idx, t->alt[a], &t->lo[a], &t->hi[a]);
+            t->n_post += idx->vocab[t->hi[a]].first - idx->vocab[t->lo[a]].first;
+        }
+
+        if (0 == t->n_post)
+            return 0;
+    }
+
+    if (0 == n_term || 0 == idx->n_block)
+        return 0;
+
+    /* most specific first */
+    qsort(term, n_term, sizeof(term_t), term_cmp);
+
+    uint8_t *cnt = tlsb_calloc(TLSB_MEM_SEARCH, idx->n_block, 1);
+    if (NULL == cnt)
+        return 0;
+
+    for (int i = 0; i < n_term; i++) {
+        term_t *t = &term[i];
+        for (int a = 0; a < t->n_alt; a++) {
+            int len = strlen(t->alt[a]);
+            for (uint32_t p = idx->vocab[t->lo[a]].first; p < idx->vocab[t->hi[a]].first; p++) {
+                uint32_t ofs = idx->post[p];
+                /* beyond the key only the text can tell */
+                if (len > KEY_LEN && !prefix_match(idx->text + ofs, t->alt[a]))
+                    continue;
+                int b = block_of(idx, ofs);
+                if (cnt[b] != i)
+                    continue;
+                cnt[b] = i + 1;
+            }
+        }
+    }
+
+    int n_hit = 0;
+    for (int b = 0; b < idx->n_block; b++) {
+        if (cnt[b] != n_term)
+            continue;
+
+        if (n_hit < max_hits)
+            best_line(idx, b, term, n_term, &hits[n_hit]);
+        n_hit++;
+    }
+
+    tlsb_free(cnt);
+    return n_hit;
+}
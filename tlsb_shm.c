@@ -0,0 +1,202 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* shared memory publishing of the OFP, writer and reader side */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "tlsb.h"
+#include "tlsb_shm.h"
+
+static tlsb_shm_t *shm;     /* writer's mapping */
+#ifdef WINDOWS
+static HANDLE shm_handle;
+#endif
+
+static tlsb_shm_t *
+shm_create(void)
+{
+    void *addr;
+
+#ifdef WINDOWS
+    shm_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                    0, sizeof(tlsb_shm_t), TLSB_SHM_NAME);
+    if (NULL == shm_handle) {
+        log_msg("Can't create shared memory '%s': %u", TLSB_SHM_NAME, GetLastError());
+        return NULL;
+    }
+
+    addr = MapViewOfFile(shm_handle, FILE_MAP_WRITE, 0, 0, sizeof(tlsb_shm_t));
+    if (NULL == addr) {
+        CloseHandle(shm_handle);
+        return NULL;
+    }
+#else
+    int fd = shm_open(TLSB_SHM_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        log_msg("Can't create shared memory '%s'", TLSB_SHM_NAME);
+        return NULL;
+    }
+
+    if (0 != ftruncate(fd, sizeof(tlsb_shm_t))) {
+        close(fd);
+        return NULL;
+    }
+
+    addr = mmap(NULL, sizeof(tlsb_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == addr)
+        return NULL;
+#endif
+
+    tlsb_shm_t *s = addr;
+    /* a stale region of an earlier run may have another layout, start over */
+    memset(s, 0, sizeof(*s));
+    s->hdr.header_size = sizeof(tlsb_shm_hdr_t);
+    s->hdr.snapshot_size = sizeof(ofp_info_t);
+    s->hdr.version = TLSB_SHM_VERSION;
+    __atomic_store_n(&s->hdr.magic, TLSB_SHM_MAGIC, __ATOMIC_RELEASE);
+    return s;
+}
+
+/* publish a snapshot, return success == 1 */
+int
+tlsb_shm_publish(const ofp_info_t *ofp_info)
+{
+    if (NULL == shm && NULL == (shm = shm_create()))
+        return 0;
+
+    uint32_t seq = shm->hdr.seq;
+    __atomic_store_n(&shm->hdr.seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(&shm->ofp, ofp_info, sizeof(*ofp_info));
+    shm->hdr.generation++;
+    shm->hdr.publish_time = time(NULL);
+
+    __atomic_store_n(&shm->hdr.seq, seq + 2, __ATOMIC_RELEASE);
+    log_msg("OFP published to shared memory, generation %u", shm->hdr.generation);
+    return 1;
+}
+
+/* remove the region, readers that have it mapped see it retired and reopen */
+void
+tlsb_shm_destroy(void)
+{
+    if (NULL == shm)
+        return;
+
+    __atomic_store_n(&shm->hdr.magic, 0, __ATOMIC_RELEASE);
+
+#ifdef WINDOWS
+    UnmapViewOfFile(shm);
+    CloseHandle(shm_handle);
+#else
+    munmap(shm, sizeof(tlsb_shm_t));
+    shm_unlink(TLSB_SHM_NAME);
+#endif
+    shm = NULL;
+}
+
+/* ------------------------------------------------------------------ reader */
+
+const tlsb_shm_t *
+tlsb_shm_open(void)
+{
+    const tlsb_shm_t *s;
+
+#ifdef WINDOWS
+    HANDLE h = OpenFileMappingA(FILE_MAP_READ, FALSE, TLSB_SHM_NAME);
+    if (NULL == h)
+        return NULL;
+    s = MapViewOfFile(h, FILE_MAP_READ, 0, 0, sizeof(tlsb_shm_t));
+    CloseHandle(h);     /* the view keeps the mapping alive */
+    if (NULL == s)
+        return NULL;
+#else
+    int fd = shm_open(TLSB_SHM_NAME, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    if (lseek(fd, 0, SEEK_END) < (off_t)sizeof(tlsb_shm_t)) {
+        close(fd);
+        return NULL;
+    }
+    s = mmap(NULL, sizeof(tlsb_shm_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == s)
+        return NULL;
+#endif
+
+    if (__atomic_load_n(&s->hdr.magic, __ATOMIC_ACQUIRE) != TLSB_SHM_MAGIC
+        || s->hdr.version != TLSB_SHM_VERSION
+        || s->hdr.header_size != sizeof(tlsb_shm_hdr_t)
+        || s->hdr.snapshot_size != sizeof(ofp_info_t)) {
+        tlsb_shm_close(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+uint32_t
+tlsb_shm_read(const tlsb_shm_t *s, ofp_info_t *ofp_info)
+{
+    /* an update is a memcpy of sizeof(ofp_info_t), about 38 kB with the navlog,
+       so this bound is only hit if the writer died */
+    for (int i = 0; i < 1000000; i++) {
+        uint32_t seq1 = __atomic_load_n(&s->hdr.seq, __ATOMIC_ACQUIRE);
+        if (seq1 & 1)
+            continue;   /* update in progress */
+
+        memcpy(ofp_info, (const void *)&s->ofp, sizeof(*ofp_info));
+        uint32_t gen = s->hdr.generation;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq1 == __atomic_load_n(&s->hdr.seq, __ATOMIC_RELAXED))
+            return gen;
+    }
+
+    return 0;
+}
+
+void
+tlsb_shm_close(const tlsb_shm_t *s)
+{
+#ifdef WINDOWS
+    UnmapViewOfFile(s);
+#else
+    munmap((void *)s, sizeof(tlsb_shm_t));
+#endif
+}
@@ -0,0 +1,75 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _TLSB_SHM_H_
+#define _TLSB_SHM_H_
+
+/*
+ * The plugin publishes every new OFP into a named shared memory region.
+ *
+ * Layout: tlsb_shm_hdr_t followed by the snapshot (ofp_info_t).
+ * Readers must check magic, version and snapshot_size before use.
+ * The writer protects the snapshot with a seqlock: seq is odd while an update
+ * is in progress, a reader retries if seq was odd or changed during its copy.
+ */
+
+/* include "tlsb.h" first for ofp_info_t */
+#include <stdint.h>
+
+#ifdef WINDOWS
+#define TLSB_SHM_NAME "Local\\tlsb_ofp"
+#else
+#define TLSB_SHM_NAME "/tlsb_ofp"
+#endif
+
+#define TLSB_SHM_MAGIC 0x42534c54       /* "TLSB" */
+#define TLSB_SHM_VERSION 4
+
+typedef struct _tlsb_shm_hdr
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;       /* offset of the snapshot */
+    uint32_t snapshot_size;     /* sizeof(ofp_info_t) of the writer */
+    volatile uint32_t seq;      /* seqlock */
+    uint32_t generation;        /* incremented with every OFP published */
+    int64_t publish_time;       /* unix time of the last publish */
+} tlsb_shm_hdr_t;
+
+typedef struct _tlsb_shm
+{
+    tlsb_shm_hdr_t hdr;
+    ofp_info_t ofp;
+} tlsb_shm_t;
+
+/* writer, used by the plugin */
+extern int tlsb_shm_publish(const ofp_info_t *ofp_info);
+extern void tlsb_shm_destroy(void);
+
+/* reader, returns NULL if the plugin has not published yet or the layout does not match */
+extern const tlsb_shm_t *tlsb_shm_open(void);
+/* consistent copy of the snapshot, return generation (0 = nothing published yet) */
+extern uint32_t tlsb_shm_read(const tlsb_shm_t *shm, ofp_info_t *ofp_info);
+extern void tlsb_shm_close(const tlsb_shm_t *shm);
+#endif
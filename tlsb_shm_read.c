@@ -0,0 +1,121 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Command line consumer of the OFP published by the plugin.
+ *
+ * tlsb_shm_read        print the current OFP
+ * tlsb_shm_read -w     print every new OFP as it is published, across plugin restarts
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tlsb.h"
+#include "tlsb_shm.h"
+
+#define POLL_MS 250
+#define REOPEN_MS 2000
+
+/*
+ * A restarted plugin publishes into a new region, the one mapped stays frozen.
+ * Switch if the region now under the name is retired or shows another
+ * generation or publish time.
+ */
+static const tlsb_shm_t *
+reopen(const tlsb_shm_t *shm)
+{
+    int retired = (__atomic_load_n(&shm->hdr.magic, __ATOMIC_ACQUIRE) != TLSB_SHM_MAGIC);
+    const tlsb_shm_t *s = tlsb_shm_open();
+    if (NULL == s)
+        return shm;
+
+    if (!retired && s->hdr.generation == shm->hdr.generation
+        && s->hdr.publish_time == shm->hdr.publish_time) {
+        tlsb_shm_close(s);
+        return shm;
+    }
+
+    log_msg("shared memory was recreated, reopened");
+    tlsb_shm_close(shm);
+    return s;
+}
+
+int
+main(int argc, char **argv)
+{
+    int wait = (argc > 1 && 0 == strcmp(argv[1], "-w"));
+    static ofp_info_t ofp_info;
+    uint32_t last_gen = 0;
+    int idle_ms = 0;
+
+    const tlsb_shm_t *shm;
+    while (NULL == (shm = tlsb_shm_open())) {
+        if (!wait) {
+            log_msg("no OFP published, is the plugin running?");
+            exit(1);
+        }
+        sleep(1);
+    }
+
+    do {
+        uint32_t gen = tlsb_shm_read(shm, &ofp_info);
+        if (gen != last_gen) {
+            last_gen = gen;
+            idle_ms = 0;
+            log_msg("generation %u", gen);
+#define P(field) printf("%-16s %s\n", #field, ofp_info.field)
+            P(status); P(icao_airline); P(flight_number); P(aircraft_icao);
+            P(origin); P(origin_rwy); P(destination); P(destination_rwy); P(alternate);
+            P(ci); P(altitude); P(fuel_plan_ramp); P(pax_count); P(freight); P(payload);
+            P(route); P(time_generated); P(airac);
+#undef P
+            for (int i = 0; i < ofp_info.n_fix; i++)
+                printf("%3d %-7s %-5s %-8s %6d %10.5f %11.5f\n", i, ofp_info.navlog[i].ident,
+                        ofp_info.navlog[i].type, ofp_info.navlog[i].via, ofp_info.navlog[i].altitude,
+                        ofp_info.navlog[i].lat, ofp_info.navlog[i].lon);
+            fflush(stdout);
+        } else if (!wait) {
+            log_msg("nothing published yet");
+        }
+
+        if (wait) {
+            usleep(POLL_MS * 1000);   /* the read itself is a plain memory access */
+            idle_ms += POLL_MS;
+            if (idle_ms >= REOPEN_MS) {
+                const tlsb_shm_t *s = reopen(shm);
+                if (s != shm) {
+                    shm = s;
+                    last_gen = 0;
+                }
+                idle_ms = 0;
+            }
+        }
+    } while (wait);
+
+    tlsb_shm_close(shm);
+    return 0;
+}
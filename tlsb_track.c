@@ -0,0 +1,321 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Progress along the navlog from the aircraft position.
+ *
+ * Points are the origin and the navlog fixes as unit vectors, leg i runs from
+ * point i to i + 1. Distances are great circle, along and across the leg.
+ *
+ * The leg is followed by a cursor that only looks at the current and the next
+ * two legs, so an update is O(1). When the aircraft is far off all of them
+ * (first fix, direct to, a situation was loaded) the leg is found again with
+ * a grid of 1x1 degree cells: sorted (cell, leg) pairs of the cells each leg
+ * passes through, the 3x3 cells around the position are searched.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "tlsb.h"
+
+#define NM_PER_RAD 3437.747     /* 180 * 60 / pi */
+#define D2R (M_PI / 180.0)
+#define LOST_NM 30.0            /* farther off the leg: search again */
+#define LOOKAHEAD 3
+
+static void
+to_vec(double lat, double lon, double *v)
+{
+    lat *= D2R;
+    lon *= D2R;
+    v[0] = cos(lat) * cos(lon);
+    v[1] = cos(lat) * sin(lon);
+    v[2] = sin(lat);
+}
+
+static double
+dot(const double *a, const double *b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void
+cross(const double *a, const double *b, double *c)
+{
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/* angle between unit vectors, well conditioned for short distances */
+static double
+angle(const double *a, const double *b)
+{
+    double c[3];
+    cross(a, b, c);
+    return atan2(sqrt(dot(c, c)), dot(a, b));
+}
+
+static uint32_t
+cell_key(double lat, double lon)
+{
+    int r = (int)floor(lat) + 90;
+    int c = ((int)floor(lon) + 360) % 360;
+    if (r < 0) r = 0;
+    if (r > 179) r = 179;
+    return r * 360 + c;
+}
+
+static int
+cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* cells of leg i, sampled every half degree, consecutive duplicates dropped */
+static void
+index_leg(tlsb_track_t *tr, int i)
+{
+    const double *a = tr->p[i], *b = tr->p[i + 1];
+    double len = tr->leg_nm[i] / NM_PER_RAD;
+    int n = (int)(len / (0.5 * D2R)) + 1;
+    uint32_t last = UINT32_MAX;
+
+    for (int k = 0; k <= n; k++) {
+        /* slerp */
+        double f = (double)k / n, v[3];
+        double sa = sin((1.0 - f) * len), sb = sin(f * len), s = sin(len);
+        for (int j = 0; j < 3; j++)
+            v[j] = s > 1.0E-9 ? (sa * a[j] + sb * b[j]) / s : a[j];
+
+        uint32_t key = cell_key(asin(v[2]) / D2R, atan2(v[1], v[0]) / D2R);
+        if (key == last)
+            continue;
+        last = key;
+
+        if (tr->n_cell == TRACK_MAX_CELL) {
+            tr->n_cell = -1;        /* too long a route, linear search */
+            return;
+        }
+        tr->cell[tr->n_cell++] = key << 9 | i;
+    }
+}
+
+/* build the legs from the navlog, return # of legs */
+int
+tlsb_track_init(tlsb_track_t *tr, const ofp_info_t *ofp_info)
+{
+    float to_kg = (0 == strcmp("lbs", ofp_info->units)) ? LB_2_KG : 1.0f;
+    memset(tr, 0, sizeof(*tr));
+    tr->leg = -1;
+
+    /* distance to go and fuel at destination would be to the last fix kept */
+    if (ofp_info->navlog_truncated) {
+        log_msg("navlog is truncated, no route progress");
+        return 0;
+    }
+
+    if (ofp_info->origin_lat[0]) {
+        to_vec(atof(ofp_info->origin_lat), atof(ofp_info->origin_lon), tr->p[0]);
+        float fob = atof(ofp_info->fuel_plan_takeoff);
+        tr->fob[0] = fob > 0.0f ? fob * to_kg : -1.0f;
+        tr->fix[0] = -1;
+        tr->n_pt = 1;
+    }
+
+    for (int i = 0; i < ofp_info->n_fix && tr->n_pt < TRACK_MAX_PT; i++) {
+        const ofp_fix_t *fix = &ofp_info->navlog[i];
+        double *v = tr->p[tr->n_pt];
+        to_vec(fix->lat, fix->lon, v);
+
+        /* no zero length legs, e.g. TOC on top of a waypoint */
+        if (tr->n_pt > 0 && angle(tr->p[tr->n_pt - 1], v) * NM_PER_RAD < 0.1)
+            continue;
+
+        tr->fob[tr->n_pt] = fix->fuel_onboard > 0.0f ? fix->fuel_onboard * to_kg : -1.0f;
+        tr->fix[tr->n_pt] = i;
+        tr->n_pt++;
+    }
+
+    /* the navlog normally ends there, else the fuel at destination is unknown */
+    if (ofp_info->destination_lat[0]) {
+        double *v = tr->p[tr->n_pt];
+        to_vec(atof(ofp_info->destination_lat), atof(ofp_info->destination_lon), v);
+        if (tr->n_pt > 0 && angle(tr->p[tr->n_pt - 1], v) * NM_PER_RAD >= 0.1) {
+            tr->fob[tr->n_pt] = -1.0f;
+            tr->fix[tr->n_pt] = -2;
+            tr->n_pt++;
+        }
+    }
+
+    if (tr->n_pt < 2)
+        return 0;
+
+    tr->togo_pt[tr->n_pt - 1] = 0.0f;
+    for (int i = tr->n_pt - 2; i >= 0; i--) {
+        tr->leg_nm[i] = angle(tr->p[i], tr->p[i + 1]) * NM_PER_RAD;
+        tr->togo_pt[i] = tr->togo_pt[i + 1] + tr->leg_nm[i];
+    }
+
+    for (int i = 0; i < tr->n_pt - 1 && tr->n_cell >= 0; i++)
+        index_leg(tr, i);
+    if (tr->n_cell > 0)
+        qsort(tr->cell, tr->n_cell, sizeof(tr->cell[0]), cmp_u32);
+
+    return tr->n_pt - 1;
+}
+
+/* distance to leg i in nm and how far along it the position is, 0...1 */
+static double
+leg_dist(const tlsb_track_t *tr, int i, const double *p, double *f)
+{
+    const double *a = tr->p[i], *b = tr->p[i + 1];
+    double n[3], na[3];
+    cross(a, b, n);
+    double s = sqrt(dot(n, n));
+    for (int j = 0; j < 3; j++)
+        n[j] /= s;
+
+    cross(n, a, na);        /* direction of the leg at a */
+    double xtk = asin(dot(p, n)) * NM_PER_RAD;
+    double along = atan2(dot(p, na), dot(p, a)) * NM_PER_RAD;
+
+    *f = along / tr->leg_nm[i];
+    if (along < 0.0) {
+        *f = 0.0;
+        return angle(p, a) * NM_PER_RAD;
+    }
+    if (along > tr->leg_nm[i]) {
+        *f = 1.0;
+        return angle(p, b) * NM_PER_RAD;
+    }
+    return fabs(xtk);
+}
+
+/* nearest leg via the grid, linear if there is no grid or nothing near */
+static int
+find_leg(tlsb_track_t *tr, const double *p, double lat, double lon)
+{
+    int best = -1;
+    double best_d = 1.0E9, f;
+
+    if (tr->n_cell > 0) {
+        uint32_t key0 = cell_key(lat, lon);
+        int r0 = key0 / 360, c0 = key0 % 360;
+        for (int r = r0 - 1; r <= r0 + 1; r++) {
+            if (r < 0 || r > 179)
+                continue;
+            for (int c = c0 - 1; c <= c0 + 1; c++) {
+                uint32_t key = r * 360 + (c + 360) % 360;
+
+                /* lower bound of key << 9 */
+                int lo = 0, hi = tr->n_cell;
+                while (lo < hi) {
+                    int mid = (lo + hi) / 2;
+                    if (tr->cell[mid] >> 9 < key)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+
+                for (int k = lo; k < tr->n_cell && tr->cell[k] >> 9 == key; k++) {
+                    int i = tr->cell[k] & 511;
+                    double d = leg_dist(tr, i, p, &f);
+                    if (d < best_d) {
+                        best_d = d;
+                        best = i;
+                    }
+                }
+            }
+        }
+
+        /* a leg outside the 3x3 cells may be nearer than a far one inside */
+        tr->n_grid++;
+        if (best >= 0 && best_d <= LOST_NM)
+            return best;
+    }
+
+    tr->n_linear++;
+
+    for (int i = 0; i < tr->n_pt - 1; i++) {
+        double d = leg_dist(tr, i, p, &f);
+        if (d < best_d) {
+            best_d = d;
+            best = i;
+        }
+    }
+    return best;
+}
+
+/*
+ * Update from the aircraft position and actual fuel on board in kg.
+ * Sets leg, next_nm, togo_nm, off_nm and efob (planned fuel at destination
+ * corrected by the actual, < 0 if the navlog has no fuel), return leg.
+ */
+int
+tlsb_track_update(tlsb_track_t *tr, double lat, double lon, float fob)
+{
+    if (tr->n_pt < 2)
+        return -1;
+
+    double p[3], f = 0.0, d = 1.0E9;
+    to_vec(lat, lon, p);
+
+    /* the first leg ahead that the position has not passed yet */
+    int i = tr->leg;
+    if (i >= 0) {
+        int last = i;
+        for (int k = 0; k < LOOKAHEAD && i + k < tr->n_pt - 1; k++) {
+            last = i + k;
+            d = leg_dist(tr, last, p, &f);
+            if (f < 1.0)
+                break;
+        }
+        i = last;
+    }
+
+    if (i < 0 || d > LOST_NM) {
+        i = find_leg(tr, p, lat, lon);
+        d = leg_dist(tr, i, p, &f);
+    }
+
+    tr->leg = i;
+    tr->off_nm = d;
+    tr->next_nm = angle(p, tr->p[i + 1]) * NM_PER_RAD;
+    tr->togo_nm = tr->next_nm + tr->togo_pt[i + 1];
+
+    /* planned fuel here from the leg's end points */
+    float fob0 = tr->fob[i], fob1 = tr->fob[i + 1], fob_dest = tr->fob[tr->n_pt - 1];
+    if (fob1 < 0.0f || fob_dest < 0.0f) {
+        tr->efob = -1.0f;
+    } else {
+        float plan = fob0 < 0.0f ? fob1 : fob0 + (float)f * (fob1 - fob0);
+        tr->efob = fob - (plan - fob_dest);
+    }
+    return i;
+}
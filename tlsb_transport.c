@@ -0,0 +1,526 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Runtime selection of the transport below the request policy in tlsb_http.c
+ *
+ * native          libcurl or WinHTTP
+ * record:<dir>    native, every response with its timing is saved in <dir>
+ * replay:<dir>    responses are played back from <dir> with the recorded timing
+ * replay-fast:<dir>  same, but without delays
+ *
+ * file:// urls always go to the file transport.
+ * The plugin takes the spec from the environment variable TLSB_TRANSPORT.
+ *
+ * A compressed body is decoded here, above the transport, so records hold
+ * the bytes as they came over the wire.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "tlsb.h"
+
+static const tlsb_transport_t *transport;
+static char rec_dir[400];
+static int replay_timed;
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t rec_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int rec_seq;
+
+/* deliver to the sink of the request, return # of bytes taken */
+static size_t
+sink(tlsb_http_req_t *req, const void *ptr, size_t len)
+{
+    if (req->write_cb)
+        len = req->write_cb(ptr, len, req);
+    else if (req->f)
+        len = fwrite(ptr, 1, len, req->f);
+    req->ret_len += len;
+    return len;
+}
+
+static void
+reset_results(tlsb_http_req_t *req)
+{
+    req->http_status = 0;
+    req->accept_ranges = 0;
+    req->total_length = -1;
+    req->ret_len = 0;
+    req->connect_ms = req->ttfb_ms = req->total_ms = -1;
+    req->content_encoding[0] = '\0';
+}
+
+/* sleep until t0 + ms, return 0 if cancelled */
+static int
+sleep_until(long t0, int ms, const tlsb_cancel_t *cancel)
+{
+    long now;
+    while ((now = tlsb_now_ms()) < t0 + ms) {
+        if (tlsb_cancelled(cancel))
+            return 0;
+        long d = t0 + ms - now;
+        if (d > 20)
+            d = 20;
+        struct timespec ts = { 0, d * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    return !tlsb_cancelled(cancel);
+}
+
+/* ------------------------------------------------------------------ file:// */
+
+static int
+file_perform(tlsb_http_req_t *req)
+{
+    long t0 = tlsb_now_ms();
+    const char *path = req->url + 7;
+
+    reset_results(req);
+#ifdef WINDOWS
+    if (path[0] == '/' && path[2] == ':')   /* file:///C:/... */
+        path++;
+#endif
+
+    FILE *f = fopen(path, "rb");
+    req->connect_ms = 0;
+    if (NULL == f) {
+        req->http_status = 404;
+        req->total_ms = tlsb_now_ms() - t0;
+        return 1;   /* like http: the transfer worked */
+    }
+
+    long size = tlsb_file_size(path);
+    long start = req->range_start, end = size - 1;
+    if (req->range_end > 0 && req->range_end < end)
+        end = req->range_end;
+
+    req->accept_ranges = 1;
+    req->total_length = size;
+    if (start > 0 || req->range_end > 0) {
+        if (start >= size) {
+            req->http_status = 416;
+            fclose(f);
+            return 1;
+        }
+        req->http_status = 206;
+        fseek(f, start, SEEK_SET);
+    } else
+        req->http_status = 200;
+
+    int res = 1;
+    char buffer[64 * 1024];
+    long left = end - start + 1;
+    while (left > 0) {
+        if (tlsb_cancelled(req->cancel)) {
+            res = 0;
+            break;
+        }
+        size_t n = fread(buffer, 1, left < (long)sizeof(buffer) ? left : (long)sizeof(buffer), f);
+        if (0 == n) {
+            res = 0;
+            break;
+        }
+        if (req->ttfb_ms < 0)
+            req->ttfb_ms = tlsb_now_ms() - t0;
+        if (n != sink(req, buffer, n)) {
+            res = 0;
+            break;
+        }
+        left -= n;
+    }
+
+    fclose(f);
+    req->total_ms = tlsb_now_ms() - t0;
+    return res;
+}
+
+const tlsb_transport_t tlsb_transport_file = { "file", file_perform, NULL };
+
+/* ------------------------------------------------------------------ record / replay */
+
+/* the record of a request is named after url and range */
+static void
+rec_fn(const tlsb_http_req_t *req, char *fn, int len)
+{
+    char key[50];
+    snprintf(key, sizeof(key), "|%ld-%ld", req->range_start, req->range_end);
+    uint64_t h = tlsb_fnv1a(TLSB_FNV_INIT, req->url, strlen(req->url));
+    h = tlsb_fnv1a(h, key, strlen(key));
+    snprintf(fn, len, "%s/%016" PRIx64 ".rec", rec_dir, h);
+}
+
+typedef struct {
+    tlsb_http_req_t *req;
+    size_t (*write_cb)(const void *ptr, size_t len, tlsb_http_req_t *req);
+    void *write_ctx;
+    long t0;
+    char *data;         /* "C <t_ms> <len>\n" + bytes, ... */
+    size_t len, size;
+} rec_ctx_t;
+
+static size_t
+rec_write_cb(const void *ptr, size_t len, tlsb_http_req_t *req)
+{
+    rec_ctx_t *rc = req->write_ctx;
+
+    /* forward to the real sink with the original callback in place */
+    req->write_cb = rc->write_cb;
+    req->write_ctx = rc->write_ctx;
+    long ret_len = req->ret_len;    /* the backend counts */
+    size_t n = sink(req, ptr, len);
+    req->ret_len = ret_len;
+    req->write_cb = rec_write_cb;
+    req->write_ctx = rc;
+
+    if (rc->len + n + 40 > rc->size) {
+        size_t size = rc->size ? 2 * rc->size : 64 * 1024;
+        while (rc->len + n + 40 > size)
+            size *= 2;
+        char *data = tlsb_realloc(TLSB_MEM_HTTP, rc->data, size);
+        if (NULL == data)
+            return 0;
+        rc->data = data;
+        rc->size = size;
+    }
+
+    rc->len += sprintf(rc->data + rc->len, "C %ld %lu\n", tlsb_now_ms() - rc->t0, (unsigned long)n);
+    memcpy(rc->data + rc->len, ptr, n);
+    rc->len += n;
+    return n;
+}
+
+static int
+record_perform(tlsb_http_req_t *req)
+{
+    rec_ctx_t rc;
+    memset(&rc, 0, sizeof(rc));
+    rc.req = req;
+    rc.write_cb = req->write_cb;
+    rc.write_ctx = req->write_ctx;
+    rc.t0 = tlsb_now_ms();
+
+    /* rec_write_cb calls the original sink, f is only used if there is no callback */
+    req->write_cb = rec_write_cb;
+    req->write_ctx = &rc;
+    int res = tlsb_transport_native.perform(req);
+    req->write_cb = rc.write_cb;
+    req->write_ctx = rc.write_ctx;
+
+    char fn[520], tfn[540];
+    rec_fn(req, fn, sizeof(fn));
+    pthread_mutex_lock(&rec_mutex);
+    snprintf(tfn, sizeof(tfn), "%s.%d.tmp", fn, rec_seq++);     /* hedged twins */
+    pthread_mutex_unlock(&rec_mutex);
+
+    FILE *f = fopen(tfn, "wb");
+    if (f) {
+        int ok = 0 < fprintf(f, "TLSBREC1\nurl %s\nresult %d %d %d %ld %d %d %d\n", req->url, res,
+                             req->http_status, req->accept_ranges, req->total_length,
+                             req->connect_ms, req->ttfb_ms, req->total_ms);
+        if (ok && req->content_encoding[0])
+            ok = 0 < fprintf(f, "encoding %s\n", req->content_encoding);
+        ok = ok && (rc.len == fwrite(rc.data, 1, rc.len, f));
+        ok = ok && 0 < fprintf(f, "E\n");
+        if (fclose(f) == 0 && ok)
+            tlsb_rename(tfn, fn);
+        else
+            unlink(tfn);
+    } else
+        log_msg("record: can't create '%s'", tfn);
+
+    tlsb_free(rc.data);
+    return res;
+}
+
+static int
+replay_perform(tlsb_http_req_t *req)
+{
+    char fn[520], line[1100];
+    long t0 = tlsb_now_ms();
+    int res = 0;
+
+    reset_results(req);
+    rec_fn(req, fn, sizeof(fn));
+    FILE *f = fopen(fn, "rb");
+    if (NULL == f) {
+        log_msg("replay: no record for '%s'", req->url);
+        return 0;
+    }
+
+    if (NULL == fgets(line, sizeof(line), f) || strcmp(line, "TLSBREC1\n")
+        || NULL == fgets(line, sizeof(line), f)
+        || NULL == fgets(line, sizeof(line), f)
+        || 7 != sscanf(line, "result %d %d %d %ld %d %d %d", &res, &req->http_status, &req->accept_ranges,
+                       &req->total_length, &req->connect_ms, &req->ttfb_ms, &req->total_ms)) {
+        log_msg("replay: bad record '%s'", fn);
+        fclose(f);
+        return 0;
+    }
+
+    char *buffer = NULL;
+    size_t size = 0;
+    int t_ms;
+    unsigned long len;
+    /* optional encoding line, then the chunks */
+    char *l = fgets(line, sizeof(line), f);
+    if (l && 1 == sscanf(line, "encoding %15s", req->content_encoding))
+        l = fgets(line, sizeof(line), f);
+
+    while (l && 2 == sscanf(line, "C %d %lu", &t_ms, &len)) {
+        if (len > size) {
+            char *b = tlsb_realloc(TLSB_MEM_HTTP, buffer, len);
+            if (NULL == b)
+                break;
+            buffer = b;
+            size = len;
+        }
+
+        if (len != fread(buffer, 1, len, f)
+            || (replay_timed && !sleep_until(t0, t_ms, req->cancel))
+            || tlsb_cancelled(req->cancel)
+            || len != sink(req, buffer, len)) {
+            res = 0;
+            break;
+        }
+        l = fgets(line, sizeof(line), f);
+    }
+
+    if (res && replay_timed)
+        res = sleep_until(t0, req->total_ms, req->cancel);
+
+    tlsb_free(buffer);
+    fclose(f);
+    return res;
+}
+
+static void
+native_cleanup(void)
+{
+    if (tlsb_transport_native.cleanup)
+        tlsb_transport_native.cleanup();
+}
+
+static const tlsb_transport_t transport_record = { "record", record_perform, native_cleanup };
+static const tlsb_transport_t transport_replay = { "replay", replay_perform, NULL };
+
+/* ------------------------------------------------------------------ content decoding */
+
+enum { DEC_START, DEC_PASS, DEC_INFLATE, DEC_END };
+
+static size_t decode_write_cb(const void *ptr, size_t len, tlsb_http_req_t *req);
+
+typedef struct {
+    size_t (*write_cb)(const void *ptr, size_t len, tlsb_http_req_t *req);
+    void *write_ctx;
+    int state;
+    z_stream z;
+    long out_len;
+    long us;
+} decode_ctx_t;
+
+static long
+now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+/* deliver decoded bytes to the sink of the request, return success == 1 */
+static int
+decode_out(tlsb_http_req_t *req, decode_ctx_t *dc, const void *ptr, size_t len)
+{
+    size_t n = len;
+    if (dc->write_cb) {
+        req->write_cb = dc->write_cb;
+        req->write_ctx = dc->write_ctx;
+        n = dc->write_cb(ptr, len, req);
+        req->write_cb = decode_write_cb;
+        req->write_ctx = dc;
+    } else if (req->f)
+        n = fwrite(ptr, 1, len, req->f);
+
+    dc->out_len += n;
+    return n == len;
+}
+
+static size_t
+decode_write_cb(const void *ptr, size_t len, tlsb_http_req_t *req)
+{
+    decode_ctx_t *dc = req->write_ctx;
+
+    /* the headers are in with the first byte of the body */
+    if (DEC_START == dc->state) {
+        const char *ce = req->content_encoding;
+        if (0 == strcmp(ce, "gzip") || 0 == strcmp(ce, "x-gzip") || 0 == strcmp(ce, "deflate")) {
+            /* 15 + 32: 32k window, detect a gzip or zlib header */
+            if (Z_OK != inflateInit2(&dc->z, 15 + 32))
+                return 0;
+            dc->state = DEC_INFLATE;
+        } else if ('\0' == ce[0] || 0 == strcmp(ce, "identity")) {
+            dc->state = DEC_PASS;
+        } else {
+            log_msg("http: unsupported content encoding '%s'", ce);
+            return 0;
+        }
+    }
+
+    if (DEC_PASS == dc->state)
+        return decode_out(req, dc, ptr, len) ? len : 0;
+
+    if (DEC_END == dc->state)
+        return len;         /* ignore trailing garbage */
+
+    unsigned char out[32 * 1024];
+    dc->z.next_in = (Bytef *)ptr;
+    dc->z.avail_in = len;
+    do {
+        dc->z.next_out = out;
+        dc->z.avail_out = sizeof(out);
+        long t0 = now_us();
+        int zres = inflate(&dc->z, Z_NO_FLUSH);
+        dc->us += now_us() - t0;
+
+        if (Z_OK != zres && Z_STREAM_END != zres && Z_BUF_ERROR != zres) {
+            log_msg("http: can't decode body: %s", dc->z.msg ? dc->z.msg : "inflate error");
+            return 0;
+        }
+
+        size_t n = sizeof(out) - dc->z.avail_out;
+        if (n > 0 && !decode_out(req, dc, out, n))
+            return 0;
+
+        if (Z_STREAM_END == zres) {
+            dc->state = DEC_END;
+            break;
+        }
+        if (0 == n)
+            break;          /* needs more input */
+    } while (dc->z.avail_in > 0 || 0 == dc->z.avail_out);
+
+    return len;
+}
+
+static int
+decode_perform(const tlsb_transport_t *t, tlsb_http_req_t *req)
+{
+    decode_ctx_t dc;
+    memset(&dc, 0, sizeof(dc));
+    dc.write_cb = req->write_cb;
+    dc.write_ctx = req->write_ctx;
+
+    req->write_cb = decode_write_cb;
+    req->write_ctx = &dc;
+    int res = t->perform(req);
+    req->write_cb = dc.write_cb;
+    req->write_ctx = dc.write_ctx;
+
+    req->wire_len = req->ret_len;
+    req->decode_us = dc.us;
+    if (DEC_INFLATE == dc.state || DEC_END == dc.state) {
+        if (res && DEC_END != dc.state) {
+            log_msg("http: compressed body is truncated");
+            res = 0;
+        }
+        inflateEnd(&dc.z);
+        req->ret_len = dc.out_len;
+    }
+    return res;
+}
+
+/* ------------------------------------------------------------------ API */
+
+/* select the transport, call before the first request. return success == 1 */
+int
+tlsb_transport_select(const char *spec)
+{
+    const char *colon = strchr(spec, ':');
+    transport = &tlsb_transport_native;
+
+    if (0 == strcmp(spec, "native"))
+        ;
+    else if (colon && 0 == strncmp(spec, "record:", 7))
+        transport = &transport_record;
+    else if (colon && 0 == strncmp(spec, "replay:", 7))
+        transport = &transport_replay, replay_timed = 1;
+    else if (colon && 0 == strncmp(spec, "replay-fast:", 12))
+        transport = &transport_replay, replay_timed = 0;
+    else {
+        log_msg("unknown transport '%s', using %s", spec, transport->name);
+        return 0;
+    }
+
+    if (colon) {
+        strncpy(rec_dir, colon + 1, sizeof(rec_dir) - 1);
+        if (transport == &transport_record && !tlsb_mkdir(rec_dir))
+            return 0;
+    }
+
+    log_msg("transport: %s", spec);
+    return 1;
+}
+
+static void
+select_from_env(void)
+{
+    if (NULL == transport) {
+        const char *spec = getenv("TLSB_TRANSPORT");
+        if (spec)
+            tlsb_transport_select(spec);
+        else
+            transport = &tlsb_transport_native;
+    }
+}
+
+int
+tlsb_http_perform(tlsb_http_req_t *req)
+{
+    const tlsb_transport_t *t = &tlsb_transport_file;
+    if (strncmp(req->url, "file://", 7)) {
+        pthread_once(&select_once, select_from_env);
+        t = transport;
+    }
+
+    if (req->compress)
+        return decode_perform(t, req);
+
+    int res = t->perform(req);
+    req->wire_len = req->ret_len;
+    req->decode_us = 0;
+    return res;
+}
+
+/* call only when no request is active anymore */
+void
+tlsb_http_backend_cleanup(void)
+{
+    native_cleanup();
+}
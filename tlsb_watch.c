@@ -0,0 +1,289 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Watch a directory for OFP xml files written by local dispatch tools.
+ *
+ * A worker thread waits for changes, parses new or rewritten *.xml files and
+ * hands the latest good OFP to the main thread.
+ *   Linux      inotify, a file counts when it's closed after writing or moved in
+ *   Windows    change notification, then a scan for new or changed files
+ *   elsewhere  a scan of the directory every SCAN_MS
+ * Files present when the watch starts are ignored.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(LIN)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "tlsb.h"
+
+#define WAIT_MS 250     /* the worker looks at the stop flag that often */
+#define SCAN_MS 2000
+
+static char watch_dir[200];
+static pthread_t watch_thread;
+static int watch_running;
+static volatile int watch_stop;
+
+static pthread_mutex_t watch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int watch_ready;                 /* these 2 are protected by watch_mutex */
+static char watch_ready_fn[300];
+static ofp_info_t watch_info;           /* worker only */
+static ofp_info_t watch_ready_info;
+
+static int
+is_xml(const char *name)
+{
+    int len = strlen(name);
+    return len > 4 && (0 == strcmp(name + len - 4, ".xml") || 0 == strcmp(name + len - 4, ".XML"));
+}
+
+/* parse the file and pass it on if it's a good OFP */
+static void
+watch_parse(const char *name)
+{
+    char fn[300];
+    snprintf(fn, sizeof(fn), "%s/%s", watch_dir, name);
+
+    long len = tlsb_ofp_parse_file(fn, &watch_info, 1);
+    if (len < 0 || strcmp(watch_info.status, "Success")) {
+        log_msg("watch: '%s' is not an OFP", name);
+        return;
+    }
+
+    log_msg("watch: '%s' %ld bytes, %s%s -> %s", name, len, watch_info.icao_airline,
+            watch_info.flight_number, watch_info.destination);
+    pthread_mutex_lock(&watch_mutex);
+    memcpy(&watch_ready_info, &watch_info, sizeof(watch_ready_info));
+    strcpy(watch_ready_fn, name);
+    watch_ready = 1;
+    pthread_mutex_unlock(&watch_mutex);
+}
+
+#ifdef LIN
+static void *
+watch_proc(void *arg)
+{
+    (void)arg;
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, watch_dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        log_msg("watch: can't watch '%s'", watch_dir);
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+    while (!watch_stop) {
+        if (poll(&pfd, 1, WAIT_MS) <= 0)
+            continue;
+
+        int len = read(fd, buf, sizeof(buf));
+        for (char *p = buf; len > 0 && p < buf + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->len > 0 && is_xml(ev->name))
+                watch_parse(ev->name);
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+
+    close(fd);
+    return NULL;
+}
+
+#else
+
+/*
+ * What the scan has seen of a file. mtime has a resolution of a second, so a
+ * file rewritten within the same second is told apart by its size.
+ */
+#define SEEN_MAX 64
+typedef struct {
+    char name[100];
+    time_t mtime;
+    off_t size;
+} seen_t;
+static seen_t seen[SEEN_MAX];
+static int n_seen;
+
+/* return 1 if the file is new or changed since the last scan, and remember it */
+static int
+seen_update(const char *name, const struct stat *sb)
+{
+    seen_t *e = NULL;
+    for (int i = 0; i < n_seen && NULL == e; i++)
+        if (0 == strcmp(seen[i].name, name))
+            e = &seen[i];
+
+    if (e && e->mtime == sb->st_mtime && e->size == sb->st_size)
+        return 0;
+
+    if (NULL == e) {
+        if (n_seen < SEEN_MAX) {
+            e = &seen[n_seen++];
+        } else {
+            /* forget the oldest */
+            e = &seen[0];
+            for (int i = 1; i < n_seen; i++)
+                if (seen[i].mtime < e->mtime)
+                    e = &seen[i];
+        }
+        snprintf(e->name, sizeof(e->name), "%s", name);
+    }
+
+    e->mtime = sb->st_mtime;
+    e->size = sb->st_size;
+    return 1;
+}
+
+/* parse new or changed files, with parse = 0 just note what's there */
+static void
+watch_scan(int parse)
+{
+    DIR *d = opendir(watch_dir);
+    if (NULL == d)
+        return;
+
+    struct dirent *de;
+    while (NULL != (de = readdir(d))) {
+        char fn[300];
+        struct stat sb;
+        if (!is_xml(de->d_name) || strlen(de->d_name) >= sizeof(seen[0].name))
+            continue;
+
+        snprintf(fn, sizeof(fn), "%s/%s", watch_dir, de->d_name);
+        if (0 != stat(fn, &sb) || !seen_update(de->d_name, &sb) || !parse)
+            continue;
+
+        watch_parse(de->d_name);
+    }
+    closedir(d);
+}
+
+static void *
+watch_proc(void *arg)
+{
+    (void)arg;
+    n_seen = 0;
+    watch_scan(0);
+
+#ifdef WINDOWS
+    HANDLE h = FindFirstChangeNotificationA(watch_dir, FALSE,
+                                            FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if (INVALID_HANDLE_VALUE == h) {
+        log_msg("watch: can't watch '%s'", watch_dir);
+        return NULL;
+    }
+
+    while (!watch_stop) {
+        if (WAIT_OBJECT_0 != WaitForSingleObject(h, WAIT_MS))
+            continue;
+        /* the notification comes with the first write, give the writer a moment */
+        Sleep(WAIT_MS);
+        watch_scan(1);
+        FindNextChangeNotification(h);
+    }
+
+    FindCloseChangeNotification(h);
+#else
+    for (int ms = 0; !watch_stop; ms += WAIT_MS) {
+        usleep(WAIT_MS * 1000);
+        if (ms >= SCAN_MS) {
+            watch_scan(1);
+            ms = 0;
+        }
+    }
+#endif
+    return NULL;
+}
+#endif
+
+/* return success == 1 */
+int
+tlsb_watch_start(const char *dir)
+{
+    tlsb_watch_stop();
+
+    struct stat sb;
+    if ('\0' == dir[0] || 0 != stat(dir, &sb) || !S_ISDIR(sb.st_mode)) {
+        log_msg("watch: '%s' is not a directory", dir);
+        return 0;
+    }
+
+    snprintf(watch_dir, sizeof(watch_dir), "%s", dir);
+    watch_stop = 0;
+    watch_ready = 0;
+    if (0 != pthread_create(&watch_thread, NULL, watch_proc, NULL)) {
+        log_msg("watch: can't create thread");
+        return 0;
+    }
+
+    watch_running = 1;
+    log_msg("watching '%s' for OFPs", watch_dir);
+    return 1;
+}
+
+void
+tlsb_watch_stop(void)
+{
+    if (!watch_running)
+        return;
+
+    watch_stop = 1;
+    pthread_join(watch_thread, NULL);
+    watch_running = 0;
+    log_msg("watch stopped");
+}
+
+/* take over the latest OFP from the watch directory, return 1 if there is one */
+int
+tlsb_watch_take(ofp_info_t *ofp_info, char *fn, int fn_len)
+{
+    int res = 0;
+    pthread_mutex_lock(&watch_mutex);
+    if (watch_ready) {
+        memcpy(ofp_info, &watch_ready_info, sizeof(*ofp_info));
+        snprintf(fn, fn_len, "%s", watch_ready_fn);
+        watch_ready = 0;
+        res = 1;
+    }
+    pthread_mutex_unlock(&watch_mutex);
+    return res;
+}
@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Queries on the winds aloft cube (navlog fix x level) of the OFP.
+ * Winds are interpolated and averaged as vectors, temperatures linearly.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "tlsb.h"
+
+#define D2R (M_PI / 180.0)
+
+/* wind of fix i at fl as u/v components, levels outside the cube are clamped */
+static void
+interp(const ofp_info_t *ofp_info, int i, int fl, double *u, double *v, double *oat)
+{
+    const short *lvl = ofp_info->wind_fl;
+    int n = ofp_info->n_wind_lvl;
+    int l = 0;
+
+    while (l < n - 2 && fl > lvl[l + 1])
+        l++;
+
+    double f = 0.0;
+    if (n > 1) {
+        f = (double)(fl - lvl[l]) / (lvl[l + 1] - lvl[l]);
+        if (f < 0.0) f = 0.0;
+        if (f > 1.0) f = 1.0;
+    }
+
+    const ofp_wind_t *w0 = &ofp_info->wind[i][l];
+    const ofp_wind_t *w1 = &ofp_info->wind[i][n > 1 ? l + 1 : l];
+    *u = (1.0 - f) * w0->spd * sin(w0->dir * D2R) + f * w1->spd * sin(w1->dir * D2R);
+    *v = (1.0 - f) * w0->spd * cos(w0->dir * D2R) + f * w1->spd * cos(w1->dir * D2R);
+    *oat = (1.0 - f) * w0->oat + f * w1->oat;
+}
+
+/*
+ * Mean wind at fl over the fixes of a flight phase ("CLB", "CRZ", "DSC" or NULL = all).
+ * Return # of fixes used, 0 if there is no wind data.
+ */
+int
+tlsb_wind_at(const ofp_info_t *ofp_info, const char *stage, int fl, int *dir, int *spd, int *oat)
+{
+    double su = 0.0, sv = 0.0, st = 0.0;
+    int n = 0;
+
+    if (0 == ofp_info->n_wind_lvl)
+        return 0;
+
+    for (int i = 0; i < ofp_info->n_fix; i++) {
+        if (stage && strcmp(ofp_info->navlog[i].stage, stage))
+            continue;
+        double u, v, t;
+        interp(ofp_info, i, fl, &u, &v, &t);
+        su += u;
+        sv += v;
+        st += t;
+        n++;
+    }
+
+    if (0 == n)
+        return 0;
+
+    su /= n;
+    sv /= n;
+    *spd = (int)(sqrt(su * su + sv * sv) + 0.5);
+    *dir = (int)(atan2(su, sv) / D2R + 360.5) % 360;
+    if (*dir == 0)
+        *dir = 360;
+    *oat = (int)lround(st / n);
+    return n;
+}
+
+/* entries for the MCDU CLB or DES wind page (stage "CLB" or "DSC"): "FL050 270/025 ..." up to cruise level */
+void
+tlsb_wind_page(const ofp_info_t *ofp_info, const char *stage, int crz_fl, char *buffer, int buflen)
+{
+    static const int page_fl[] = { 50, 100, 180, 240 };
+    int len = 0;
+
+    buffer[0] = '\0';
+    for (int k = 0; k < 5; k++) {
+        /* CLB page bottom up, DES page top down; last entry is the cruise level */
+        int i = strcmp(stage, "DSC") ? k : 4 - k;
+        int fl = i < 4 ? page_fl[i] : crz_fl;
+        if (i < 4 && fl >= crz_fl)
+            continue;
+
+        int dir, spd, oat;
+        if (0 == tlsb_wind_at(ofp_info, stage, fl, &dir, &spd, &oat))
+            return;
+        len += snprintf(buffer + len, buflen - len, "%s%03d %03d/%03d", len ? "  " : "", fl, dir, spd);
+        if (len >= buflen)
+            return;
+    }
+}
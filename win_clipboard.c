@@ -29,7 +29,7 @@ SOFTWARE.
 #include "tlsb.h"
 
 int
-get_clipboard(char *buffer, int buflen)
+get_clipboard(char *buffer, int buflen, int timeout_ms)
 {
     int ret = 0;
     
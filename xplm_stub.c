@@ -0,0 +1,1235 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Stub XPLM/Widgets runtime, so the plugin runs headless in a plain process.
+ *
+ * Implements the part of the SDK the plugin uses: datarefs with storage or
+ * plugin accessors, commands, menus, flight loops, a widget tree with message
+ * dispatch, and string drawing into a screen buffer.
+ * Deliberately does not include the SDK headers, the few types are replicated
+ * so the stub links against objects built with any SDK version.
+ *
+ * Every plugin entry point called from here is measured: CPU time of the main
+ * thread and the allocations it makes. Allocations are counted by wrapping
+ * malloc, calloc and realloc at link time (-Wl,--wrap=...).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "xplm_stub.h"
+
+/* the SDK's values */
+enum { CMD_BEGIN, CMD_CONTINUE, CMD_END };
+enum { MODE_DIRECT, MODE_UP_CHAIN, MODE_RECURSIVE, MODE_DIRECT_ALL, MODE_ONCE };
+enum { TYPE_INT = 1, TYPE_FLOAT = 2, TYPE_DOUBLE = 4, TYPE_FLOAT_ARRAY = 8, TYPE_INT_ARRAY = 16, TYPE_DATA = 32 };
+#define MSG_DRAW 4
+
+typedef float (*flight_loop_f)(float since_last, float since_loop, int counter, void *refcon);
+typedef struct {
+    int struct_size;
+    int phase;
+    flight_loop_f cb;
+    void *refcon;
+} flight_loop_params_t;
+
+typedef int (*cmd_handler_f)(void *cmd, int phase, void *refcon);
+typedef void (*menu_handler_f)(void *menu_ref, void *item_ref);
+typedef int (*widget_func_f)(int msg, void *widget, intptr_t param1, intptr_t param2);
+
+/* allocation counting, main thread figures are what's measured */
+static __thread long alloc_count, alloc_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *
+__wrap_malloc(size_t size)
+{
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t n, size_t size)
+{
+    alloc_count++;
+    alloc_bytes += n * size;
+    return __real_calloc(n, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+/* measurement */
+#define MAX_SITE 100
+typedef struct {
+    char name[60];
+    long calls;
+    long ns, max_ns;
+    long allocs, max_allocs, bytes;
+} site_t;
+
+static site_t site[MAX_SITE];
+static int n_site;
+static int depth;
+static site_t *cur_site;
+static long cur_ns, cur_allocs, cur_bytes;
+
+static long
+cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static long
+now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+void
+xplm_stub_measure_begin(const char *name)
+{
+    if (depth++ > 0)
+        return;
+
+    cur_site = NULL;
+    for (int i = 0; i < n_site; i++)
+        if (0 == strcmp(site[i].name, name)) {
+            cur_site = &site[i];
+            break;
+        }
+
+    if (NULL == cur_site && n_site < MAX_SITE) {
+        cur_site = &site[n_site++];
+        snprintf(cur_site->name, sizeof(cur_site->name), "%s", name);
+    }
+
+    cur_allocs = alloc_count;
+    cur_bytes = alloc_bytes;
+    cur_ns = cpu_ns();
+}
+
+void
+xplm_stub_measure_end(void)
+{
+    if (--depth > 0 || NULL == cur_site)
+        return;
+
+    long ns = cpu_ns() - cur_ns;
+    long allocs = alloc_count - cur_allocs;
+    site_t *s = cur_site;
+    s->calls++;
+    s->ns += ns;
+    s->allocs += allocs;
+    s->bytes += alloc_bytes - cur_bytes;
+    if (ns > s->max_ns)
+        s->max_ns = ns;
+    if (allocs > s->max_allocs)
+        s->max_allocs = allocs;
+}
+
+void
+xplm_stub_report(FILE *f)
+{
+    fprintf(f, "%-44s %7s %9s %9s %8s %8s %9s\n", "callback", "calls", "avg us", "max us",
+            "allocs", "max", "bytes");
+    for (int i = 0; i < n_site; i++) {
+        site_t *s = &site[i];
+        if (0 == s->calls)
+            continue;
+        fprintf(f, "%-44.44s %7ld %9.1f %9.1f %8.1f %8ld %9ld\n", s->name, s->calls,
+                s->ns / 1000.0 / s->calls, s->max_ns / 1000.0, (double)s->allocs / s->calls,
+                s->max_allocs, s->bytes / s->calls);
+    }
+}
+
+/* check the sites starting with name, return # of violations */
+int
+xplm_stub_check(const char *name, double max_us, long max_allocs)
+{
+    int n = 0, len = strlen(name);
+    for (int i = 0; i < n_site; i++) {
+        site_t *s = &site[i];
+        if (0 == s->calls || strncmp(s->name, name, len))
+            continue;
+
+        double avg_us = s->ns / 1000.0 / s->calls;
+        if (max_us >= 0 && avg_us > max_us) {
+            fprintf(stderr, "LIMIT: '%s' takes %.1f us per call, limit %.1f\n", s->name, avg_us, max_us);
+            n++;
+        }
+        if (max_allocs >= 0 && s->max_allocs > max_allocs) {
+            fprintf(stderr, "LIMIT: '%s' makes up to %ld allocations per call, limit %ld\n",
+                    s->name, s->max_allocs, max_allocs);
+            n++;
+        }
+    }
+    return n;
+}
+
+/* environment */
+static char xpdir[512], acf_file[256], acf_path[512];
+static int quiet;
+static long t_start;
+
+void
+xplm_stub_init(const char *xpdir_, const char *acf_file_, const char *acf_path_)
+{
+    snprintf(xpdir, sizeof(xpdir), "%s", xpdir_);
+    snprintf(acf_file, sizeof(acf_file), "%s", acf_file_);
+    snprintf(acf_path, sizeof(acf_path), "%s", acf_path_);
+    t_start = now_ms();
+}
+
+void
+xplm_stub_quiet(int q)
+{
+    quiet = q;
+}
+
+void
+XPLMDebugString(const char *str)
+{
+    if (!quiet)
+        fputs(str, stderr);
+}
+
+void
+XPLMEnableFeature(const char *feature, int enable)
+{
+    (void)feature;
+    (void)enable;
+}
+
+const char *
+XPLMGetDirectorySeparator(void)
+{
+    return "/";
+}
+
+void
+XPLMGetSystemPath(char *path)
+{
+    strcpy(path, xpdir);
+}
+
+void
+XPLMGetPrefsPath(char *path)
+{
+    sprintf(path, "%sOutput/preferences/Set X-Plane.prf", xpdir);
+}
+
+char *
+XPLMExtractFileAndPath(char *path)
+{
+    char *s = strrchr(path, '/');
+    if (NULL == s)
+        return path;
+    *s = '\0';
+    return s + 1;
+}
+
+void
+XPLMGetNthAircraftModel(int i, char *file, char *path)
+{
+    (void)i;
+    strcpy(file, acf_file);
+    strcpy(path, acf_path);
+}
+
+/* datarefs and their writes */
+#define MAX_DREF 100
+#define DREF_VEC 32
+typedef struct {
+    char name[80];
+    double value;
+    int vi[DREF_VEC];
+    char b[64];
+    int b_len;
+
+    int accessor;
+    int (*geti)(void *);
+    void (*seti)(void *, int);
+    float (*getf)(void *);
+    void (*setf)(void *, float);
+    double (*getd)(void *);
+    void (*setd)(void *, double);
+    int (*getvi)(void *, int *, int, int);
+    void (*setvi)(void *, int *, int, int);
+    int (*getvf)(void *, float *, int, int);
+    void (*setvf)(void *, float *, int, int);
+    int (*getb)(void *, void *, int, int);
+    void (*setb)(void *, void *, int, int);
+    void *rd_ref, *wr_ref;
+} dref_t;
+
+static dref_t dref[MAX_DREF];
+static int n_dref;
+
+#define MAX_WRITE 1000
+static struct {
+    long t;
+    char what[100];
+} write_log[MAX_WRITE];
+static int n_write;
+
+static void
+log_write(const char *what, const char *name, double value)
+{
+    if (n_write < MAX_WRITE) {
+        write_log[n_write].t = now_ms() - t_start;
+        snprintf(write_log[n_write].what, sizeof(write_log[0].what), "%s %s %g", what, name, value);
+        n_write++;
+    }
+}
+
+void
+xplm_stub_writes(FILE *f)
+{
+    for (int i = 0; i < n_write; i++)
+        fprintf(f, "%7ld ms %s\n", write_log[i].t, write_log[i].what);
+}
+
+static dref_t *
+dref_find(const char *name)
+{
+    for (int i = 0; i < n_dref; i++)
+        if (0 == strcmp(dref[i].name, name))
+            return &dref[i];
+    return NULL;
+}
+
+static dref_t *
+dref_new(const char *name)
+{
+    dref_t *d = dref_find(name);
+    if (d)
+        return d;
+    if (n_dref == MAX_DREF)
+        return NULL;
+    d = &dref[n_dref++];
+    snprintf(d->name, sizeof(d->name), "%s", name);
+    return d;
+}
+
+void
+xplm_stub_dataref(const char *name, double value)
+{
+    dref_t *d = dref_new(name);
+    if (d)
+        d->value = value;
+}
+
+double
+xplm_stub_value(const char *name)
+{
+    dref_t *d = dref_find(name);
+    return d ? d->value : 0.0;
+}
+
+void
+xplm_stub_dataref_bytes(const char *name, const char *value)
+{
+    dref_t *d = dref_new(name);
+    if (d) {
+        snprintf(d->b, sizeof(d->b), "%s", value);
+        d->b_len = strlen(d->b);
+    }
+}
+
+void *
+XPLMFindDataRef(const char *name)
+{
+    return dref_find(name);
+}
+
+void *
+XPLMRegisterDataAccessor(const char *name, int type, int writable,
+                         void *geti, void *seti, void *getf, void *setf, void *getd, void *setd,
+                         void *getvi, void *setvi, void *getvf, void *setvf, void *getb, void *setb,
+                         void *rd_ref, void *wr_ref)
+{
+    (void)type;
+    (void)writable;
+    dref_t *d = dref_new(name);
+    if (NULL == d)
+        return NULL;
+    d->accessor = 1;
+    d->geti = geti; d->seti = seti;
+    d->getf = getf; d->setf = setf;
+    d->getd = getd; d->setd = setd;
+    d->getvi = getvi; d->setvi = setvi;
+    d->getvf = getvf; d->setvf = setvf;
+    d->getb = getb; d->setb = setb;
+    d->rd_ref = rd_ref;
+    d->wr_ref = wr_ref;
+    return d;
+}
+
+void
+XPLMUnregisterDataAccessor(void *ref)
+{
+    dref_t *d = ref;
+    if (d)
+        d->accessor = 0;
+}
+
+int
+XPLMGetDatai(void *ref)
+{
+    dref_t *d = ref;
+    if (d->accessor)
+        return d->geti ? d->geti(d->rd_ref) : 0;
+    return (int)d->value;
+}
+
+void
+XPLMSetDatai(void *ref, int value)
+{
+    dref_t *d = ref;
+    log_write("dref", d->name, value);
+    if (d->accessor) {
+        if (d->seti)
+            d->seti(d->wr_ref, value);
+    } else
+        d->value = value;
+}
+
+float
+XPLMGetDataf(void *ref)
+{
+    dref_t *d = ref;
+    if (d->accessor)
+        return d->getf ? d->getf(d->rd_ref) : 0.0f;
+    return (float)d->value;
+}
+
+void
+XPLMSetDataf(void *ref, float value)
+{
+    dref_t *d = ref;
+    log_write("dref", d->name, value);
+    if (d->accessor) {
+        if (d->setf)
+            d->setf(d->wr_ref, value);
+    } else
+        d->value = value;
+}
+
+double
+XPLMGetDatad(void *ref)
+{
+    dref_t *d = ref;
+    if (d->accessor)
+        return d->getd ? d->getd(d->rd_ref) : 0.0;
+    return d->value;
+}
+
+int
+XPLMGetDatavi(void *ref, int *values, int offset, int max)
+{
+    dref_t *d = ref;
+    if (d->accessor)
+        return d->getvi ? d->getvi(d->rd_ref, values, offset, max) : 0;
+
+    if (NULL == values)
+        return DREF_VEC;
+    int n = 0;
+    for (; n < max && offset + n < DREF_VEC; n++)
+        values[n] = d->vi[offset + n];
+    return n;
+}
+
+int
+XPLMGetDatavf(void *ref, float *values, int offset, int max)
+{
+    dref_t *d = ref;
+    if (d->accessor)
+        return d->getvf ? d->getvf(d->rd_ref, values, offset, max) : 0;
+
+    if (NULL == values)
+        return DREF_VEC;
+    int n = 0;
+    for (; n < max && offset + n < DREF_VEC; n++)
+        values[n] = d->vi[offset + n];
+    return n;
+}
+
+int
+XPLMGetDatab(void *ref, void *value, int offset, int max)
+{
+    dref_t *d = ref;
+    if (d->accessor)
+        return d->getb ? d->getb(d->rd_ref, value, offset, max) : 0;
+
+    if (NULL == value)
+        return d->b_len;
+    int n = d->b_len - offset;
+    n = n < 0 ? 0 : (n > max ? max : n);
+    memcpy(value, d->b + offset, n);
+    return n;
+}
+
+/* read any dataref as text, measured if it's the plugin's */
+int
+xplm_stub_read_dataref(const char *name, char *buf, int buflen)
+{
+    dref_t *d = dref_find(name);
+    if (NULL == d)
+        return 0;
+
+    char site_name[100];
+    snprintf(site_name, sizeof(site_name), "dref %s", name);
+    xplm_stub_measure_begin(site_name);
+    if (d->accessor && d->getb) {
+        int n = d->getb(d->rd_ref, NULL, 0, 0);
+        char tmp[1024];
+        n = d->getb(d->rd_ref, tmp, 0, n < (int)sizeof(tmp) - 1 ? n : (int)sizeof(tmp) - 1);
+        tmp[n > 0 ? n : 0] = '\0';
+        snprintf(buf, buflen, "%s", tmp);
+    } else if (d->accessor && d->getf)
+        snprintf(buf, buflen, "%g", d->getf(d->rd_ref));
+    else if (d->accessor && d->geti)
+        snprintf(buf, buflen, "%d", d->geti(d->rd_ref));
+    else if (d->b_len)
+        snprintf(buf, buflen, "%s", d->b);
+    else
+        snprintf(buf, buflen, "%g", d->value);
+    xplm_stub_measure_end();
+    return 1;
+}
+
+/* commands */
+#define MAX_CMD 50
+#define MAX_HANDLER 4
+typedef struct {
+    char name[80];
+    int n_handler;
+    struct {
+        cmd_handler_f fn;
+        void *refcon;
+    } handler[MAX_HANDLER];
+} cmd_t;
+
+static cmd_t cmd[MAX_CMD];
+static int n_cmd;
+
+void *
+XPLMFindCommand(const char *name)
+{
+    for (int i = 0; i < n_cmd; i++)
+        if (0 == strcmp(cmd[i].name, name))
+            return &cmd[i];
+    return NULL;
+}
+
+void *
+XPLMCreateCommand(const char *name, const char *description)
+{
+    (void)description;
+    cmd_t *c = XPLMFindCommand(name);
+    if (c || n_cmd == MAX_CMD)
+        return c;
+    c = &cmd[n_cmd++];
+    snprintf(c->name, sizeof(c->name), "%s", name);
+    return c;
+}
+
+void
+xplm_stub_command(const char *name)
+{
+    XPLMCreateCommand(name, "");
+}
+
+void
+XPLMRegisterCommandHandler(void *ref, cmd_handler_f fn, int before, void *refcon)
+{
+    (void)before;
+    cmd_t *c = ref;
+    if (c->n_handler < MAX_HANDLER) {
+        c->handler[c->n_handler].fn = fn;
+        c->handler[c->n_handler++].refcon = refcon;
+    }
+}
+
+void
+XPLMUnregisterCommandHandler(void *ref, cmd_handler_f fn, int before, void *refcon)
+{
+    (void)before;
+    cmd_t *c = ref;
+    for (int i = 0; i < c->n_handler; i++)
+        if (c->handler[i].fn == fn && c->handler[i].refcon == refcon) {
+            memmove(&c->handler[i], &c->handler[i + 1], (c->n_handler - i - 1) * sizeof(c->handler[0]));
+            c->n_handler--;
+            break;
+        }
+}
+
+void
+XPLMCommandOnce(void *ref)
+{
+    cmd_t *c = ref;
+    log_write("cmd", c->name, 0);
+    for (int i = 0; i < c->n_handler; i++)
+        c->handler[i].fn(c, CMD_BEGIN, c->handler[i].refcon);
+    for (int i = 0; i < c->n_handler; i++)
+        c->handler[i].fn(c, CMD_END, c->handler[i].refcon);
+}
+
+int
+xplm_stub_run_command(const char *name)
+{
+    cmd_t *c = XPLMFindCommand(name);
+    if (NULL == c)
+        return 0;
+
+    char site_name[100];
+    snprintf(site_name, sizeof(site_name), "cmd %s", name);
+    xplm_stub_measure_begin(site_name);
+    for (int i = 0; i < c->n_handler; i++)
+        c->handler[i].fn(c, CMD_BEGIN, c->handler[i].refcon);
+    for (int i = 0; i < c->n_handler; i++)
+        c->handler[i].fn(c, CMD_END, c->handler[i].refcon);
+    xplm_stub_measure_end();
+    return 1;
+}
+
+/* menus */
+#define MAX_MENU 10
+#define MAX_ITEM 50
+typedef struct {
+    int used;
+    menu_handler_f handler;
+    void *menu_ref;
+} menu_t;
+
+static menu_t menu[MAX_MENU];   /* 0 is the plugins menu */
+static struct {
+    menu_t *menu;
+    char name[80];
+    void *item_ref;
+} item[MAX_ITEM];
+static int n_item;
+
+void *
+XPLMFindPluginsMenu(void)
+{
+    menu[0].used = 1;
+    return &menu[0];
+}
+
+void *
+XPLMCreateMenu(const char *name, void *parent, int parent_item, menu_handler_f handler, void *menu_ref)
+{
+    (void)name;
+    (void)parent;
+    (void)parent_item;
+    for (int i = 1; i < MAX_MENU; i++)
+        if (!menu[i].used) {
+            menu[i].used = 1;
+            menu[i].handler = handler;
+            menu[i].menu_ref = menu_ref;
+            return &menu[i];
+        }
+    return NULL;
+}
+
+int
+XPLMAppendMenuItem(void *m, const char *name, void *item_ref, int ignored)
+{
+    (void)ignored;
+    if (n_item == MAX_ITEM)
+        return -1;
+    item[n_item].menu = m;
+    snprintf(item[n_item].name, sizeof(item[0].name), "%s", name);
+    item[n_item].item_ref = item_ref;
+    return n_item++;
+}
+
+void
+XPLMDestroyMenu(void *m)
+{
+    menu_t *mp = m;
+    mp->used = 0;
+    for (int i = 0; i < n_item; i++)
+        if (item[i].menu == mp)
+            item[i].menu = NULL;
+}
+
+int
+xplm_stub_menu(const char *name)
+{
+    for (int i = 0; i < n_item; i++)
+        if (item[i].menu && item[i].menu->handler && 0 == strcmp(item[i].name, name)) {
+            char site_name[100];
+            snprintf(site_name, sizeof(site_name), "menu %s", name);
+            xplm_stub_measure_begin(site_name);
+            item[i].menu->handler(item[i].menu->menu_ref, item[i].item_ref);
+            xplm_stub_measure_end();
+            return 1;
+        }
+    return 0;
+}
+
+/* flight loops, scheduled in frames (< 0) or seconds (> 0) */
+#define MAX_LOOP 10
+typedef struct {
+    int used, active;
+    flight_loop_params_t params;
+    long due_frame, due_ms, last_ms;
+} loop_t;
+
+static loop_t loop[MAX_LOOP];
+static long frame;
+
+void *
+XPLMCreateFlightLoop(flight_loop_params_t *params)
+{
+    for (int i = 0; i < MAX_LOOP; i++)
+        if (!loop[i].used) {
+            memset(&loop[i], 0, sizeof(loop[i]));
+            loop[i].used = 1;
+            loop[i].params = *params;
+            loop[i].last_ms = now_ms();
+            return &loop[i];
+        }
+    return NULL;
+}
+
+void
+XPLMDestroyFlightLoop(void *id)
+{
+    ((loop_t *)id)->used = 0;
+}
+
+static void
+schedule(loop_t *l, float interval)
+{
+    l->active = (interval != 0.0f);
+    l->due_frame = interval < 0.0f ? frame + (long)(-interval) : 0;
+    l->due_ms = interval > 0.0f ? now_ms() + (long)(interval * 1000.0f) : 0;
+}
+
+void
+XPLMScheduleFlightLoop(void *id, float interval, int relative_to_now)
+{
+    (void)relative_to_now;
+    schedule(id, interval);
+}
+
+float
+XPLMGetElapsedTime(void)
+{
+    return (now_ms() - t_start) / 1000.0f;
+}
+
+/* widgets, XPWidgetID is a pointer into the table */
+#define MAX_WIDGET 200
+#define MAX_CB 4
+#define MAX_PROP 16
+#define CLASS_CUSTOM (-1)
+typedef struct _widget widget_t;
+struct _widget {
+    int used, visible, cls;
+    int l, t, r, b;
+    char descr[256];
+    widget_t *parent;
+    widget_func_f func;         /* custom widget */
+    int n_cb;
+    widget_func_f cb[MAX_CB];   /* added, the latest is called first */
+    int n_prop;
+    struct {
+        int id;
+        intptr_t val;
+    } prop[MAX_PROP];
+};
+
+static widget_t widget[MAX_WIDGET];
+static int n_widget;
+
+static widget_t *
+widget_new(int l, int t, int r, int b, int visible, const char *descr, void *container, int cls)
+{
+    widget_t *w = NULL;
+    for (int i = 0; i < MAX_WIDGET; i++)
+        if (!widget[i].used) {
+            w = &widget[i];
+            break;
+        }
+    if (NULL == w)
+        return NULL;
+
+    memset(w, 0, sizeof(*w));
+    w->used = 1;
+    w->visible = visible;
+    w->cls = cls;
+    w->l = l; w->t = t; w->r = r; w->b = b;
+    snprintf(w->descr, sizeof(w->descr), "%s", descr);
+    w->parent = container;
+    if (w - widget >= n_widget)
+        n_widget = w - widget + 1;
+    return w;
+}
+
+/* like XPLM, NULL or stale widget ids are ignored */
+static widget_t *
+widget_get(void *id)
+{
+    widget_t *w = id;
+    if (w < widget || w >= widget + MAX_WIDGET || !w->used)
+        return NULL;
+    return w;
+}
+
+void *
+XPCreateWidget(int l, int t, int r, int b, int visible, const char *descr, int is_root,
+               void *container, int cls)
+{
+    (void)is_root;
+    return widget_new(l, t, r, b, visible, descr, container, cls);
+}
+
+void *
+XPCreateCustomWidget(int l, int t, int r, int b, int visible, const char *descr, int is_root,
+                     void *container, widget_func_f func)
+{
+    (void)is_root;
+    widget_t *w = widget_new(l, t, r, b, visible, descr, container, CLASS_CUSTOM);
+    if (w)
+        w->func = func;
+    return w;
+}
+
+void
+XPDestroyWidget(void *id, int destroy_children)
+{
+    widget_t *w = widget_get(id);
+    if (NULL == w)
+        return;
+    if (destroy_children)
+        for (int i = 0; i < n_widget; i++)
+            if (widget[i].used && widget[i].parent == w)
+                XPDestroyWidget(&widget[i], 1);
+    w->used = 0;
+}
+
+void
+XPAddWidgetCallback(void *id, widget_func_f cb)
+{
+    widget_t *w = widget_get(id);
+    if (w && w->n_cb < MAX_CB)
+        w->cb[w->n_cb++] = cb;
+}
+
+static int
+dispatch(widget_t *w, int msg, intptr_t param1, intptr_t param2, int all)
+{
+    int handled = 0;
+    for (int i = w->n_cb - 1; i >= 0 && (all || !handled); i--)
+        handled |= w->cb[i](msg, w, param1, param2);
+    if (w->func && (all || !handled))
+        handled |= w->func(msg, w, param1, param2);
+    return handled;
+}
+
+int
+XPSendMessageToWidget(void *id, int msg, int mode, intptr_t param1, intptr_t param2)
+{
+    widget_t *w = widget_get(id);
+    if (NULL == w)
+        return 0;
+
+    switch (mode) {
+        case MODE_UP_CHAIN:
+            for (; w; w = w->parent)
+                if (w->used && dispatch(w, msg, param1, param2, 0))
+                    return 1;
+            return 0;
+
+        case MODE_RECURSIVE: {
+            int handled = dispatch(w, msg, param1, param2, 0);
+            for (int i = 0; i < n_widget; i++)
+                if (widget[i].used && widget[i].parent == w)
+                    handled |= XPSendMessageToWidget(&widget[i], msg, mode, param1, param2);
+            return handled;
+        }
+
+        case MODE_DIRECT_ALL:
+            return dispatch(w, msg, param1, param2, 1);
+
+        default:
+            return dispatch(w, msg, param1, param2, 0);
+    }
+}
+
+static void
+widget_site(const widget_t *w, const char *what, char *buf, int buflen)
+{
+    if (w->descr[0])
+        snprintf(buf, buflen, "%s %.40s", what, w->descr);
+    else
+        snprintf(buf, buflen, "%s %s#%d", what, w->cls == CLASS_CUSTOM ? "custom" : "widget",
+                 (int)(w - widget));
+}
+
+/* a user action on a widget */
+int
+xplm_stub_send(void *id, int msg, int mode, intptr_t param1, intptr_t param2)
+{
+    char site_name[100];
+    if (NULL == widget_get(id))
+        return 0;
+    widget_site(id, "msg", site_name, sizeof(site_name));
+    xplm_stub_measure_begin(site_name);
+    int res = XPSendMessageToWidget(id, msg, mode, param1, param2);
+    xplm_stub_measure_end();
+    return res;
+}
+
+void
+XPShowWidget(void *id)
+{
+    widget_t *w = widget_get(id);
+    if (w)
+        w->visible = 1;
+}
+
+void
+XPHideWidget(void *id)
+{
+    widget_t *w = widget_get(id);
+    if (w)
+        w->visible = 0;
+}
+
+int
+XPIsWidgetVisible(void *id)
+{
+    widget_t *w = widget_get(id);
+    if (NULL == w)
+        return 0;
+    for (; w; w = w->parent)
+        if (!w->visible)
+            return 0;
+    return 1;
+}
+
+static void
+move_children(widget_t *w, int dx, int dy)
+{
+    for (int i = 0; i < n_widget; i++) {
+        widget_t *c = &widget[i];
+        if (c->used && c->parent == w) {
+            c->l += dx; c->r += dx;
+            c->t += dy; c->b += dy;
+            move_children(c, dx, dy);
+        }
+    }
+}
+
+/* like X-Plane, children stay put relative to the parent's lower left corner */
+void
+XPSetWidgetGeometry(void *id, int l, int t, int r, int b)
+{
+    widget_t *w = widget_get(id);
+    if (NULL == w)
+        return;
+    move_children(w, l - w->l, b - w->b);
+    w->l = l; w->t = t; w->r = r; w->b = b;
+}
+
+void
+XPGetWidgetGeometry(void *id, int *l, int *t, int *r, int *b)
+{
+    widget_t *w = widget_get(id);
+    if (NULL == w) {
+        if (l) *l = 0;
+        if (t) *t = 0;
+        if (r) *r = 0;
+        if (b) *b = 0;
+        return;
+    }
+    if (l) *l = w->l;
+    if (t) *t = w->t;
+    if (r) *r = w->r;
+    if (b) *b = w->b;
+}
+
+void
+XPSetWidgetDescriptor(void *id, const char *descr)
+{
+    widget_t *w = widget_get(id);
+    if (NULL == w)
+        return;
+    snprintf(w->descr, sizeof(w->descr), "%s", descr);
+}
+
+int
+XPGetWidgetDescriptor(void *id, char *buf, int buflen)
+{
+    widget_t *w = widget_get(id);
+    if (NULL == w) {
+        if (buf && buflen > 0)
+            buf[0] = '\0';
+        return 0;
+    }
+    int len = strlen(w->descr);
+    if (buf && buflen > 0)
+        snprintf(buf, buflen, "%s", w->descr);
+    return len;
+}
+
+void
+XPSetWidgetProperty(void *id, int prop, intptr_t val)
+{
+    widget_t *w = widget_get(id);
+    if (NULL == w)
+        return;
+    for (int i = 0; i < w->n_prop; i++)
+        if (w->prop[i].id == prop) {
+            w->prop[i].val = val;
+            return;
+        }
+    if (w->n_prop < MAX_PROP) {
+        w->prop[w->n_prop].id = prop;
+        w->prop[w->n_prop++].val = val;
+    }
+}
+
+intptr_t
+XPGetWidgetProperty(void *id, int prop, int *exists)
+{
+    widget_t *w = widget_get(id);
+    for (int i = 0; w && i < w->n_prop; i++)
+        if (w->prop[i].id == prop) {
+            if (exists)
+                *exists = 1;
+            return w->prop[i].val;
+        }
+    if (exists)
+        *exists = 0;
+    return 0;
+}
+
+int
+XPCountChildWidgets(void *id)
+{
+    int n = 0;
+    if (NULL == widget_get(id))
+        return 0;
+    for (int i = 0; i < n_widget; i++)
+        n += (widget[i].used && widget[i].parent == id);
+    return n;
+}
+
+void *
+XPGetNthChildWidget(void *id, int index)
+{
+    if (NULL == widget_get(id))
+        return NULL;
+    for (int i = 0; i < n_widget; i++)
+        if (widget[i].used && widget[i].parent == id && 0 == index--)
+            return &widget[i];
+    return NULL;
+}
+
+void *
+XPGetWidgetUnderlyingWindow(void *id)
+{
+    (void)id;
+    static int window;
+    return &window;
+}
+
+void *
+xplm_stub_find_widget(const char *descr)
+{
+    for (int i = 0; i < n_widget; i++)
+        if (widget[i].used && 0 == strcmp(widget[i].descr, descr))
+            return &widget[i];
+    return NULL;
+}
+
+void *
+xplm_stub_find_class(int cls)
+{
+    for (int i = 0; i < n_widget; i++)
+        if (widget[i].used && widget[i].cls == cls)
+            return &widget[i];
+    return NULL;
+}
+
+/* the widget created delta positions later */
+void *
+xplm_stub_next_widget(void *id, int delta)
+{
+    widget_t *w = (widget_t *)id + delta;
+    return (w >= widget && w < widget + n_widget && w->used) ? w : NULL;
+}
+
+void
+xplm_stub_set_descriptor(void *id, const char *descr)
+{
+    XPSetWidgetDescriptor(id, descr);
+}
+
+/* display and drawing into a screen buffer of the current frame */
+#define MAX_STR 200
+typedef struct {
+    int x, y;
+    char s[100];
+} screen_str_t;
+
+static screen_str_t screen[MAX_STR];
+static int n_screen;
+
+void
+XPLMGetScreenBoundsGlobal(int *l, int *t, int *r, int *b)
+{
+    *l = 0; *t = 1080; *r = 1920; *b = 0;
+}
+
+void
+XPLMSetWindowPositioningMode(void *window, int mode, int monitor)
+{
+    (void)window;
+    (void)mode;
+    (void)monitor;
+}
+
+void
+XPLMDrawString(float *color, int x, int y, char *str, int *wrap, int font)
+{
+    (void)color;
+    (void)wrap;
+    (void)font;
+    if (n_screen < MAX_STR) {
+        screen[n_screen].x = x;
+        screen[n_screen].y = y;
+        snprintf(screen[n_screen].s, sizeof(screen[0].s), "%s", str);
+        n_screen++;
+    }
+}
+
+void
+XPLMGetFontDimensions(int font, int *w, int *h, int *digits_only)
+{
+    (void)font;
+    if (w) *w = 7;
+    if (h) *h = 12;
+    if (digits_only) *digits_only = 0;
+}
+
+static int
+screen_cmp(const void *a, const void *b)
+{
+    const screen_str_t *sa = a, *sb = b;
+    if (sa->y != sb->y)
+        return sb->y - sa->y;
+    return sa->x - sb->x;
+}
+
+/* strings drawn in the last frame, top to bottom */
+void
+xplm_stub_screen(FILE *f)
+{
+    qsort(screen, n_screen, sizeof(screen[0]), screen_cmp);
+    int y = INT32_MIN;
+    for (int i = 0; i < n_screen; i++) {
+        if (screen[i].y != y) {
+            if (y != INT32_MIN)
+                putc('\n', f);
+            fprintf(f, "%5d %*s", screen[i].y, screen[i].x / 8, "");
+            y = screen[i].y;
+        } else
+            putc(' ', f);
+        fputs(screen[i].s, f);
+    }
+    putc('\n', f);
+}
+
+static void
+draw(widget_t *w)
+{
+    if (!w->visible)
+        return;
+
+    if (w->n_cb || w->func) {
+        char site_name[100];
+        widget_site(w, "draw", site_name, sizeof(site_name));
+        xplm_stub_measure_begin(site_name);
+        dispatch(w, MSG_DRAW, 0, 0, 0);
+        xplm_stub_measure_end();
+    }
+
+    for (int i = 0; i < n_widget; i++)
+        if (widget[i].used && widget[i].parent == w)
+            draw(&widget[i]);
+}
+
+/* one frame: due flight loops, then the widgets */
+void
+xplm_stub_frame(void)
+{
+    frame++;
+    long now = now_ms();
+
+    for (int i = 0; i < MAX_LOOP; i++) {
+        loop_t *l = &loop[i];
+        if (!l->used || !l->active)
+            continue;
+        if ((l->due_frame && frame < l->due_frame) || (l->due_ms && now < l->due_ms))
+            continue;
+
+        float since = (now - l->last_ms) / 1000.0f;
+        l->last_ms = now;
+        xplm_stub_measure_begin("flight loop");
+        float r = l->params.cb(since, since, (int)frame, l->params.refcon);
+        xplm_stub_measure_end();
+        if (l->used)
+            schedule(l, r);
+    }
+
+    n_screen = 0;
+    for (int i = 0; i < n_widget; i++)
+        if (widget[i].used && NULL == widget[i].parent)
+            draw(&widget[i]);
+}
@@ -0,0 +1,65 @@
+/*
+MIT License
+
+Copyright (c) 2026 Holger Teutsch
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _XPLM_STUB_H_
+#define _XPLM_STUB_H_
+
+/*
+ * Control side of the stub XPLM/Widgets runtime for the headless driver.
+ * Widget ids are XPWidgetID, messages and modes are the SDK's values.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+extern void xplm_stub_init(const char *xpdir, const char *acf_file, const char *acf_path);
+extern void xplm_stub_quiet(int quiet);
+
+/* what the sim and the aircraft provide */
+extern void xplm_stub_dataref(const char *name, double value);
+extern void xplm_stub_dataref_bytes(const char *name, const char *value);
+extern double xplm_stub_value(const char *name);
+extern void xplm_stub_command(const char *name);
+
+/* user actions, all measured */
+extern int xplm_stub_run_command(const char *name);
+extern int xplm_stub_menu(const char *item);
+extern int xplm_stub_send(void *widget, int msg, int mode, intptr_t param1, intptr_t param2);
+extern int xplm_stub_read_dataref(const char *name, char *buf, int buflen);
+extern void xplm_stub_frame(void);      /* flight loops and draw */
+
+extern void *xplm_stub_find_widget(const char *descriptor);
+extern void *xplm_stub_find_class(int widget_class);
+extern void *xplm_stub_next_widget(void *widget, int delta);
+extern void xplm_stub_set_descriptor(void *widget, const char *descriptor);
+
+/* measurement of a plugin entry point, may nest, the outermost counts */
+extern void xplm_stub_measure_begin(const char *site);
+extern void xplm_stub_measure_end(void);
+
+extern void xplm_stub_screen(FILE *f);
+extern void xplm_stub_writes(FILE *f);
+extern void xplm_stub_report(FILE *f);
+extern int xplm_stub_check(const char *site, double max_us, long max_allocs);
+#endif